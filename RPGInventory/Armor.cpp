@@ -1,8 +1,40 @@
 #include "Armor.h"
+#include "TextFormat.h"
 #include <stdexcept>
+#include <utility>
 
 using namespace std;
 
+Armor::Armor() : Item { ItemKind::Armor }
+{
+}
+
+Armor::Armor(const Armor& other) : Item { ItemKind::Armor }, slotID { other.slotID }, rating { other.rating }
+{
+    assignFrom(other, typeid(Armor));
+}
+
+Armor& Armor::operator=(const Armor& other)
+{
+    slotID = other.slotID;
+    rating = other.rating;
+    assignFrom(other, typeid(Armor));
+    return *this;
+}
+
+Armor::Armor(Armor&& other) noexcept : Item { ItemKind::Armor }, slotID { other.slotID }, rating { other.rating }
+{
+    assignFrom(std::move(other), typeid(Armor));
+}
+
+Armor& Armor::operator=(Armor&& other) noexcept
+{
+    slotID = other.slotID;
+    rating = other.rating;
+    assignFrom(std::move(other), typeid(Armor));
+    return *this;
+}
+
 Armor* Armor::clone() const
 {
     return new Armor { *this };
@@ -10,16 +42,23 @@ Armor* Armor::clone() const
 
 bool Armor::operator==(const Item& other) const
 {
-    // If the dynamic_cast succeeds, execution will enter the if statement.
-    if (const Armor* otherArmor = dynamic_cast<const Armor*>(&other))
+    // Different fingerprints can't be equal, which is cheaper to find out than checking the kind.
+    if (this->getFingerprint() != other.getFingerprint())
     {
+        return false;
+    }
+
+    // If the other item is armor too, execution will enter the if statement.
+    if (other.getKind() == ItemKind::Armor)
+    {
+        const Armor* otherArmor { static_cast<const Armor*>(&other) };
         return Item::operator==(other) // Invoke the superclass's == operator
             && this->getRating() == otherArmor->getRating()
             && this->getSlotID() == otherArmor->getSlotID();
     }
     else
     {
-        // dynamic_cast failed, other item is not armor.
+        // The other item is not armor.
         return false;
     }
 }
@@ -43,12 +82,20 @@ void Armor::setSlotID(unsigned int slotID)
     else
     {
         this->slotID = slotID;
+        invalidateFingerprint();
     }
 }
 
 void Armor::setRating(int rating)
 {
     this->rating = rating;
+    invalidateFingerprint();
+}
+
+void Armor::addToFingerprint(Fingerprint& hash) const
+{
+    Item::addToFingerprint(hash);
+    hash.add(slotID).add(rating);
 }
 
 void Armor::printToStream(std::ostream& out) const
@@ -71,3 +118,14 @@ void Armor::printToStream(std::ostream& out) const
     default:            out << "(Error)";   break;
     }
 }
+
+void Armor::appendTo(string& out) const
+{
+    //human-readable slot descriptions, by slot ID
+    static const char* const SLOT_LABELS[SLOT_COUNT]{ " AR (Chest)", " AR (Legs)", " AR (Hands)", " AR (Feet)", " AR (Head)", " AR (Shield)" };
+
+    Item::appendTo(out);
+    out.append(", ");
+    appendNumber(out, rating);
+    out.append(slotID < SLOT_COUNT ? SLOT_LABELS[slotID] : " AR (Error)");
+}
@@ -5,6 +5,16 @@
 class Armor : public Item
 {
 public:
+    // Creates a piece of armor with default attributes.
+    Armor();
+
+    // Copies or moves a piece of armor.  These keep the kind of the copy Armor, which Item's own copy
+    // constructors don't.
+    Armor(const Armor& other);
+    Armor& operator= (const Armor& other);
+    Armor(Armor&& other) noexcept;
+    Armor& operator= (Armor&& other) noexcept;
+
     // Creates a new pointer to a copy of the armor.
     // The pointer returned should be considered owned by the calling function.
     virtual Armor* clone() const override;
@@ -24,6 +34,9 @@ public:
     // Sets the rating of the armor piece.  It is theoretically possible for the rating to be zero or even negative. 
     void setRating(int rating);
 
+    // Appends the same text that operator<< prints to out, without stream formatting.
+    virtual void appendTo(std::string& out) const override;
+
     // 0 = Chest slot (i.e. breastplate, jacket, shirt)
     const static unsigned int  CHEST_SLOT = 0;
 
@@ -49,6 +62,9 @@ protected:
     // Protected helper function to support a polymorphic stream insertion operator.
     virtual void printToStream(std::ostream& out) const override;
 
+    // Adds the slot and rating after the fields of Item.
+    virtual void addToFingerprint(Fingerprint& hash) const override;
+
 private:
     // The slot ID of the armor piece.  This ID must be 0, 1, 2, 3, 4, or 5.
     unsigned int slotID { CHEST_SLOT };
@@ -0,0 +1,126 @@
+#include "BinaryFormat.h"
+#include <stdexcept>
+#include <cstring>
+
+using namespace std;
+
+BinaryWriter::BinaryWriter(string& buffer) : buffer{ buffer }
+{
+}
+
+void BinaryWriter::writeByte(uint8_t value)
+{
+    buffer.push_back(static_cast<char>(value));
+}
+
+void BinaryWriter::writeVarint(uint64_t value)
+{
+    //7 bits at a time, with the high bit set on every byte except the last
+    while (value >= 0x80)
+    {
+        buffer.push_back(static_cast<char>((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    buffer.push_back(static_cast<char>(value));
+}
+
+void BinaryWriter::writeSigned(int64_t value)
+{
+    //zigzag: 0, -1, 1, -2, 2... map to 0, 1, 2, 3, 4...
+    writeVarint((static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63));
+}
+
+void BinaryWriter::writeDouble(double value)
+{
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    for (int i{ 0 }; i < 8; i++)
+    {
+        buffer.push_back(static_cast<char>(bits >> (8 * i)));
+    }
+}
+
+void BinaryWriter::writeString(const string& value)
+{
+    writeVarint(value.size());
+    buffer.append(value);
+}
+
+BinaryReader::BinaryReader(const char* data, size_t size) : position{ data }, end{ data + size }
+{
+}
+
+uint8_t BinaryReader::readByte()
+{
+    //throw an exception if the data ends early
+    if (position == end)
+    {
+        throw runtime_error("unexpected end of binary data");
+    }
+    return static_cast<uint8_t>(*position++);
+}
+
+uint64_t BinaryReader::readVarint()
+{
+    uint64_t value{ 0 };
+    for (unsigned int shift{ 0 }; shift < 64; shift += 7)
+    {
+        const uint8_t byte{ readByte() };
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0)
+        {
+            return value;
+        }
+    }
+
+    //a 64 bit value never needs more than ten bytes
+    throw runtime_error("malformed varint in binary data");
+}
+
+int64_t BinaryReader::readSigned()
+{
+    const uint64_t value{ readVarint() };
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+double BinaryReader::readDouble()
+{
+    const char* bytes{ readBytes(8) };
+    uint64_t bits{ 0 };
+    for (int i{ 0 }; i < 8; i++)
+    {
+        bits |= static_cast<uint64_t>(static_cast<uint8_t>(bytes[i])) << (8 * i);
+    }
+
+    double value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+string BinaryReader::readString()
+{
+    const uint64_t length{ readVarint() };
+    if (length > static_cast<uint64_t>(end - position))
+    {
+        throw runtime_error("unexpected end of binary data");
+    }
+    return string(readBytes(static_cast<size_t>(length)), static_cast<size_t>(length));
+}
+
+const char* BinaryReader::readBytes(size_t count)
+{
+    //throw an exception if the data ends early
+    if (count > static_cast<size_t>(end - position))
+    {
+        throw runtime_error("unexpected end of binary data");
+    }
+
+    const char* bytes{ position };
+    position += count;
+    return bytes;
+}
+
+bool BinaryReader::atEnd() const
+{
+    return position == end;
+}
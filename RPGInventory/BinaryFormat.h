@@ -0,0 +1,71 @@
+#pragma once
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+// Appends values to a byte buffer in a compact, portable binary encoding.
+// Unsigned integers are written as LEB128 varints (7 bits per byte, low bits first), signed integers
+// are zigzag-encoded first so small negative values stay short, and doubles are written as their 
+// 8-byte IEEE representation in little-endian order so they round-trip exactly.
+class BinaryWriter
+{
+public:
+    // Creates a writer that appends to the specified buffer.
+    explicit BinaryWriter(std::string& buffer);
+
+    // Appends a single byte.
+    void writeByte(std::uint8_t value);
+
+    // Appends an unsigned integer as a varint.
+    void writeVarint(std::uint64_t value);
+
+    // Appends a signed integer as a zigzag-encoded varint.
+    void writeSigned(std::int64_t value);
+
+    // Appends a double as 8 little-endian bytes.
+    void writeDouble(double value);
+
+    // Appends a length-prefixed string.
+    void writeString(const std::string& value);
+
+private:
+    // The buffer being appended to
+    std::string& buffer;
+};
+
+// Reads values written by BinaryWriter from a byte range.
+// A runtime_error is thrown if the data ends early or a varint is malformed.
+class BinaryReader
+{
+public:
+    // Creates a reader over the specified bytes.  The bytes must outlive the reader.
+    BinaryReader(const char* data, std::size_t size);
+
+    // Reads a single byte.
+    std::uint8_t readByte();
+
+    // Reads a varint.
+    std::uint64_t readVarint();
+
+    // Reads a zigzag-encoded varint.
+    std::int64_t readSigned();
+
+    // Reads an 8-byte little-endian double.
+    double readDouble();
+
+    // Reads a length-prefixed string.
+    std::string readString();
+
+    // Reads the specified number of raw bytes and returns a pointer to them.
+    const char* readBytes(std::size_t count);
+
+    // Returns true if every byte has been read.
+    bool atEnd() const;
+
+private:
+    // The next byte to read
+    const char* position;
+
+    // One past the last byte
+    const char* end;
+};
@@ -0,0 +1,312 @@
+#include "BitmapIndex.h"
+#include "ItemKind.h"
+#include <algorithm>
+#include <climits>
+#include <limits>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+using namespace std;
+
+namespace
+{
+    //the lowest value in each rating and damage bucket; narrow buckets where most values fall
+    const int VALUE_BUCKETS[BitmapIndex::BUCKET_COUNT]{ INT_MIN, 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 129, 257 };
+
+    //the lowest weight in each weight bucket
+    const double WEIGHT_BUCKETS[BitmapIndex::BUCKET_COUNT]{ -numeric_limits<double>::infinity(), 0.5, 1, 2, 3, 5, 8, 10, 15, 20, 30, 50, 75, 100, 200, 500 };
+
+    //the position of the lowest set bit of a nonzero word
+    unsigned int lowestBit(uint64_t word)
+    {
+#ifdef _MSC_VER
+        unsigned long index;
+        _BitScanForward64(&index, word);
+        return static_cast<unsigned int>(index);
+#else
+        return static_cast<unsigned int>(__builtin_ctzll(word));
+#endif
+    }
+
+    //adds the bitmaps for buckets first through last to a condition
+    template <size_t N>
+    void addBuckets(vector<const CompressedBitmap*>& condition, const array<CompressedBitmap, N>& bitmaps, unsigned int first, unsigned int last)
+    {
+        for (unsigned int bucket{ first }; bucket <= last; bucket++)
+        {
+            condition.push_back(&bitmaps[bucket]);
+        }
+    }
+}
+
+CompressedBitmap::CompressedBitmap(const CompressedBitmap& other) : chunks(other.chunks.size())
+{
+    for (size_t i{ 0 }; i < chunks.size(); i++)
+    {
+        if (other.chunks[i].bits)
+        {
+            chunks[i].bits = make_unique<Chunk>(*other.chunks[i].bits);
+            chunks[i].count = other.chunks[i].count;
+        }
+    }
+}
+
+CompressedBitmap& CompressedBitmap::operator=(const CompressedBitmap& other)
+{
+    if (this != &other)
+    {
+        *this = CompressedBitmap{ other };
+    }
+    return *this;
+}
+
+void CompressedBitmap::set(uint32_t row)
+{
+    const size_t index{ row / CHUNK_ROWS };
+    if (index >= chunks.size())
+    {
+        chunks.resize(index + 1);
+    }
+    Slot& slot{ chunks[index] };
+    if (!slot.bits)
+    {
+        slot.bits = make_unique<Chunk>();
+        slot.bits->fill(0);
+    }
+
+    uint64_t& word{ (*slot.bits)[row % CHUNK_ROWS / 64] };
+    const uint64_t bit{ uint64_t{ 1 } << (row % 64) };
+    if (!(word & bit))
+    {
+        word |= bit;
+        slot.count++;
+    }
+}
+
+void CompressedBitmap::reset(uint32_t row)
+{
+    const size_t index{ row / CHUNK_ROWS };
+    if (index >= chunks.size() || !chunks[index].bits)
+    {
+        return;
+    }
+    Slot& slot{ chunks[index] };
+
+    uint64_t& word{ (*slot.bits)[row % CHUNK_ROWS / 64] };
+    const uint64_t bit{ uint64_t{ 1 } << (row % 64) };
+    if (word & bit)
+    {
+        word &= ~bit;
+        if (--slot.count == 0)
+        {
+            slot.bits.reset();
+        }
+    }
+}
+
+const CompressedBitmap::Chunk* CompressedBitmap::getChunk(size_t index) const
+{
+    return index < chunks.size() ? chunks[index].bits.get() : nullptr;
+}
+
+size_t CompressedBitmap::getAllocatedChunkCount() const
+{
+    return static_cast<size_t>(count_if(chunks.begin(), chunks.end(), [](const Slot& slot) { return slot.bits != nullptr; }));
+}
+
+void BitmapIndex::add(const Item& item)
+{
+    //reuse a freed row if there is one, so the bitmaps stay dense
+    uint32_t row;
+    if (!freeRows.empty())
+    {
+        row = freeRows.back();
+        freeRows.pop_back();
+        rows[row] = &item;
+    }
+    else
+    {
+        row = static_cast<uint32_t>(rows.size());
+        rows.push_back(&item);
+    }
+    rowOf.emplace(&item, row);
+    update(item, row, true);
+}
+
+void BitmapIndex::remove(const Item& item)
+{
+    auto found{ rowOf.find(&item) };
+    if (found == rowOf.end())
+    {
+        return;
+    }
+
+    const uint32_t row{ found->second };
+    update(item, row, false);
+    rows[row] = nullptr;
+    freeRows.push_back(row);
+    rowOf.erase(found);
+}
+
+void BitmapIndex::findCandidates(const ItemQuery& query, vector<const Item*>& candidates) const
+{
+    //conditions on slot or rating only hold for armor, and on damage only for weapons
+    unsigned int kindMask{ query.kinds != 0 ? query.kinds : 0x7u };
+    if (query.slots != 0 || query.hasRating)
+    {
+        kindMask &= 1u << static_cast<unsigned int>(ItemKind::Armor);
+    }
+    if (query.hasDamage)
+    {
+        kindMask &= 1u << static_cast<unsigned int>(ItemKind::Weapon);
+    }
+    if (kindMask == 0)
+    {
+        return;
+    }
+
+    //each condition is the bitmaps it accepts; the kind condition always comes first so every live row is covered
+    vector<vector<const CompressedBitmap*>> conditions(1);
+    for (unsigned int kind{ 0 }; kind < kinds.size(); kind++)
+    {
+        if (kindMask & (1u << kind))
+        {
+            conditions[0].push_back(&kinds[kind]);
+        }
+    }
+    if (query.slots != 0)
+    {
+        conditions.emplace_back();
+        for (unsigned int slotID{ 0 }; slotID < Armor::SLOT_COUNT; slotID++)
+        {
+            if (query.slots & (1u << slotID))
+            {
+                conditions.back().push_back(&slots[slotID]);
+            }
+        }
+    }
+    if (query.hasRating)
+    {
+        if (query.minimumRating > query.maximumRating)
+        {
+            return;
+        }
+        conditions.emplace_back();
+        addBuckets(conditions.back(), ratings, bucketOf(query.minimumRating), bucketOf(query.maximumRating));
+    }
+    if (query.hasDamage)
+    {
+        if (query.minimumDamage > query.maximumDamage)
+        {
+            return;
+        }
+        conditions.emplace_back();
+        addBuckets(conditions.back(), damages, bucketOf(query.minimumDamage), bucketOf(query.maximumDamage));
+    }
+    if (query.hasWeight)
+    {
+        if (!(query.minimumWeight <= query.maximumWeight))
+        {
+            return;
+        }
+        conditions.emplace_back();
+        addBuckets(conditions.back(), weights, bucketOf(query.minimumWeight), bucketOf(query.maximumWeight));
+    }
+
+    //evaluate one chunk at a time: OR within each condition, AND across them, a whole word per step
+    const size_t chunkCount{ (rows.size() + CompressedBitmap::CHUNK_ROWS - 1) / CompressedBitmap::CHUNK_ROWS };
+    CompressedBitmap::Chunk result;
+    CompressedBitmap::Chunk accepted;
+    for (size_t chunk{ 0 }; chunk < chunkCount; chunk++)
+    {
+        bool empty{ false };
+        for (size_t i{ 0 }; i < conditions.size() && !empty; i++)
+        {
+            accepted.fill(0);
+            bool found{ false };
+            for (const CompressedBitmap* bitmap : conditions[i])
+            {
+                const CompressedBitmap::Chunk* bits{ bitmap->getChunk(chunk) };
+                if (bits)
+                {
+                    found = true;
+                    for (size_t word{ 0 }; word < CompressedBitmap::CHUNK_WORDS; word++)
+                    {
+                        accepted[word] |= (*bits)[word];
+                    }
+                }
+            }
+
+            //a condition with nothing in this chunk rules the whole chunk out
+            uint64_t any{ 0 };
+            if (found)
+            {
+                for (size_t word{ 0 }; word < CompressedBitmap::CHUNK_WORDS; word++)
+                {
+                    result[word] = i == 0 ? accepted[word] : result[word] & accepted[word];
+                    any |= result[word];
+                }
+            }
+            empty = any == 0;
+        }
+        if (empty)
+        {
+            continue;
+        }
+
+        for (size_t word{ 0 }; word < CompressedBitmap::CHUNK_WORDS; word++)
+        {
+            for (uint64_t bits{ result[word] }; bits != 0; bits &= bits - 1)
+            {
+                candidates.push_back(rows[chunk * CompressedBitmap::CHUNK_ROWS + word * 64 + lowestBit(bits)]);
+            }
+        }
+    }
+}
+
+size_t BitmapIndex::getSize() const
+{
+    return rowOf.size();
+}
+
+void BitmapIndex::update(const Item& item, uint32_t row, bool isSet)
+{
+    auto apply{ [row, isSet](CompressedBitmap& bitmap)
+        {
+            if (isSet)
+            {
+                bitmap.set(row);
+            }
+            else
+            {
+                bitmap.reset(row);
+            }
+        } };
+
+    const ItemKind kind{ kindOf(item) };
+    apply(kinds[static_cast<unsigned int>(kind)]);
+    apply(weights[bucketOf(item.getWeight())]);
+    if (kind == ItemKind::Armor)
+    {
+        const Armor& armor{ static_cast<const Armor&>(item) };
+        apply(slots[armor.getSlotID()]);
+        apply(ratings[bucketOf(armor.getRating())]);
+    }
+    else if (kind == ItemKind::Weapon)
+    {
+        apply(damages[bucketOf(static_cast<const Weapon&>(item).getDamage())]);
+    }
+}
+
+unsigned int BitmapIndex::bucketOf(int value)
+{
+    return static_cast<unsigned int>(upper_bound(begin(VALUE_BUCKETS), end(VALUE_BUCKETS), value) - begin(VALUE_BUCKETS)) - 1;
+}
+
+unsigned int BitmapIndex::bucketOf(double weight)
+{
+    //a weight that isn't a number goes in the first bucket; it can never match a weight condition anyway
+    const auto bucket{ upper_bound(begin(WEIGHT_BUCKETS), end(WEIGHT_BUCKETS), weight) };
+    return bucket == begin(WEIGHT_BUCKETS) ? 0 : static_cast<unsigned int>(bucket - begin(WEIGHT_BUCKETS)) - 1;
+}
@@ -0,0 +1,96 @@
+#pragma once
+#include "Item.h"
+#include "Armor.h"
+#include "ItemQuery.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+// A set of row numbers kept as fixed-size chunks of bits, where a chunk with no rows set takes no
+// space at all.  Sparse bitmaps, such as one attribute value among many, stay small, while dense ones
+// are plain words that can be combined a whole word at a time.
+class CompressedBitmap
+{
+public:
+    // Each chunk covers this many consecutive rows.
+    static const std::size_t CHUNK_WORDS = 64;
+    static const std::size_t CHUNK_ROWS = CHUNK_WORDS * 64;
+
+    typedef std::array<std::uint64_t, CHUNK_WORDS> Chunk;
+
+    CompressedBitmap() = default;
+    CompressedBitmap(const CompressedBitmap& other);
+    CompressedBitmap& operator = (const CompressedBitmap& other);
+    CompressedBitmap(CompressedBitmap&& other) = default;
+    CompressedBitmap& operator = (CompressedBitmap&& other) = default;
+
+    // Adds a row to the set.
+    void set(std::uint32_t row);
+
+    // Removes a row from the set, freeing its chunk if it was the last row in it.
+    void reset(std::uint32_t row);
+
+    // Gets the chunk with this index, or nullptr if none of its rows are set.
+    const Chunk* getChunk(std::size_t index) const;
+
+    // Gets the number of chunks that take up space.
+    std::size_t getAllocatedChunkCount() const;
+
+private:
+    // A chunk and the number of rows set in it
+    struct Slot
+    {
+        std::unique_ptr<Chunk> bits;
+        std::uint32_t count{ 0 };
+    };
+
+    std::vector<Slot> chunks;
+};
+
+// Bitmap indexes over the attributes that an ItemQuery can test.
+//
+// Every item gets a row number, reused once the item is removed, and each attribute value has a
+// bitmap of the rows that hold it: one per kind and per armor slot, and one per bucket of ratings,
+// damage and weights.  A query is answered by ORing together the bitmaps each condition accepts and
+// ANDing the conditions, one chunk at a time.  Buckets only narrow a range down, so the rows found are
+// candidates that still need ItemQuery::matches().
+class BitmapIndex
+{
+public:
+    // The number of buckets each of rating, damage and weight is divided into.
+    static const unsigned int BUCKET_COUNT = 16;
+
+    // Adds an item, which must not already be in the index.
+    void add(const Item& item);
+
+    // Removes an item, which must be in the index.
+    void remove(const Item& item);
+
+    // Appends every item that might match the query, in no particular order.
+    void findCandidates(const ItemQuery& query, std::vector<const Item*>& candidates) const;
+
+    // Gets the number of items in the index.
+    std::size_t getSize() const;
+
+private:
+    // The item in each row; rows that were freed hold nullptr and are listed in freeRows
+    std::vector<const Item*> rows;
+    std::vector<std::uint32_t> freeRows;
+    std::unordered_map<const Item*, std::uint32_t> rowOf;
+
+    std::array<CompressedBitmap, 3> kinds;
+    std::array<CompressedBitmap, Armor::SLOT_COUNT> slots;
+    std::array<CompressedBitmap, BUCKET_COUNT> ratings;
+    std::array<CompressedBitmap, BUCKET_COUNT> damages;
+    std::array<CompressedBitmap, BUCKET_COUNT> weights;
+
+    // Sets or clears the item's bit in every bitmap that describes it
+    void update(const Item& item, std::uint32_t row, bool isSet);
+
+    // Gets the bucket a value falls into
+    static unsigned int bucketOf(int value);
+    static unsigned int bucketOf(double weight);
+};
@@ -0,0 +1,487 @@
+#include "CatalogImporter.h"
+#include "Armor.h"
+#include "Weapon.h"
+#include <stdexcept>
+#include <charconv>
+#include <optional>
+#include <array>
+#include <cmath>
+
+using namespace std;
+
+namespace
+{
+    //the fields of one catalog line, still as text
+    struct RawRecord
+    {
+        string_view kind;
+        string name;
+        optional<string_view> gold;
+        optional<string_view> weight;
+        optional<string_view> damage;
+        optional<string_view> slot;
+        optional<string_view> rating;
+    };
+
+    bool isSpace(char c)
+    {
+        return c == ' ' || c == '\t' || c == '\r';
+    }
+
+    string_view trim(string_view text)
+    {
+        while (!text.empty() && isSpace(text.front()))
+        {
+            text.remove_prefix(1);
+        }
+        while (!text.empty() && isSpace(text.back()))
+        {
+            text.remove_suffix(1);
+        }
+        return text;
+    }
+
+    //converts the whole of text to a number, throwing an exception naming the field if it can't
+    template <typename T>
+    T parseNumber(optional<string_view> text, const char* field)
+    {
+        if (!text)
+        {
+            throw runtime_error(string{ "missing " } + field);
+        }
+
+        T value{};
+        const char* end{ text->data() + text->size() };
+        const from_chars_result result{ from_chars(text->data(), end, value) };
+        if (result.ec != errc{} || result.ptr != end)
+        {
+            throw runtime_error(string{ "invalid " } + field + ": \"" + string{ *text } + "\"");
+        }
+        return value;
+    }
+
+    //builds the item a record describes, validating every field
+    unique_ptr<Item> createItem(RawRecord& record)
+    {
+        unique_ptr<Item> item;
+        if (record.kind == "item")
+        {
+            item = make_unique<Item>();
+        }
+        else if (record.kind == "weapon")
+        {
+            unique_ptr<Weapon> weapon{ make_unique<Weapon>() };
+            weapon->setDamage(parseNumber<int>(record.damage, "damage"));
+            item = move(weapon);
+        }
+        else if (record.kind == "armor")
+        {
+            //setSlotID throws out_of_range for a slot that doesn't exist
+            unique_ptr<Armor> armor{ make_unique<Armor>() };
+            armor->setSlotID(parseNumber<unsigned int>(record.slot, "slot"));
+            armor->setRating(parseNumber<int>(record.rating, "rating"));
+            item = move(armor);
+        }
+        else
+        {
+            throw runtime_error("unknown kind: \"" + string{ record.kind } + "\"");
+        }
+
+        //a weight that isn't a number would break the inventory's ordering
+        const double weight{ parseNumber<double>(record.weight, "weight") };
+        if (!isfinite(weight))
+        {
+            throw runtime_error("invalid weight: \"" + string{ *record.weight } + "\"");
+        }
+
+        item->setName(move(record.name));
+        item->setGoldValue(parseNumber<unsigned int>(record.gold, "gold"));
+        item->setWeight(weight);
+        return item;
+    }
+
+    unique_ptr<Item> parseCsv(string_view line)
+    {
+        //split the line into fields; a quoted field may hold commas and "" for a quote
+        array<string_view, 7> fields;
+        unsigned int quoted{ 0 };
+        size_t count{ 0 };
+        size_t position{ 0 };
+        while (true)
+        {
+            if (count == fields.size())
+            {
+                throw runtime_error("too many fields");
+            }
+
+            while (position < line.size() && isSpace(line[position]))
+            {
+                position++;
+            }
+
+            if (position < line.size() && line[position] == '"')
+            {
+                size_t close{ position + 1 };
+                while (close < line.size() && (line[close] != '"' || (close + 1 < line.size() && line[close + 1] == '"')))
+                {
+                    close += line[close] == '"' ? 2 : 1;
+                }
+                if (close >= line.size())
+                {
+                    throw runtime_error("unterminated quoted field");
+                }
+                fields[count] = line.substr(position + 1, close - position - 1);
+                quoted |= 1u << count;
+                position = close + 1;
+                while (position < line.size() && isSpace(line[position]))
+                {
+                    position++;
+                }
+                if (position < line.size() && line[position] != ',')
+                {
+                    throw runtime_error("unexpected text after a quoted field");
+                }
+            }
+            else
+            {
+                const size_t comma{ min(line.find(',', position), line.size()) };
+                fields[count] = trim(line.substr(position, comma - position));
+                position = comma;
+            }
+            count++;
+
+            if (position >= line.size())
+            {
+                break;
+            }
+            position++; //skip the comma
+        }
+
+        if (fields[0] == "kind" && !(quoted & 1))
+        {
+            return nullptr; //a header
+        }
+
+        RawRecord record;
+        record.kind = fields[0];
+        if (count < 4)
+        {
+            throw runtime_error("expected at least 4 fields, found " + to_string(count));
+        }
+        record.name = string{ fields[1] };
+        if (quoted & 2)
+        {
+            //collapse each "" to "
+            for (size_t i{ record.name.find("\"\"") }; i != string::npos; i = record.name.find("\"\"", i + 1))
+            {
+                record.name.erase(i, 1);
+            }
+        }
+        record.gold = fields[2];
+        record.weight = fields[3];
+
+        const size_t expected{ record.kind == "weapon" ? 5u : record.kind == "armor" ? 6u : 4u };
+        if (count != expected)
+        {
+            throw runtime_error("expected " + to_string(expected) + " fields for " + string{ record.kind } + ", found " + to_string(count));
+        }
+        if (record.kind == "weapon")
+        {
+            record.damage = fields[4];
+        }
+        else if (record.kind == "armor")
+        {
+            record.slot = fields[4];
+            record.rating = fields[5];
+        }
+
+        return createItem(record);
+    }
+
+    //reads a JSON string starting at the opening quote, decoding escapes into out
+    void readJsonString(string_view line, size_t& position, string& out)
+    {
+        position++; //skip the opening quote
+        while (true)
+        {
+            if (position >= line.size())
+            {
+                throw runtime_error("unterminated string");
+            }
+
+            const char c{ line[position++] };
+            if (c == '"')
+            {
+                return;
+            }
+            if (c != '\\')
+            {
+                out.push_back(c);
+                continue;
+            }
+
+            if (position >= line.size())
+            {
+                throw runtime_error("unterminated string");
+            }
+            const char escape{ line[position++] };
+            switch (escape)
+            {
+            case '"': out.push_back('"'); break;
+            case '\\': out.push_back('\\'); break;
+            case '/': out.push_back('/'); break;
+            case 'b': out.push_back('\b'); break;
+            case 'f': out.push_back('\f'); break;
+            case 'n': out.push_back('\n'); break;
+            case 'r': out.push_back('\r'); break;
+            case 't': out.push_back('\t'); break;
+            case 'u':
+            {
+                //a basic multilingual plane code point, written out as UTF-8
+                unsigned int codePoint{ 0 };
+                const char* begin{ line.data() + position };
+                if (position + 4 > line.size() || from_chars(begin, begin + 4, codePoint, 16).ptr != begin + 4)
+                {
+                    throw runtime_error("invalid \\u escape");
+                }
+                position += 4;
+                if (codePoint < 0x80)
+                {
+                    out.push_back(static_cast<char>(codePoint));
+                }
+                else if (codePoint < 0x800)
+                {
+                    out.push_back(static_cast<char>(0xC0 | (codePoint >> 6)));
+                    out.push_back(static_cast<char>(0x80 | (codePoint & 0x3F)));
+                }
+                else
+                {
+                    out.push_back(static_cast<char>(0xE0 | (codePoint >> 12)));
+                    out.push_back(static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F)));
+                    out.push_back(static_cast<char>(0x80 | (codePoint & 0x3F)));
+                }
+                break;
+            }
+            default:
+                throw runtime_error(string{ "invalid escape: \\" } + escape);
+            }
+        }
+    }
+
+    unique_ptr<Item> parseJson(string_view line)
+    {
+        size_t position{ 0 };
+        auto skipSpace{ [&line, &position]()
+            {
+                while (position < line.size() && (isSpace(line[position]) || line[position] == '\n'))
+                {
+                    position++;
+                }
+            } };
+        auto expect{ [&line, &position](char c)
+            {
+                if (position >= line.size() || line[position] != c)
+                {
+                    throw runtime_error(string{ "expected '" } + c + "' at column " + to_string(position + 1));
+                }
+                position++;
+            } };
+
+        RawRecord record;
+        string kind;
+        string key;
+        bool hasKind{ false };
+        bool hasName{ false };
+
+        skipSpace();
+        expect('{');
+        skipSpace();
+        bool first{ true };
+        while (position < line.size() && line[position] != '}')
+        {
+            if (!first)
+            {
+                expect(',');
+                skipSpace();
+            }
+            first = false;
+
+            key.clear();
+            if (position >= line.size() || line[position] != '"')
+            {
+                throw runtime_error("expected a key at column " + to_string(position + 1));
+            }
+            readJsonString(line, position, key);
+            skipSpace();
+            expect(':');
+            skipSpace();
+
+            //string values are decoded; anything else is kept as the raw token for from_chars
+            if (position < line.size() && line[position] == '"')
+            {
+                string value;
+                readJsonString(line, position, value);
+                if (key == "kind")
+                {
+                    kind = move(value);
+                    hasKind = true;
+                }
+                else if (key == "name")
+                {
+                    record.name = move(value);
+                    hasName = true;
+                }
+                else if (key == "gold" || key == "weight" || key == "damage" || key == "slot" || key == "rating")
+                {
+                    throw runtime_error(key + " must be a number");
+                }
+            }
+            else
+            {
+                const size_t start{ position };
+                while (position < line.size() && line[position] != ',' && line[position] != '}' && !isSpace(line[position]))
+                {
+                    if (line[position] == '{' || line[position] == '[')
+                    {
+                        throw runtime_error("nested values are not supported");
+                    }
+                    position++;
+                }
+                const string_view token{ line.substr(start, position - start) };
+                if (token.empty())
+                {
+                    throw runtime_error("expected a value at column " + to_string(start + 1));
+                }
+
+                if (key == "gold")
+                {
+                    record.gold = token;
+                }
+                else if (key == "weight")
+                {
+                    record.weight = token;
+                }
+                else if (key == "damage")
+                {
+                    record.damage = token;
+                }
+                else if (key == "slot")
+                {
+                    record.slot = token;
+                }
+                else if (key == "rating")
+                {
+                    record.rating = token;
+                }
+                else if (key == "kind" || key == "name")
+                {
+                    throw runtime_error(key + " must be a string");
+                }
+            }
+            skipSpace();
+        }
+        expect('}');
+        skipSpace();
+        if (position != line.size())
+        {
+            throw runtime_error("unexpected text after the object");
+        }
+
+        if (!hasKind)
+        {
+            throw runtime_error("missing kind");
+        }
+        if (!hasName)
+        {
+            throw runtime_error("missing name");
+        }
+        record.kind = kind;
+        return createItem(record);
+    }
+}
+
+CatalogFormat CatalogImporter::formatOf(const string& path)
+{
+    auto endsWith{ [&path](const string& suffix)
+        {
+            return path.size() >= suffix.size() && path.compare(path.size() - suffix.size(), suffix.size(), suffix) == 0;
+        } };
+
+    if (endsWith(".csv"))
+    {
+        return CatalogFormat::Csv;
+    }
+    if (endsWith(".jsonl") || endsWith(".ndjson"))
+    {
+        return CatalogFormat::JsonLines;
+    }
+    throw runtime_error("unknown catalog format: " + path);
+}
+
+CatalogImport CatalogImporter::read(istream& in, CatalogFormat format)
+{
+    CatalogImport result;
+
+    auto handleLine{ [&result, format](string_view line)
+        {
+            result.lineCount++;
+            try
+            {
+                unique_ptr<Item> item{ parseLine(line, format) };
+                if (item)
+                {
+                    result.items.push_back(move(item));
+                }
+            }
+            catch (const exception& e)
+            {
+                //report the line and carry on with the next one
+                result.errors.push_back(CatalogError{ result.lineCount, e.what() });
+            }
+        } };
+
+    //read large chunks and parse whole lines straight out of the buffer; only a line split
+    //across two chunks is copied
+    vector<char> chunk(1 << 20);
+    string partial;
+    while (in.read(chunk.data(), static_cast<streamsize>(chunk.size())) || in.gcount() > 0)
+    {
+        const string_view data{ chunk.data(), static_cast<size_t>(in.gcount()) };
+        size_t start{ 0 };
+        for (size_t newline{ data.find('\n') }; newline != string_view::npos; newline = data.find('\n', start))
+        {
+            if (partial.empty())
+            {
+                handleLine(data.substr(start, newline - start));
+            }
+            else
+            {
+                partial.append(data.data() + start, newline - start);
+                handleLine(partial);
+                partial.clear();
+            }
+            start = newline + 1;
+        }
+        partial.append(data.data() + start, data.size() - start);
+    }
+
+    //the last line may not end with a line break
+    if (!partial.empty())
+    {
+        handleLine(partial);
+    }
+
+    return result;
+}
+
+unique_ptr<Item> CatalogImporter::parseLine(string_view line, CatalogFormat format)
+{
+    //skip blank lines and comments
+    const string_view content{ trim(line) };
+    if (content.empty() || content.front() == '#')
+    {
+        return nullptr;
+    }
+
+    return format == CatalogFormat::Csv ? parseCsv(content) : parseJson(content);
+}
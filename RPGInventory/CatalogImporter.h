@@ -0,0 +1,67 @@
+#pragma once
+#include "Item.h"
+#include <cstddef>
+#include <istream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// The file formats an item catalog can be written in.
+//
+// Csv: one item per line as kind,name,gold,weight followed by damage for a weapon or slot,rating for
+// armor, where kind is item, weapon or armor.  A name containing commas or quotes is written in double
+// quotes, with "" for a quote.  A line whose first field is "kind" is a header and is skipped.
+//
+// JsonLines: one flat JSON object per line with the keys "kind", "name", "gold", "weight", and
+// "damage" for a weapon or "slot" and "rating" for armor.  Other keys are ignored.
+//
+// In both formats blank lines and lines starting with # are skipped.
+enum class CatalogFormat
+{
+    Csv,
+    JsonLines
+};
+
+// A line of a catalog that couldn't be imported.
+struct CatalogError
+{
+    // The line number, starting at 1
+    std::size_t line;
+
+    // What was wrong with the line
+    std::string message;
+};
+
+// The result of reading a catalog.
+struct CatalogImport
+{
+    // The items read, in file order, ready for Character::addItems()
+    std::vector<std::unique_ptr<Item>> items;
+
+    // One entry per line that couldn't be imported
+    std::vector<CatalogError> errors;
+
+    // The number of lines read
+    std::size_t lineCount{ 0 };
+};
+
+// Reads item catalogs in bulk.  The input is streamed in large chunks and parsed in place, with
+// numbers converted by from_chars, so memory use is bounded by the items rather than the file.
+// A bad line is reported and skipped; it doesn't stop the import.
+class CatalogImporter
+{
+public:
+    // Gets the format of a catalog from its file extension: .csv, or .jsonl or .ndjson.
+    // A runtime_error is thrown for any other extension.
+    static CatalogFormat formatOf(const std::string& path);
+
+    // Reads every item in the catalog.
+    static CatalogImport read(std::istream& in, CatalogFormat format);
+
+    // Parses one line of a catalog, which must not include the line break.
+    // Returns a null pointer for a line with no item (blank, comment, or header).
+    // A runtime_error is thrown if the line is malformed, and an out_of_range exception if an armor
+    // slot ID is not 0, 1, 2, 3, 4, or 5, as Armor::setSlotID() does.
+    static std::unique_ptr<Item> parseLine(std::string_view line, CatalogFormat format);
+};
@@ -2,21 +2,56 @@
 #include "Item.h"
 #include "Armor.h"
 #include "Weapon.h"
+#include "ItemKind.h"
 #include <stdexcept>
 #include <memory>
 #include <array>
+#include <vector>
 
 using namespace std;
 
-const Collection<const Item>& Character::getInventory()
+const Inventory& Character::getInventory()
 {
     return inventory;
 }
 
-void Character::addItem(const Item& item)
+const Inventory& Character::getInventory() const
+{
+    return inventory;
+}
+
+vector<ItemPtr<Item>> Character::addItem(const Item& item)
 {
     // TODO: Implement this function.
     inventory.addItem(item);
+    return evictOverCapacity();
+}
+
+vector<ItemPtr<Item>> Character::addItem(Item&& item)
+{
+    inventory.addItem(move(item));
+    return evictOverCapacity();
+}
+
+vector<ItemPtr<Item>> Character::addItem(unique_ptr<Item> item)
+{
+    inventory.addItem(ItemPtr<Item>{ move(item) });
+    return evictOverCapacity();
+}
+
+vector<ItemPtr<Item>> Character::addItems(vector<unique_ptr<Item>> items)
+{
+    //the caller gives up the objects, so nothing outside the inventory can change a stored item
+    vector<ItemPtr<Item>> owned;
+    owned.reserve(items.size());
+    for (auto& item : items)
+    {
+        owned.emplace_back(move(item));
+    }
+
+    //in capacity mode, evict once for the whole set
+    inventory.addItems(move(owned));
+    return evictOverCapacity();
 }
 
 void Character::dropItem(const Item& item)
@@ -30,34 +65,20 @@ void Character::dropItem(const Item& item)
     }
 }
 
-double Character::getTotalWeight() const
+void Character::dropItem(const ItemKey& key)
 {
-    // TODO: Implement this function.
-    //total weight of the character
-    double weight{ 0 }; 
-
-    //add up the weight in the inventory to weight
-    inventory.forEach([&weight](Item item) 
-        {
-            weight += item.getWeight();
-        });
-
-    //add up the weight in the equipped armor to weight
-    for (auto element : equippedArmor) 
+    //if no item matches the key throw a logic_error
+    if (!inventory.dropItem(key))
     {
-        if (element)
-        {
-            weight += element->getWeight();
-        }
-    }
-
-    //add the weight of the equipped weapon to weight
-    if (equippedWeapon) 
-    {
-        weight += equippedWeapon->getWeight();
+        throw logic_error("item not found in inventory");
     }
+}
 
-    return weight;
+double Character::getTotalWeight() const
+{
+    // TODO: Implement this function.
+    //total weight of the character, from the running totals kept by the inventory and the equipment
+    return inventory.getTotalWeight() + equipment.getTotalWeight();
 }
 
 const Armor* Character::getEquippedArmor(unsigned int slotID) const
@@ -70,46 +91,34 @@ const Armor* Character::getEquippedArmor(unsigned int slotID) const
     }
 
     //return the corresponding armor at slotID
-    return equippedArmor[slotID].get(); 
+    return equipment.getArmor(slotID); 
 }
 
-unsigned int Character::getTotalArmorRating() const
+int Character::getTotalArmorRating() const
 {
     // TODO: Implement this function.
-    //total rating of the equipped armor
-    unsigned int rating{ 0 }; 
-
-    //iterate the equipped armor
-    for (auto element : equippedArmor) 
-    {
-        //if the armor piece is equipped, add up the rating to rating
-        if (element) 
-        {
-            rating += element->getRating();
-        }
-    }
+    //the total is kept up to date by equipArmor and unequipArmor
+    return equipment.getTotalArmorRating();
+}
 
-    return rating;
+unsigned int Character::getEquippedArmorMask() const
+{
+    //the mask is kept up to date by equipArmor and unequipArmor
+    return equipment.getArmorMask();
 }
 
 void Character::equipArmor(const Armor& armor)
 {
     // TODO: Implement this function.
-    //tempArmor points to the location of armor
-    shared_ptr<Armor> tempArmor{ armor.clone() }; 
-
-    //removes armor from inventory
+    //removes armor from inventory and takes over the inventory's own object, so nothing is copied
     //if armor does not exist in inventory throw a logic_error
-    if (!inventory.dropItem(armor))
-    {
-        throw logic_error("item not found in inventory");
-    }
-
-    //unequip the current armor at slotID
-    unequipArmor(tempArmor->getSlotID());
+    equipTaken(staticItemCast<Armor>(inventory.takeItem(armor)));
+}
 
-    //equip tempArmor to the corresponding slotID
-    equippedArmor[tempArmor->getSlotID()] = tempArmor; 
+void Character::equipArmor(const ItemKey& key)
+{
+    //only an armor key can describe armor, so any other key finds nothing
+    equipTaken(key.getKind() == ItemKind::Armor ? staticItemCast<Armor>(inventory.takeItem(key)) : nullptr);
 }
 
 void Character::unequipArmor(unsigned int slotID)
@@ -121,11 +130,11 @@ void Character::unequipArmor(unsigned int slotID)
         throw out_of_range("slotID should be between 0-5");
     }
 
-    //if an armor piece exists at slotID return it to the inventory and set equippedArmor at slotID to nullptr
-    if (equippedArmor[slotID]) 
+    //if an armor piece exists at slotID hand it back to the inventory
+    ItemPtr<Armor> removed{ equipment.unequipArmor(slotID) };
+    if (removed) 
     {
-        inventory.addItem(*(equippedArmor[slotID]));
-        equippedArmor[slotID].reset();
+        inventory.addItem(move(removed));
     }
 } 
 
@@ -133,37 +142,31 @@ const Weapon* Character::getEquippedWeapon() const
 {
     // TODO: Implement this function.
     //return a pointer to the equipped weapon
-    return equippedWeapon.get(); 
+    return equipment.getWeapon(); 
 }
 
 void Character::equipWeapon(const Weapon& weapon)
 {
     // TODO: Implement this function.
-    //tempWeapon points to the location of weapon
-    shared_ptr<Weapon> tempWeapon{ weapon.clone() }; 
-
-    //removes weapon from inventory
+    //removes weapon from inventory and takes over the inventory's own object, so nothing is copied
     //if weapon does not exist in inventory throw a logic_error
-    if (!inventory.dropItem(weapon))
-    {
-        throw logic_error("item not found in inventory");
-    }
-
-    //unequip the weapon
-    unequipWeapon();
+    equipTaken(staticItemCast<Weapon>(inventory.takeItem(weapon)));
+}
 
-    //equip tempWeapon
-    equippedWeapon = tempWeapon; 
+void Character::equipWeapon(const ItemKey& key)
+{
+    //only a weapon key can describe a weapon, so any other key finds nothing
+    equipTaken(key.getKind() == ItemKind::Weapon ? staticItemCast<Weapon>(inventory.takeItem(key)) : nullptr);
 }
 
 void Character::unequipWeapon()
 {
     // TODO: Implement this function.
-    //if a weapon exists return it to the inventory and set equippedWeapon to nullptr
-    if (equippedWeapon) 
+    //if a weapon exists hand it back to the inventory
+    ItemPtr<Weapon> removed{ equipment.unequipWeapon() };
+    if (removed) 
     {
-        inventory.addItem(*equippedWeapon);
-        equippedWeapon.reset();
+        inventory.addItem(move(removed));
     }
 }
 
@@ -176,18 +179,103 @@ void Character::optimizeInventory(double maximumWeight)
         throw out_of_range("maximum weight cannot be less than zero");
     }
 
+    dropUntilWeight(maximumWeight);
+}
+
+vector<ItemPtr<Item>> Character::setWeightCapacity(double maximumWeight)
+{
+    //if maximumWeight is less than 0 throw an out_of_range exception
+    if (maximumWeight < 0)
+    {
+        throw out_of_range("maximum weight cannot be less than zero");
+    }
+
+    weightCapacity = maximumWeight;
+
+    //the character may already be over the new capacity
+    return dropUntilWeight(weightCapacity);
+}
+
+void Character::clearWeightCapacity()
+{
+    weightCapacity = -1.0;
+}
+
+bool Character::hasWeightCapacity() const
+{
+    return weightCapacity >= 0;
+}
+
+double Character::getWeightCapacity() const
+{
+    return weightCapacity;
+}
+
+vector<ItemPtr<Item>> Character::dropUntilWeight(double maximumWeight)
+{
+    vector<ItemPtr<Item>> dropped;
+
     //while inventory has more weight than maximumWeight and the inventory is not empty, remove the last item
     //remember the inventory is already sorted in descending order of value to weight ratio
+    //getTotalWeight() is O(1), so each eviction only costs the removal itself; the totals are exact, so
+    //the same items always give the same decision however they got there
     while (maximumWeight < getTotalWeight() && inventory.getSize() != 0) 
     {
-        inventory.dropLastItem();
+        dropped.push_back(inventory.dropLastItem());
+    }
+
+    return dropped;
+}
+
+vector<ItemPtr<Item>> Character::evictOverCapacity()
+{
+    //in capacity mode, evict the lowest value to weight items until the character fits again
+    if (hasWeightCapacity())
+    {
+        return dropUntilWeight(weightCapacity);
+    }
+
+    return {};
+}
+
+void Character::equipTaken(ItemPtr<Armor> armor)
+{
+    //the armor is the inventory's own object, so nothing is copied
+    //if no armor was taken throw a logic_error
+    if (!armor)
+    {
+        throw logic_error("item not found in inventory");
+    }
+
+    //equip the armor to the corresponding slotID and return the armor it replaced to the inventory
+    ItemPtr<Armor> replaced{ equipment.equipArmor(move(armor)) };
+    if (replaced)
+    {
+        inventory.addItem(move(replaced));
+    }
+}
+
+void Character::equipTaken(ItemPtr<Weapon> weapon)
+{
+    //the weapon is the inventory's own object, so nothing is copied
+    //if no weapon was taken throw a logic_error
+    if (!weapon)
+    {
+        throw logic_error("item not found in inventory");
+    }
+
+    //equip the weapon and return the weapon it replaced to the inventory
+    ItemPtr<Weapon> replaced{ equipment.equipWeapon(move(weapon)) };
+    if (replaced)
+    {
+        inventory.addItem(move(replaced));
     }
 }
 
 void Character::optimizeEquipment()
 {
     // TODO: Implement this function.
-    std::shared_ptr<Weapon> bestInventoryWeapon{ inventory.findBestWeapon() }; //assign the result of the findBestWeapon to bestInventoryWeapon
+    ItemPtr<Weapon> bestInventoryWeapon{ inventory.findBestWeapon() }; //assign the result of the findBestWeapon to bestInventoryWeapon
 
     //if there is no equiped weapon, equip bestInventoryWeapon
     //if bestInventoryWeapon has more damage than the equipedWeapon, equip bestInventoryWeapon
@@ -197,12 +285,12 @@ void Character::optimizeEquipment()
         equipWeapon(*bestInventoryWeapon);
     }
 
-    std::array<std::shared_ptr<Armor>, 6> bestInventoryArmor{ inventory.findBestArmor() }; //assign the result of the findBestArmor to bestInventoryArmor
+    std::array<ItemPtr<Armor>, 6> bestInventoryArmor{ inventory.findBestArmor() }; //assign the result of the findBestArmor to bestInventoryArmor
 
     //if there is no equiped armor at slotID, equip bestInventoryArmor at slotID
     //if bestInventoryArmor at slotID has more rating than the equipedArmor at slotID, equip bestInventoryArmor at slotID
     //if bestInventoryArmor at slotID has less damage than the equipedArmor at slotID, do nothing
-    for (auto element : bestInventoryArmor)
+    for (const auto& element : bestInventoryArmor)
     {
         if (element && (getEquippedArmor(element->getSlotID()) == nullptr || element->getRating() > getEquippedArmor(element->getSlotID())->getRating()))
         {
@@ -212,6 +300,98 @@ void Character::optimizeEquipment()
 
 }
 
+Character::Batch& Character::Batch::addItem(const Item& item)
+{
+    //keep a private copy of the pattern; the inventory is added to directly so capacity mode waits for the end of the batch
+    ItemPtr<const Item> pattern{ visitItem(item, [](const auto& concrete) { return ItemPtr<const Item>{ cloneShared(concrete) }; }) };
+    operations.push_back([pattern](Character& character) { character.inventory.addItem(*pattern); });
+    return *this;
+}
+
+Character::Batch& Character::Batch::dropItem(const Item& item)
+{
+    ItemPtr<const Item> pattern{ visitItem(item, [](const auto& concrete) { return ItemPtr<const Item>{ cloneShared(concrete) }; }) };
+    operations.push_back([pattern](Character& character) { character.dropItem(*pattern); });
+    return *this;
+}
+
+Character::Batch& Character::Batch::equipArmor(const Armor& armor)
+{
+    ItemPtr<const Armor> pattern{ cloneShared(armor) };
+    operations.push_back([pattern](Character& character) { character.equipArmor(*pattern); });
+    return *this;
+}
+
+Character::Batch& Character::Batch::unequipArmor(unsigned int slotID)
+{
+    operations.push_back([slotID](Character& character) { character.unequipArmor(slotID); });
+    return *this;
+}
+
+Character::Batch& Character::Batch::equipWeapon(const Weapon& weapon)
+{
+    ItemPtr<const Weapon> pattern{ cloneShared(weapon) };
+    operations.push_back([pattern](Character& character) { character.equipWeapon(*pattern); });
+    return *this;
+}
+
+Character::Batch& Character::Batch::unequipWeapon()
+{
+    operations.push_back([](Character& character) { character.unequipWeapon(); });
+    return *this;
+}
+
+Character::Batch& Character::Batch::optimizeInventory(double maximumWeight)
+{
+    operations.push_back([maximumWeight](Character& character) { character.optimizeInventory(maximumWeight); });
+    return *this;
+}
+
+Character::Batch& Character::Batch::optimizeEquipment()
+{
+    operations.push_back([](Character& character) { character.optimizeEquipment(); });
+    return *this;
+}
+
+unsigned int Character::Batch::getSize() const
+{
+    return static_cast<unsigned int>(operations.size());
+}
+
+vector<ItemPtr<Item>> Character::apply(const Batch& batch)
+{
+    //remember the equipment and record every inventory change, so the whole batch can be undone
+    Equipment equipmentBefore{ equipment };
+    inventory.beginTransaction();
+
+    vector<ItemPtr<Item>> evicted;
+    try
+    {
+        //each operation runs through the normal path; keeping the indexes up to date step by step is
+        //cheaper than rebuilding them, and hinted inserts beat a merged bulk insert at these sizes
+        for (const auto& operation : batch.operations)
+        {
+            operation(*this);
+        }
+
+        //in capacity mode, evict once for the whole batch
+        if (hasWeightCapacity())
+        {
+            evicted = dropUntilWeight(weightCapacity);
+        }
+    }
+    catch (...)
+    {
+        //put the character back exactly as it was and let the caller see the original exception
+        inventory.rollbackTransaction();
+        equipment = move(equipmentBefore);
+        throw;
+    }
+
+    inventory.commitTransaction();
+    return evicted;
+}
+
 std::ostream& operator<<(std::ostream& out, const Character& character)
 {
     // TODO: insert return statement here
@@ -233,11 +413,11 @@ std::ostream& operator<<(std::ostream& out, const Character& character)
     //prints out each currently equipped armor piece in its corresponding slotID
     //else prints out that no armor piece exists at slotID
     out << "\n" << "Equipped Armor:" << "\n";
-    for (size_t i{ 0 }; i < character.equippedArmor.size(); i++)
+    for (unsigned int i{ 0 }; i < Armor::SLOT_COUNT; i++)
     {
-        if (character.equippedArmor[i])
+        if (character.equipment.getArmor(i))
         {
-            out << *character.equippedArmor[i] << "\n";
+            out << *character.equipment.getArmor(i) << "\n";
         }
         else
         {
@@ -274,9 +454,9 @@ std::ostream& operator<<(std::ostream& out, const Character& character)
     //prints out the currently equipped weapon
     //else prints out that no weapon is equipped
     out << "\n" << "Equipped Weapon:" << "\n";
-    if (character.equippedWeapon)
+    if (character.equipment.getWeapon())
     {
-        out << *character.equippedWeapon << "\n";
+        out << *character.equipment.getWeapon() << "\n";
     }
     else
     {
@@ -1,11 +1,15 @@
 #pragma once
 #include "Item.h"
+#include "ItemPtr.h"
 #include "Armor.h"
 #include "Weapon.h"
 #include "Collection.h"
 #include "Inventory.h"
+#include "Equipment.h"
 #include <array>
 #include <memory>
+#include <vector>
+#include <functional>
 
 // A class for keeping track of the equipped items and inventory of a character in a role-playing game.
 class Character
@@ -22,16 +26,39 @@ public:
 
     // Returns an implementation of the Collection interface that provides read-only access to
     // the items in the characters inventory (that is, items that are not equipped as armor or a
-    // weapon).  The items should be sorted in descending value-to-weight ratio.
-    const Collection<const Item>& getInventory();
+    // weapon).  The items should be sorted in descending value-to-weight ratio.  The Inventory itself
+    // is returned so that its read-only queries (pages, ranges and name searches) can be used too.
+    const Inventory& getInventory();
+
+    // Read-only access to the inventory of a const character.
+    const Inventory& getInventory() const;
 
     // Adds a copy of the specified item to the inventory.  In other words, the Item passed in is
     // the pattern for a new item that should be created and added to the inventory.
-    void addItem(const Item& item);
+    // If a weight capacity is set, items are evicted by the same rules as optimizeInventory() until
+    // the total weight fits again, and the evicted items are returned (possibly including the new one).
+    std::vector<ItemPtr<Item>> addItem(const Item& item);
+
+    // Like addItem(const Item&), but moves an item the caller no longer needs, such as a temporary,
+    // so its name is taken over instead of copied.
+    std::vector<ItemPtr<Item>> addItem(Item&& item);
+
+    // Like addItem(const Item&), but the item object itself goes into the inventory; no copy is made.
+    std::vector<ItemPtr<Item>> addItem(std::unique_ptr<Item> item);
+
+    // Adds many item objects at once; like addItem(std::unique_ptr<Item>), the objects themselves go
+    // into the inventory and no copies are made.  The inventory is built in one bulk insert, and in
+    // capacity mode the evictions happen once at the end, as for a Batch.  The evicted items are
+    // returned.
+    std::vector<ItemPtr<Item>> addItems(std::vector<std::unique_ptr<Item>> items);
 
     // Searches for and removes the specified item from the inventory.  
     // A logic_error should be thrown if the item cannot be found in the inventory.
     void dropItem(const Item& item);
+
+    // Drops the first item in the inventory that the key describes, without building an item to compare with.
+    // A logic_error is thrown if no such item is in the inventory.
+    void dropItem(const ItemKey& key);
     
     // Returns the total weight of all items, whether equipped or in the inventory.
     double getTotalWeight() const;
@@ -41,8 +68,11 @@ public:
     const Armor* getEquippedArmor(unsigned int slotID) const;
 
     // Gets the sum of the armor rating values over all equipped armor pieces.  
-    // Armor in the inventory doesnt count towards this sum.
-    unsigned int getTotalArmorRating() const;
+    // Armor in the inventory doesnt count towards this sum.  The sum is signed since ratings may be negative.
+    int getTotalArmorRating() const;
+
+    // Gets a bitmask of the occupied armor slots: bit N is set if armor is equipped in slot N.
+    unsigned int getEquippedArmorMask() const;
 
     // Searches the inventory for a specific armor piece, removes it from the inventory, and equips
     // it in its specified armor slot.  If there is already a piece of armor in the required slot, 
@@ -51,6 +81,10 @@ public:
     // A logic_error should be thrown if the piece of armor cannot be found in the inventory.
     void equipArmor(const Armor& armor);
 
+    // Like equipArmor(const Armor&), but finds the armor by its key.
+    // A logic_error is thrown if the key isn't for armor or no such armor is in the inventory.
+    void equipArmor(const ItemKey& key);
+
     // Unequips the piece of armor in the specified slot and returns it to the inventory.  
     // If no armor is equipped in that slot, this function has no effect.  
     // An out_of_range exception should be thrown if slotID is not 0, 1, 2, 3, 4, or 5.
@@ -65,6 +99,10 @@ public:
     // in the inventory.  A logic_error should be thrown if the weapon cannot be found.
     void equipWeapon(const Weapon& weapon);
 
+    // Like equipWeapon(const Weapon&), but finds the weapon by its key.
+    // A logic_error is thrown if the key isn't for a weapon or no such weapon is in the inventory.
+    void equipWeapon(const ItemKey& key);
+
     // Unequips the currently equipped weapon and returns it to the inventory.  
     // If no weapon is equipped, this function has no effect.
     void unequipWeapon();
@@ -79,22 +117,102 @@ public:
     // An out_of_range exception should be thrown if maximumWeight is less than zero.
     void optimizeInventory(double maximumWeight);
 
+    // Puts the character in capacity mode: from now on every addItem() evicts the lowest value to
+    // weight items until the total weight is no more than maximumWeight again.  Items over the new
+    // capacity are evicted immediately and returned.
+    // An out_of_range exception should be thrown if maximumWeight is less than zero.
+    std::vector<ItemPtr<Item>> setWeightCapacity(double maximumWeight);
+
+    // Leaves capacity mode; addItem() no longer evicts anything.
+    void clearWeightCapacity();
+
+    // Returns true if a weight capacity is currently enforced.
+    bool hasWeightCapacity() const;
+
+    // Gets the enforced weight capacity.  Only meaningful if hasWeightCapacity() returns true.
+    double getWeightCapacity() const;
+
     // Optimizes the currently equipped weapons and armor by equipping the weapon with the highest
     // damage rating and the armor piece with the highest armor rating for each armor slot.
     // Any previously equipped weapon or armor that is no longer optimal is returned to the inventory.
     void optimizeEquipment();
 
+    // Records a sequence of mutations to apply to a character all at once with Character::apply().
+    // Items passed in are copied as they are recorded, so the originals may change or go away afterwards.
+    // A batch may be applied any number of times, to any number of characters.
+    class Batch
+    {
+    public:
+        // Records an addItem() call.
+        Batch& addItem(const Item& item);
+
+        // Records a dropItem() call.
+        Batch& dropItem(const Item& item);
+
+        // Records an equipArmor() call.
+        Batch& equipArmor(const Armor& armor);
+
+        // Records an unequipArmor() call.
+        Batch& unequipArmor(unsigned int slotID);
+
+        // Records an equipWeapon() call.
+        Batch& equipWeapon(const Weapon& weapon);
+
+        // Records an unequipWeapon() call.
+        Batch& unequipWeapon();
+
+        // Records an optimizeInventory() call.
+        Batch& optimizeInventory(double maximumWeight);
+
+        // Records an optimizeEquipment() call.
+        Batch& optimizeEquipment();
+
+        // Gets the number of recorded operations.
+        unsigned int getSize() const;
+
+    private:
+        friend class Character;
+
+        // The recorded operations, in the order they should be applied
+        std::vector<std::function<void(Character&)>> operations;
+    };
+
+    // Applies every operation recorded in the batch, in order.  Each operation goes through the same
+    // path as the individual call, updating the inventory's order, totals and built indexes as it goes,
+    // so a batch is atomic rather than faster: it costs what the calls would, plus recording the undo
+    // log.  In capacity mode, evictions happen once after the last operation rather than after every
+    // add, and the evicted items are returned.  
+    // If any operation throws (a logic_error or out_of_range, as the individual calls would), every 
+    // change made by the batch is undone and the exception is rethrown, leaving the character as it was.
+    std::vector<ItemPtr<Item>> apply(const Batch& batch);
+
     friend std::ostream& operator<< (std::ostream& out, const Character& character);
 
+    friend class CharacterSerializer;
+    friend class CharacterImage;
+    friend class CharacterSnapshot;
+
 private:
     // The instance of the inventory class, which will hold items not currently equipped.
     Inventory inventory {};
 
     // TODO: Add your own private variables here:
 
-    // Holds the armor currently equiped
-    std::array<std::shared_ptr<Armor>, 6> equippedArmor;
+    // Holds the armor and weapon currently equiped, along with their cached rating, slot mask and weight
+    Equipment equipment;
+
+    // Maximum total weight enforced on every addItem, or a negative value if capacity mode is off
+    double weightCapacity{ -1.0 };
+
+    // Drops the lowest value to weight items until the total weight is no more than maximumWeight
+    // and returns the dropped items; shared by optimizeInventory and capacity mode
+    std::vector<ItemPtr<Item>> dropUntilWeight(double maximumWeight);
+
+    // In capacity mode, evicts items until the character fits again after an add, and returns them
+    std::vector<ItemPtr<Item>> evictOverCapacity();
 
-    // Holds the weapon currently equiped
-    std::shared_ptr<Weapon> equippedWeapon;
+    // Equips armor or a weapon just taken out of the inventory, returning whatever it replaces to the
+    // inventory; a logic_error is thrown if nothing was found to take
+    void equipTaken(ItemPtr<Armor> armor);
+    void equipTaken(ItemPtr<Weapon> weapon);
 };
\ No newline at end of file
@@ -0,0 +1,81 @@
+#include "CharacterFormatter.h"
+#include "TextFormat.h"
+#include "ItemKind.h"
+
+using namespace std;
+
+namespace
+{
+    //the text for an empty armor slot, by slot ID
+    const char* const EMPTY_SLOT_LINES[Armor::SLOT_COUNT]
+    {
+        "There is no equipped armor for the chest slot.\n",
+        "There is no equipped armor for the legs slot.\n",
+        "There is no equipped armor for the hands slot.\n",
+        "There is no equipped armor for the feet slot.\n",
+        "There is no equipped armor for the head slot.\n",
+        "There is no equipped armor for the shield slot.\n",
+    };
+}
+
+void CharacterFormatter::appendTo(const Character& character, string& out)
+{
+    //the same layout as operator<< for Character
+    out.append("\nInventory:\n");
+    if (character.getInventory().getSize())
+    {
+        character.getInventory().forEach([&out](const Item& item)
+            {
+                visitItem(item, [&out](const auto& concrete) { appendExact(concrete, out); });
+                out.push_back('\n');
+            });
+    }
+    else
+    {
+        out.append("There are no items in the inventory\n");
+    }
+
+    out.append("\nEquipped Armor:\n");
+    for (unsigned int slotID{ 0 }; slotID < Armor::SLOT_COUNT; slotID++)
+    {
+        if (character.getEquippedArmor(slotID))
+        {
+            character.getEquippedArmor(slotID)->appendTo(out);
+            out.push_back('\n');
+        }
+        else
+        {
+            out.append(EMPTY_SLOT_LINES[slotID]);
+        }
+    }
+
+    out.append("\nTotal armor rating: ");
+    appendNumber(out, character.getTotalArmorRating());
+    out.append("\n\nEquipped Weapon:\n");
+    if (character.getEquippedWeapon())
+    {
+        character.getEquippedWeapon()->appendTo(out);
+        out.push_back('\n');
+    }
+    else
+    {
+        out.append("There is no equipped weapon.\n");
+    }
+
+    out.append("\nTotal weight: ");
+    appendNumber(out, character.getTotalWeight());
+    out.push_back('\n');
+}
+
+const string& CharacterFormatter::format(const Character& character)
+{
+    buffer.clear();
+    appendTo(character, buffer);
+    return buffer;
+}
+
+void CharacterFormatter::write(const Character& character, ostream& out)
+{
+    format(character);
+    out.write(buffer.data(), static_cast<streamsize>(buffer.size()));
+}
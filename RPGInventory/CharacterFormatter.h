@@ -0,0 +1,27 @@
+#pragma once
+#include "Character.h"
+#include <ostream>
+#include <string>
+
+// Renders characters as text identical to operator<<, without stream formatting.
+//
+// Numbers are written with to_chars, labels are constants, and the whole character is built in one
+// buffer that is reused from call to call, so printing a large inventory costs one bulk write instead
+// of several formatted insertions per item.
+class CharacterFormatter
+{
+public:
+    // Appends the text of the character to out.
+    static void appendTo(const Character& character, std::string& out);
+
+    // Renders the character into the formatter's buffer and returns it.  The text is valid until the
+    // next call.
+    const std::string& format(const Character& character);
+
+    // Writes the character to out with a single write.
+    void write(const Character& character, std::ostream& out);
+
+private:
+    // Kept between calls so its capacity is reused
+    std::string buffer;
+};
@@ -0,0 +1,542 @@
+#include "CharacterImage.h"
+#include "DurableFile.h"
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+#include <array>
+#include <cstring>
+#include <cstdint>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+namespace
+{
+    // The fixed-size header at the start of every image.  Every field is naturally aligned, so the
+    // layout is the same for every compiler.
+    struct ImageHeader
+    {
+        char magic[4];                  // "RPGI"
+        uint32_t byteOrderMark;         // BYTE_ORDER_MARK, as written by the host
+        uint32_t version;               // IMAGE_VERSION
+        uint32_t rowCount;              // inventory rows followed by equipped rows
+        uint32_t inventoryCount;
+        int32_t totalArmorRating;
+        uint32_t equippedArmorRows[6];  // NO_ROW for an empty slot
+        uint32_t equippedWeaponRow;     // NO_ROW if no weapon is equipped
+        uint32_t reserved;              // keeps totalWeight 8-byte aligned
+        double totalWeight;
+        uint64_t kindsOffset;           // uint8 per row
+        uint64_t slotsOffset;           // uint8 per row
+        uint64_t goldOffset;            // uint32 per row
+        uint64_t extrasOffset;          // int32 per row: damage or rating
+        uint64_t nameOffsetsOffset;     // uint32 per row, within the names block
+        uint64_t nameLengthsOffset;     // uint32 per row
+        uint64_t weightsOffset;         // double per row
+        uint64_t namesOffset;
+        uint64_t namesSize;
+    };
+    static_assert(sizeof(ImageHeader) == 136, "the image header must not contain padding");
+
+    const char MAGIC[4]{ 'R', 'P', 'G', 'I' };
+    const uint32_t BYTE_ORDER_MARK{ 0x01020304 };
+    const uint32_t IMAGE_VERSION{ 1 };
+
+    //columns start on 8-byte boundaries so they can be read in place
+    size_t align(size_t offset)
+    {
+        return (offset + 7) & ~static_cast<size_t>(7);
+    }
+
+    //appends a column of values at the next 8-byte boundary and returns its offset
+    template <typename T>
+    uint64_t appendColumn(string& buffer, const vector<T>& column)
+    {
+        buffer.resize(align(buffer.size()));
+        const uint64_t offset{ buffer.size() };
+        buffer.append(reinterpret_cast<const char*>(column.data()), column.size() * sizeof(T));
+        return offset;
+    }
+}
+
+void CharacterImage::write(const Character& character, const string& path)
+{
+    //gather every item: the inventory in order, then the equipped armor and weapon
+    vector<const Item*> items;
+    items.reserve(character.inventory.getSize() + Armor::SLOT_COUNT + 1);
+    character.inventory.forEach([&items](const Item& item)
+        {
+            items.push_back(&item);
+        });
+
+    ImageHeader header{};
+    memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.byteOrderMark = BYTE_ORDER_MARK;
+    header.version = IMAGE_VERSION;
+    header.inventoryCount = static_cast<uint32_t>(items.size());
+    for (unsigned int slotID{ 0 }; slotID < Armor::SLOT_COUNT; slotID++)
+    {
+        header.equippedArmorRows[slotID] = NO_ROW;
+        if (character.equipment.getArmor(slotID))
+        {
+            header.equippedArmorRows[slotID] = static_cast<uint32_t>(items.size());
+            items.push_back(character.equipment.getArmor(slotID));
+        }
+    }
+    header.equippedWeaponRow = NO_ROW;
+    if (character.equipment.getWeapon())
+    {
+        header.equippedWeaponRow = static_cast<uint32_t>(items.size());
+        items.push_back(character.equipment.getWeapon());
+    }
+    header.rowCount = static_cast<uint32_t>(items.size());
+    header.totalArmorRating = character.getTotalArmorRating();
+    header.totalWeight = character.getTotalWeight();
+
+    //split the rows into columns, storing each distinct name once
+    vector<uint8_t> kinds(items.size()), slots(items.size());
+    vector<uint32_t> goldValues(items.size()), nameOffsets(items.size()), nameLengths(items.size());
+    vector<int32_t> extras(items.size());
+    vector<double> weights(items.size());
+    string nameBlock;
+    unordered_map<string, uint32_t> nameOffsetsByName;
+    for (size_t row{ 0 }; row < items.size(); row++)
+    {
+        const Item& item{ *items[row] };
+        const ItemKind kind{ kindOf(item) };
+        kinds[row] = static_cast<uint8_t>(kind);
+        goldValues[row] = item.getGoldValue();
+        weights[row] = item.getWeight();
+        if (kind == ItemKind::Weapon)
+        {
+            extras[row] = static_cast<const Weapon&>(item).getDamage();
+        }
+        else if (kind == ItemKind::Armor)
+        {
+            extras[row] = static_cast<const Armor&>(item).getRating();
+            slots[row] = static_cast<uint8_t>(static_cast<const Armor&>(item).getSlotID());
+        }
+
+        string name{ item.getName() };
+        auto inserted{ nameOffsetsByName.emplace(name, static_cast<uint32_t>(nameBlock.size())) };
+        if (inserted.second)
+        {
+            nameBlock.append(name);
+        }
+        nameOffsets[row] = inserted.first->second;
+        nameLengths[row] = static_cast<uint32_t>(name.size());
+    }
+
+    //lay the file out in one buffer: header, then the columns, then the names
+    string buffer(sizeof(ImageHeader), '\0');
+    header.kindsOffset = appendColumn(buffer, kinds);
+    header.slotsOffset = appendColumn(buffer, slots);
+    header.goldOffset = appendColumn(buffer, goldValues);
+    header.extrasOffset = appendColumn(buffer, extras);
+    header.nameOffsetsOffset = appendColumn(buffer, nameOffsets);
+    header.nameLengthsOffset = appendColumn(buffer, nameLengths);
+    header.weightsOffset = appendColumn(buffer, weights);
+    header.namesOffset = align(buffer.size());
+    header.namesSize = nameBlock.size();
+    buffer.resize(static_cast<size_t>(header.namesOffset));
+    buffer.append(nameBlock);
+    memcpy(&buffer[0], &header, sizeof(header));
+
+    //swap the new image in whole; truncating in place would tear the file under anyone who has it mapped
+    replaceFile(path, buffer);
+}
+
+CharacterImage::CharacterImage(const string& path)
+{
+    //map the whole file read-only
+#ifdef _WIN32
+    HANDLE file{ CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr) };
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        throw runtime_error("could not open character image: " + path);
+    }
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart < static_cast<LONGLONG>(sizeof(ImageHeader)))
+    {
+        CloseHandle(file);
+        throw runtime_error("not a character image: " + path);
+    }
+    HANDLE mapping{ CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr) };
+    CloseHandle(file);
+    if (!mapping)
+    {
+        throw runtime_error("could not map character image: " + path);
+    }
+    const void* view{ MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) };
+    if (!view)
+    {
+        CloseHandle(mapping);
+        throw runtime_error("could not map character image: " + path);
+    }
+    mappingHandle = mapping;
+    data = static_cast<const char*>(view);
+    size = static_cast<size_t>(fileSize.QuadPart);
+#else
+    const int file{ open(path.c_str(), O_RDONLY) };
+    if (file < 0)
+    {
+        throw runtime_error("could not open character image: " + path);
+    }
+    struct stat status;
+    if (fstat(file, &status) != 0 || status.st_size < static_cast<off_t>(sizeof(ImageHeader)))
+    {
+        close(file);
+        throw runtime_error("not a character image: " + path);
+    }
+    void* view{ mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ, MAP_SHARED, file, 0) };
+    close(file);
+    if (view == MAP_FAILED)
+    {
+        throw runtime_error("could not map character image: " + path);
+    }
+    data = static_cast<const char*>(view);
+    size = static_cast<size_t>(status.st_size);
+#endif
+
+    //check the header and that every column fits in the file; only the header page is touched
+    const ImageHeader& header{ *reinterpret_cast<const ImageHeader*>(data) };
+    auto fits{ [this](uint64_t offset, uint64_t length)
+        {
+            return offset % 8 == 0 && offset <= size && length <= size - offset;
+        } };
+    const uint64_t rows{ header.rowCount };
+    bool valid{ memcmp(header.magic, MAGIC, sizeof(MAGIC)) == 0
+        && header.byteOrderMark == BYTE_ORDER_MARK
+        && header.version == IMAGE_VERSION
+        && header.inventoryCount <= header.rowCount
+        && fits(header.kindsOffset, rows)
+        && fits(header.slotsOffset, rows)
+        && fits(header.goldOffset, rows * 4)
+        && fits(header.extrasOffset, rows * 4)
+        && fits(header.nameOffsetsOffset, rows * 4)
+        && fits(header.nameLengthsOffset, rows * 4)
+        && fits(header.weightsOffset, rows * 8)
+        && fits(header.namesOffset, header.namesSize) };
+    for (unsigned int slotID{ 0 }; slotID < Armor::SLOT_COUNT; slotID++)
+    {
+        valid = valid && (header.equippedArmorRows[slotID] == NO_ROW || header.equippedArmorRows[slotID] < header.rowCount);
+    }
+    valid = valid && (header.equippedWeaponRow == NO_ROW || header.equippedWeaponRow < header.rowCount);
+    if (!valid)
+    {
+        unmap();
+        throw runtime_error("not a valid character image: " + path);
+    }
+
+    kinds = reinterpret_cast<const unsigned char*>(data + header.kindsOffset);
+    slots = reinterpret_cast<const unsigned char*>(data + header.slotsOffset);
+    goldValues = reinterpret_cast<const unsigned int*>(data + header.goldOffset);
+    extras = reinterpret_cast<const int*>(data + header.extrasOffset);
+    nameOffsets = reinterpret_cast<const unsigned int*>(data + header.nameOffsetsOffset);
+    nameLengths = reinterpret_cast<const unsigned int*>(data + header.nameLengthsOffset);
+    weights = reinterpret_cast<const double*>(data + header.weightsOffset);
+    names = data + header.namesOffset;
+    namesSize = static_cast<size_t>(header.namesSize);
+}
+
+CharacterImage::~CharacterImage()
+{
+    unmap();
+}
+
+void CharacterImage::unmap()
+{
+    if (!data)
+    {
+        return;
+    }
+
+#ifdef _WIN32
+    UnmapViewOfFile(data);
+    CloseHandle(static_cast<HANDLE>(mappingHandle));
+#else
+    munmap(const_cast<char*>(data), size);
+#endif
+    data = nullptr;
+}
+
+unsigned int CharacterImage::getInventorySize() const
+{
+    return reinterpret_cast<const ImageHeader*>(data)->inventoryCount;
+}
+
+unsigned int CharacterImage::getRowCount() const
+{
+    return reinterpret_cast<const ImageHeader*>(data)->rowCount;
+}
+
+double CharacterImage::getTotalWeight() const
+{
+    return reinterpret_cast<const ImageHeader*>(data)->totalWeight;
+}
+
+int CharacterImage::getTotalArmorRating() const
+{
+    return reinterpret_cast<const ImageHeader*>(data)->totalArmorRating;
+}
+
+unsigned int CharacterImage::getEquippedArmorRow(unsigned int slotID) const
+{
+    //throw an out_of_range exception if slotID is greater than 5
+    if (slotID >= Armor::SLOT_COUNT)
+    {
+        throw out_of_range("slotID should be between 0-5");
+    }
+    return reinterpret_cast<const ImageHeader*>(data)->equippedArmorRows[slotID];
+}
+
+unsigned int CharacterImage::getEquippedWeaponRow() const
+{
+    return reinterpret_cast<const ImageHeader*>(data)->equippedWeaponRow;
+}
+
+ItemKind CharacterImage::getKind(unsigned int row) const
+{
+    return static_cast<ItemKind>(kinds[row]);
+}
+
+string_view CharacterImage::getName(unsigned int row) const
+{
+    //the name block is only checked as it's used, so opening an image never reads it all
+    if (nameOffsets[row] > namesSize || nameLengths[row] > namesSize - nameOffsets[row])
+    {
+        throw runtime_error("corrupt character image: name out of range");
+    }
+    return string_view{ names + nameOffsets[row], nameLengths[row] };
+}
+
+unsigned int CharacterImage::getGoldValue(unsigned int row) const
+{
+    return goldValues[row];
+}
+
+double CharacterImage::getWeight(unsigned int row) const
+{
+    return weights[row];
+}
+
+int CharacterImage::getDamage(unsigned int row) const
+{
+    return getKind(row) == ItemKind::Weapon ? extras[row] : 0;
+}
+
+int CharacterImage::getRating(unsigned int row) const
+{
+    return getKind(row) == ItemKind::Armor ? extras[row] : 0;
+}
+
+unsigned int CharacterImage::getSlotID(unsigned int row) const
+{
+    return getKind(row) == ItemKind::Armor ? slots[row] : 0;
+}
+
+void CharacterImage::materialize(Character& character) const
+{
+    //recreate every item before touching the character, so a corrupt image leaves it unchanged
+    vector<ItemPtr<Item>> items;
+    items.reserve(getInventorySize());
+    for (unsigned int row{ 0 }; row < getInventorySize(); row++)
+    {
+        items.push_back(createItem(row));
+    }
+
+    array<ItemPtr<Armor>, Armor::SLOT_COUNT> armor;
+    for (unsigned int slotID{ 0 }; slotID < Armor::SLOT_COUNT; slotID++)
+    {
+        const unsigned int row{ getEquippedArmorRow(slotID) };
+        if (row != NO_ROW)
+        {
+            if (getKind(row) != ItemKind::Armor || getSlotID(row) != slotID)
+            {
+                throw runtime_error("corrupt character image: equipped armor");
+            }
+            armor[slotID] = staticItemCast<Armor>(createItem(row));
+        }
+    }
+
+    ItemPtr<Weapon> weapon;
+    if (getEquippedWeaponRow() != NO_ROW)
+    {
+        if (getKind(getEquippedWeaponRow()) != ItemKind::Weapon)
+        {
+            throw runtime_error("corrupt character image: equipped weapon");
+        }
+        weapon = staticItemCast<Weapon>(createItem(getEquippedWeaponRow()));
+    }
+
+    //the rows are already in inventory order, so the bulk insert only appends
+    character.inventory.clear();
+    character.inventory.addItems(move(items));
+    for (unsigned int slotID{ 0 }; slotID < Armor::SLOT_COUNT; slotID++)
+    {
+        character.equipment.unequipArmor(slotID);
+        if (armor[slotID])
+        {
+            character.equipment.equipArmor(move(armor[slotID]));
+        }
+    }
+    character.equipment.unequipWeapon();
+    if (weapon)
+    {
+        character.equipment.equipWeapon(move(weapon));
+    }
+}
+
+ItemPtr<Item> CharacterImage::createItem(unsigned int row) const
+{
+    ItemPtr<Item> item;
+    switch (getKind(row))
+    {
+    case ItemKind::Item:
+        item = makeItem<Item>();
+        break;
+    case ItemKind::Weapon:
+    {
+        ItemPtr<Weapon> weapon{ makeItem<Weapon>() };
+        weapon->setDamage(getDamage(row));
+        item = move(weapon);
+        break;
+    }
+    case ItemKind::Armor:
+    {
+        //setSlotID throws out_of_range for a slot that doesn't exist
+        ItemPtr<Armor> armor{ makeItem<Armor>() };
+        armor->setSlotID(getSlotID(row));
+        armor->setRating(getRating(row));
+        item = move(armor);
+        break;
+    }
+    default:
+        throw runtime_error("corrupt character image: item kind");
+    }
+
+    item->setName(string{ getName(row) });
+    item->setGoldValue(getGoldValue(row));
+    item->setWeight(getWeight(row));
+    return item;
+}
+
+CharacterImageInventory::CharacterImageInventory(const CharacterImage& image) : image{ image }
+{
+}
+
+unsigned int CharacterImageInventory::getSize() const
+{
+    return image.getInventorySize();
+}
+
+void CharacterImageInventory::forEach(const function<void(const Item&)>& accept) const
+{
+    //one scratch item of each kind is refilled for every row, so visiting doesn't allocate an item per row
+    Item item;
+    Weapon weapon;
+    Armor armor;
+    for (unsigned int row{ 0 }; row < image.getInventorySize(); row++)
+    {
+        Item* scratch{ nullptr };
+        switch (image.getKind(row))
+        {
+        case ItemKind::Item:
+            scratch = &item;
+            break;
+        case ItemKind::Weapon:
+            weapon.setDamage(image.getDamage(row));
+            scratch = &weapon;
+            break;
+        case ItemKind::Armor:
+            //setSlotID throws out_of_range for a slot that doesn't exist
+            armor.setSlotID(image.getSlotID(row));
+            armor.setRating(image.getRating(row));
+            scratch = &armor;
+            break;
+        default:
+            throw runtime_error("corrupt character image: item kind");
+        }
+
+        const string_view name{ image.getName(row) };
+        if (scratch->getName() != name)
+        {
+            scratch->setName(string{ name });
+        }
+        scratch->setGoldValue(image.getGoldValue(row));
+        scratch->setWeight(image.getWeight(row));
+        accept(*scratch);
+    }
+}
+
+void CharacterImageInventory::forEach(const function<void(const Item&)>& accept)
+{
+    static_cast<const CharacterImageInventory&>(*this).forEach(accept);
+}
+
+MappedCharacter::MappedCharacter(const string& path) : image{ make_unique<CharacterImage>(path) }
+{
+    imageInventory = make_unique<CharacterImageInventory>(*image);
+}
+
+bool MappedCharacter::isMaterialized() const
+{
+    return character != nullptr;
+}
+
+const CharacterImage& MappedCharacter::getImage() const
+{
+    //throw an exception once the image has been released
+    if (!image)
+    {
+        throw logic_error("character has already been materialized");
+    }
+    return *image;
+}
+
+unsigned int MappedCharacter::getInventorySize() const
+{
+    return character ? character->getInventory().getSize() : image->getInventorySize();
+}
+
+const Collection<const Item>& MappedCharacter::getInventory() const
+{
+    if (character)
+    {
+        return character->getInventory();
+    }
+    return *imageInventory;
+}
+
+double MappedCharacter::getTotalWeight() const
+{
+    return character ? character->getTotalWeight() : image->getTotalWeight();
+}
+
+int MappedCharacter::getTotalArmorRating() const
+{
+    return character ? character->getTotalArmorRating() : image->getTotalArmorRating();
+}
+
+Character& MappedCharacter::edit()
+{
+    //the first mutation builds the real character; the mapping isn't needed after that
+    if (!character)
+    {
+        unique_ptr<Character> materialized{ make_unique<Character>() };
+        image->materialize(*materialized);
+        character = move(materialized);
+        imageInventory.reset();
+        image.reset();
+    }
+    return *character;
+}
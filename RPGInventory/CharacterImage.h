@@ -0,0 +1,180 @@
+#pragma once
+#include "Character.h"
+#include "Collection.h"
+#include "ItemKind.h"
+#include <string>
+#include <string_view>
+#include <memory>
+#include <cstddef>
+
+// A read-only view of a character stored in an image file that is memory-mapped and used in place.
+// Opening an image only maps the file; nothing is decoded up front, so the cost of using an image
+// depends on the pages that are actually read rather than on the number of items.
+//
+// Rows 0 to getInventorySize() - 1 are the inventory, already in descending value to weight order.
+// Equipped items follow as extra rows.  Each attribute is stored as its own column of fixed-width
+// values in the host's byte order, and names are stored once each in a shared block of text.
+class CharacterImage
+{
+public:
+    // Returned by getEquippedArmorRow() and getEquippedWeaponRow() for an empty slot.
+    const static unsigned int NO_ROW = 0xFFFFFFFF;
+
+    // Writes an image of the character to the specified file, replacing it if it exists.  The image is
+    // written to a temporary file and renamed over the old one, so the file holds either the old image
+    // or the new one.  On POSIX systems an image of the old file that is already mapped keeps reading
+    // it; on Windows a file that is mapped can't be replaced, and write() throws.
+    // A runtime_error is thrown if the file can't be written or replaced.
+    static void write(const Character& character, const std::string& path);
+
+    // Maps the image file at the specified path.
+    // A runtime_error is thrown if the file can't be mapped or isn't a valid image.
+    explicit CharacterImage(const std::string& path);
+
+    // Unmaps the file.
+    ~CharacterImage();
+
+    // Copying is deleted; each image owns its mapping.
+    CharacterImage(const CharacterImage& image) = delete;
+
+    // Copy assignment is deleted; each image owns its mapping.
+    CharacterImage& operator = (const CharacterImage& image) = delete;
+
+    // Gets the number of items in the inventory.
+    unsigned int getInventorySize() const;
+
+    // Gets the number of rows, including equipped items.
+    unsigned int getRowCount() const;
+
+    // Gets the total weight of all items, whether equipped or in the inventory.
+    double getTotalWeight() const;
+
+    // Gets the sum of the ratings of the equipped armor.
+    int getTotalArmorRating() const;
+
+    // Gets the row of the armor equipped in a slot, or NO_ROW if the slot is empty.
+    // An out_of_range exception is thrown if slotID is not 0, 1, 2, 3, 4, or 5.
+    unsigned int getEquippedArmorRow(unsigned int slotID) const;
+
+    // Gets the row of the equipped weapon, or NO_ROW if no weapon is equipped.
+    unsigned int getEquippedWeaponRow() const;
+
+    // The accessors below read one attribute of a row.  row is not checked.
+
+    // Gets the kind of item in a row.
+    ItemKind getKind(unsigned int row) const;
+
+    // Gets the name of the item in a row.  The text points straight into the mapped file.
+    std::string_view getName(unsigned int row) const;
+
+    // Gets the gold value of the item in a row.
+    unsigned int getGoldValue(unsigned int row) const;
+
+    // Gets the weight of the item in a row.
+    double getWeight(unsigned int row) const;
+
+    // Gets the damage of the weapon in a row (0 for other kinds).
+    int getDamage(unsigned int row) const;
+
+    // Gets the rating of the armor in a row (0 for other kinds).
+    int getRating(unsigned int row) const;
+
+    // Gets the slot ID of the armor in a row (0 for other kinds).
+    unsigned int getSlotID(unsigned int row) const;
+
+    // Replaces the character's inventory and equipment with the ones in the image.
+    void materialize(Character& character) const;
+
+private:
+    // The start of the mapped file
+    const char* data{ nullptr };
+
+    // The size of the mapped file, in bytes
+    std::size_t size{ 0 };
+
+    // Platform handle for the mapping (only used on Windows)
+    void* mappingHandle{ nullptr };
+
+    // Columns within the mapped file
+    const unsigned char* kinds{ nullptr };
+    const unsigned char* slots{ nullptr };
+    const unsigned int* goldValues{ nullptr };
+    const int* extras{ nullptr };
+    const unsigned int* nameOffsets{ nullptr };
+    const unsigned int* nameLengths{ nullptr };
+    const double* weights{ nullptr };
+    const char* names{ nullptr };
+    std::size_t namesSize{ 0 };
+
+    // Recreates the item in a row as a new object
+    ItemPtr<Item> createItem(unsigned int row) const;
+
+    // Releases the mapping, if there is one
+    void unmap();
+};
+
+// The inventory rows of a CharacterImage as a read-only collection of items, for code written against
+// the same interface as Inventory.  Each row is decoded into a scratch item as it is visited, so an
+// item passed to forEach() is only valid until the function returns.  The view is only valid as long
+// as the image.
+class CharacterImageInventory : public Collection<const Item>
+{
+public:
+    // Creates a view of the image's inventory.
+    explicit CharacterImageInventory(const CharacterImage& image);
+
+    // Gets the number of items in the inventory.
+    virtual unsigned int getSize() const;
+
+    // Performs the specified accept() function on each item, in inventory order.
+    // A runtime_error is thrown if a row is corrupt.
+    virtual void forEach(const std::function<void(const Item&)>& accept) const;
+
+    // Same as the const version; the items can't be changed either way.
+    virtual void forEach(const std::function<void(const Item&)>& accept);
+
+private:
+    // The image being viewed
+    const CharacterImage& image;
+};
+
+// A character that starts out as a read-only CharacterImage and only becomes a real, mutable
+// Character the first time edit() is called.
+class MappedCharacter
+{
+public:
+    // Maps the image file at the specified path.  See CharacterImage.
+    explicit MappedCharacter(const std::string& path);
+
+    // Returns true once edit() has been called.
+    bool isMaterialized() const;
+
+    // Gets the image.  A logic_error is thrown if the character has been materialized.
+    const CharacterImage& getImage() const;
+
+    // Gets the number of items in the inventory.
+    unsigned int getInventorySize() const;
+
+    // Gets the inventory for reading: a view of the image until the character is materialized, then
+    // the character's own inventory.  The reference is invalidated by the first call to edit().
+    const Collection<const Item>& getInventory() const;
+
+    // Gets the total weight of all items, whether equipped or in the inventory.
+    double getTotalWeight() const;
+
+    // Gets the sum of the ratings of the equipped armor.
+    int getTotalArmorRating() const;
+
+    // Gets the mutable character, building it from the image (and releasing the mapping) on the first call.
+    Character& edit();
+
+private:
+    // The mapped image, until the character is materialized
+    std::unique_ptr<CharacterImage> image;
+
+    // The view of the image's inventory, released along with the image
+    std::unique_ptr<CharacterImageInventory> imageInventory;
+
+    // The materialized character, once edit() has been called
+    std::unique_ptr<Character> character;
+};
@@ -0,0 +1,331 @@
+#include "CharacterSerializer.h"
+#include "ItemKind.h"
+#include <stdexcept>
+#include <unordered_map>
+#include <climits>
+#include <cstring>
+#include <array>
+
+using namespace std;
+
+namespace
+{
+    //the first four bytes of every saved character
+    const char MAGIC[4]{ 'R', 'P', 'G', 'C' };
+}
+
+void CharacterSerializer::save(const Character& character, ostream& out)
+{
+    //gather every item: the inventory in order, then the equipped armor and weapon
+    vector<const Item*> items;
+    items.reserve(character.inventory.getSize() + Armor::SLOT_COUNT + 1);
+    character.inventory.forEach([&items](const Item& item)
+        {
+            items.push_back(&item);
+        });
+    for (unsigned int slotID{ 0 }; slotID < Armor::SLOT_COUNT; slotID++)
+    {
+        if (character.equipment.getArmor(slotID))
+        {
+            items.push_back(character.equipment.getArmor(slotID));
+        }
+    }
+    if (character.equipment.getWeapon())
+    {
+        items.push_back(character.equipment.getWeapon());
+    }
+
+    saveItems(items, character.inventory.getSize(), character.equipment.getArmorMask(), character.equipment.getWeapon() != nullptr, out);
+}
+
+void CharacterSerializer::save(const CharacterSnapshot& snapshot, ostream& out)
+{
+    //the same order as a live character: the inventory, then the equipped armor and weapon
+    vector<const Item*> items;
+    items.reserve(snapshot.getInventory().size() + Armor::SLOT_COUNT + 1);
+    for (const auto& item : snapshot.getInventory())
+    {
+        items.push_back(item.get());
+    }
+    unsigned int armorMask{ 0 };
+    for (unsigned int slotID{ 0 }; slotID < Armor::SLOT_COUNT; slotID++)
+    {
+        if (snapshot.getEquippedArmor(slotID))
+        {
+            items.push_back(snapshot.getEquippedArmor(slotID));
+            armorMask |= 1u << slotID;
+        }
+    }
+    if (snapshot.getEquippedWeapon())
+    {
+        items.push_back(snapshot.getEquippedWeapon());
+    }
+
+    saveItems(items, snapshot.getInventory().size(), armorMask, snapshot.getEquippedWeapon() != nullptr, out);
+}
+
+void CharacterSerializer::saveItems(const vector<const Item*>& items, size_t inventorySize, unsigned int armorMask, bool hasWeapon, ostream& out)
+{
+    //give each distinct name an index, in order of first appearance
+    unordered_map<string, uint64_t> nameIndices;
+    vector<const string*> names;
+    vector<uint64_t> itemNameIndices;
+    itemNameIndices.reserve(items.size());
+    for (const Item* item : items)
+    {
+        auto inserted{ nameIndices.emplace(item->getName(), names.size()) };
+        if (inserted.second)
+        {
+            names.push_back(&inserted.first->first);
+        }
+        itemNameIndices.push_back(inserted.first->second);
+    }
+
+    //encode everything into one buffer so the stream only sees a single write
+    string buffer;
+    buffer.reserve(16 + items.size() * 16);
+    BinaryWriter writer{ buffer };
+
+    buffer.append(MAGIC, sizeof(MAGIC));
+    writer.writeVarint(VERSION);
+
+    writer.writeVarint(names.size());
+    for (const string* name : names)
+    {
+        writer.writeString(*name);
+    }
+
+    writer.writeVarint(inventorySize);
+    for (size_t i{ 0 }; i < inventorySize; i++)
+    {
+        writeItem(writer, *items[i], itemNameIndices[i]);
+    }
+
+    size_t next{ inventorySize };
+    writer.writeByte(static_cast<uint8_t>(armorMask));
+    for (unsigned int slotID{ 0 }; slotID < Armor::SLOT_COUNT; slotID++)
+    {
+        if (armorMask & (1u << slotID))
+        {
+            writeItem(writer, *items[next], itemNameIndices[next]);
+            next++;
+        }
+    }
+
+    writer.writeByte(hasWeapon ? 1 : 0);
+    if (hasWeapon)
+    {
+        writeItem(writer, *items[next], itemNameIndices[next]);
+    }
+
+    out.write(buffer.data(), static_cast<streamsize>(buffer.size()));
+}
+
+void CharacterSerializer::load(Character& character, istream& in)
+{
+    //read the whole stream in large chunks
+    string data;
+    char chunk[1 << 16];
+    while (in.read(chunk, sizeof(chunk)) || in.gcount() > 0)
+    {
+        data.append(chunk, static_cast<size_t>(in.gcount()));
+    }
+
+    BinaryReader reader{ data.data(), data.size() };
+
+    //throw an exception if this isn't a character or it was written by a newer version
+    if (data.size() < sizeof(MAGIC) || memcmp(reader.readBytes(sizeof(MAGIC)), MAGIC, sizeof(MAGIC)) != 0)
+    {
+        throw runtime_error("not a saved character");
+    }
+    if (reader.readVarint() != VERSION)
+    {
+        throw runtime_error("unsupported saved character version");
+    }
+
+    //decode everything before touching the character, so bad data leaves it unchanged
+    const uint64_t nameCount{ reader.readVarint() };
+    if (nameCount > data.size())
+    {
+        throw runtime_error("corrupt saved character: name count");
+    }
+    vector<string> names;
+    names.reserve(static_cast<size_t>(nameCount));
+    for (uint64_t i{ 0 }; i < nameCount; i++)
+    {
+        names.push_back(reader.readString());
+    }
+
+    const uint64_t inventorySize{ reader.readVarint() };
+    if (inventorySize > data.size())
+    {
+        throw runtime_error("corrupt saved character: inventory size");
+    }
+    vector<ItemPtr<Item>> items;
+    items.reserve(static_cast<size_t>(inventorySize));
+    for (uint64_t i{ 0 }; i < inventorySize; i++)
+    {
+        items.push_back(readItem(reader, names));
+    }
+
+    array<ItemPtr<Armor>, Armor::SLOT_COUNT> armor;
+    const uint8_t armorMask{ reader.readByte() };
+    for (unsigned int slotID{ 0 }; slotID < Armor::SLOT_COUNT; slotID++)
+    {
+        if (armorMask & (1u << slotID))
+        {
+            ItemPtr<Item> item{ readItem(reader, names) };
+            if (!item || item->getKind() != ItemKind::Armor || static_cast<const Armor&>(*item).getSlotID() != slotID)
+            {
+                throw runtime_error("corrupt saved character: equipped armor");
+            }
+            armor[slotID] = staticItemCast<Armor>(move(item));
+        }
+    }
+
+    ItemPtr<Weapon> weapon;
+    if (reader.readByte() != 0)
+    {
+        ItemPtr<Item> item{ readItem(reader, names) };
+        if (!item || item->getKind() != ItemKind::Weapon)
+        {
+            throw runtime_error("corrupt saved character: equipped weapon");
+        }
+        weapon = staticItemCast<Weapon>(move(item));
+    }
+
+    if (!reader.atEnd())
+    {
+        throw runtime_error("corrupt saved character: trailing data");
+    }
+
+    //replace the character's items; the old ones are discarded
+    character.inventory.clear();
+    character.inventory.addItems(move(items));
+    for (unsigned int slotID{ 0 }; slotID < Armor::SLOT_COUNT; slotID++)
+    {
+        character.equipment.unequipArmor(slotID);
+        if (armor[slotID])
+        {
+            character.equipment.equipArmor(move(armor[slotID]));
+        }
+    }
+    character.equipment.unequipWeapon();
+    if (weapon)
+    {
+        character.equipment.equipWeapon(move(weapon));
+    }
+}
+
+void CharacterSerializer::writeItemRecord(BinaryWriter& writer, const Item& item)
+{
+    const ItemKind kind{ kindOf(item) };
+    writer.writeByte(static_cast<uint8_t>(kind));
+    writer.writeString(item.getName());
+    writeFields(writer, item, kind);
+}
+
+ItemPtr<Item> CharacterSerializer::readItemRecord(BinaryReader& reader)
+{
+    const uint8_t kind{ reader.readByte() };
+    string name{ reader.readString() };
+    ItemPtr<Item> item{ readFields(reader, kind) };
+    item->setName(move(name));
+    return item;
+}
+
+void CharacterSerializer::writeItem(BinaryWriter& writer, const Item& item, uint64_t nameIndex)
+{
+    const ItemKind kind{ kindOf(item) };
+    writer.writeByte(static_cast<uint8_t>(kind));
+    writer.writeVarint(nameIndex);
+    writeFields(writer, item, kind);
+}
+
+ItemPtr<Item> CharacterSerializer::readItem(BinaryReader& reader, const vector<string>& names)
+{
+    const uint8_t kind{ reader.readByte() };
+    const uint64_t nameIndex{ reader.readVarint() };
+
+    //throw an exception if the name isn't in the table
+    if (nameIndex >= names.size())
+    {
+        throw runtime_error("corrupt saved character: item");
+    }
+
+    ItemPtr<Item> item{ readFields(reader, kind) };
+    item->setName(names[static_cast<size_t>(nameIndex)]);
+    return item;
+}
+
+void CharacterSerializer::writeFields(BinaryWriter& writer, const Item& item, ItemKind kind)
+{
+    writer.writeVarint(item.getGoldValue());
+    writer.writeDouble(item.getWeight());
+
+    //append the attributes of the subclass
+    switch (kind)
+    {
+    case ItemKind::Weapon:
+        writer.writeSigned(static_cast<const Weapon&>(item).getDamage());
+        break;
+    case ItemKind::Armor:
+        writer.writeVarint(static_cast<const Armor&>(item).getSlotID());
+        writer.writeSigned(static_cast<const Armor&>(item).getRating());
+        break;
+    case ItemKind::Item:
+        break;
+    }
+}
+
+ItemPtr<Item> CharacterSerializer::readFields(BinaryReader& reader, uint8_t kind)
+{
+    const uint64_t goldValue{ reader.readVarint() };
+    const double weight{ reader.readDouble() };
+
+    //throw an exception if a field doesn't fit
+    if (goldValue > UINT_MAX)
+    {
+        throw runtime_error("corrupt saved character: item");
+    }
+
+    ItemPtr<Item> item;
+    switch (static_cast<ItemKind>(kind))
+    {
+    case ItemKind::Item:
+        item = makeItem<Item>();
+        break;
+    case ItemKind::Weapon:
+    {
+        const int64_t damage{ reader.readSigned() };
+        if (damage < INT_MIN || damage > INT_MAX)
+        {
+            throw runtime_error("corrupt saved character: weapon damage");
+        }
+        ItemPtr<Weapon> weapon{ makeItem<Weapon>() };
+        weapon->setDamage(static_cast<int>(damage));
+        item = move(weapon);
+        break;
+    }
+    case ItemKind::Armor:
+    {
+        const uint64_t slotID{ reader.readVarint() };
+        const int64_t rating{ reader.readSigned() };
+        if (slotID >= Armor::SLOT_COUNT || rating < INT_MIN || rating > INT_MAX)
+        {
+            throw runtime_error("corrupt saved character: armor");
+        }
+        ItemPtr<Armor> armor{ makeItem<Armor>() };
+        armor->setSlotID(static_cast<unsigned int>(slotID));
+        armor->setRating(static_cast<int>(rating));
+        item = move(armor);
+        break;
+    }
+    default:
+        throw runtime_error("corrupt saved character: item kind");
+    }
+
+    item->setGoldValue(static_cast<unsigned int>(goldValue));
+    item->setWeight(weight);
+    return item;
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include "Character.h"
+#include "CharacterSnapshot.h"
+#include "BinaryFormat.h"
+#include "ItemKind.h"
+#include <istream>
+#include <ostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Saves and loads characters in a compact, versioned binary format.
+//
+// Layout (version 1), using the encodings of BinaryWriter:
+//   "RPGC" magic, format version (varint)
+//   name table: count (varint), then each distinct item name (length-prefixed string)
+//   inventory: count (varint), then one item record per item in inventory order
+//   equipped armor: occupied slot mask (byte), then one item record per occupied slot in slot order
+//   equipped weapon: 0 or 1 (byte), then one item record if 1
+// An item record is the item kind (byte), name table index (varint), gold value (varint) and weight
+// (double), followed by the damage (signed) for a weapon or the slot ID (varint) and rating (signed) for armor.
+class CharacterSerializer
+{
+public:
+    // The version written by save().
+    static const unsigned int VERSION = 1;
+
+    // Writes the character's inventory and equipment to the stream.
+    static void save(const Character& character, std::ostream& out);
+
+    // Writes a point-in-time snapshot in the same format, so it loads like a saved character.
+    // Only the snapshot is read, so this can run on another thread while the character changes, unless
+    // RPG_SINGLE_THREADED is defined.
+    static void save(const CharacterSnapshot& snapshot, std::ostream& out);
+
+    // Replaces the character's inventory and equipment with the ones read from the stream.
+    // The inventory is built in one pass rather than item by item, and capacity mode is not applied.
+    // A runtime_error is thrown if the data is not a valid character; the character is then unchanged.
+    static void load(Character& character, std::istream& in);
+
+    // Appends a self-contained item record, with the name written in place of the name table index,
+    // for formats that store items one at a time.
+    static void writeItemRecord(BinaryWriter& writer, const Item& item);
+
+    // Reads an item record written by writeItemRecord().
+    // A runtime_error is thrown if the record is not a valid item.
+    static ItemPtr<Item> readItemRecord(BinaryReader& reader);
+
+private:
+    // Encodes the items, which are the inventory followed by the equipped armor in slot order and then the weapon.
+    static void saveItems(const std::vector<const Item*>& items, std::size_t inventorySize, unsigned int armorMask, bool hasWeapon, std::ostream& out);
+
+    // Appends an item record that refers to the name at nameIndex in the name table.
+    static void writeItem(BinaryWriter& writer, const Item& item, std::uint64_t nameIndex);
+
+    // Reads an item record, looking its name up in the name table.
+    static ItemPtr<Item> readItem(BinaryReader& reader, const std::vector<std::string>& names);
+
+    // Appends the fields that follow the name: gold value, weight, and the attributes of the subclass.
+    static void writeFields(BinaryWriter& writer, const Item& item, ItemKind kind);
+
+    // Reads the fields that follow the name and creates an unnamed item of the specified kind.
+    static ItemPtr<Item> readFields(BinaryReader& reader, std::uint8_t kind);
+};
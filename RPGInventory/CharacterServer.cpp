@@ -0,0 +1,504 @@
+#ifdef __linux__
+#include "CharacterServer.h"
+#include <stdexcept>
+#include <algorithm>
+#include <thread>
+#include <cerrno>
+#include <cstring>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace
+{
+    //fills in a Unix-domain socket address, throwing an exception if the path is too long
+    sockaddr_un socketAddress(const string& path)
+    {
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        if (path.size() >= sizeof(address.sun_path))
+        {
+            throw runtime_error("socket path is too long: " + path);
+        }
+        memcpy(address.sun_path, path.c_str(), path.size() + 1);
+        return address;
+    }
+
+    //blocks until every byte has been sent
+    void sendAll(int socket, const string& data)
+    {
+        size_t sent{ 0 };
+        while (sent < data.size())
+        {
+            const ssize_t result{ ::send(socket, data.data() + sent, data.size() - sent, MSG_NOSIGNAL) };
+            if (result < 0 && errno != EINTR)
+            {
+                throw runtime_error(string{ "send failed: " } + strerror(errno));
+            }
+            sent += result > 0 ? static_cast<size_t>(result) : 0;
+        }
+    }
+
+    //reads count one-line replies, timing each from sentAt; returns how many were errors
+    uint64_t awaitReplies(int socket, string& pending, unsigned int count, chrono::steady_clock::time_point sentAt, vector<chrono::nanoseconds>* latencies)
+    {
+        uint64_t errors{ 0 };
+        char buffer[1 << 16];
+        while (count != 0)
+        {
+            const ssize_t received{ recv(socket, buffer, sizeof(buffer), 0) };
+            if (received < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if (received <= 0)
+            {
+                throw runtime_error("connection closed by the server");
+            }
+            const chrono::nanoseconds latency{ chrono::steady_clock::now() - sentAt };
+            pending.append(buffer, static_cast<size_t>(received));
+
+            size_t start{ 0 };
+            for (size_t newline{ pending.find('\n') }; newline != string::npos && count != 0; newline = pending.find('\n', start))
+            {
+                if (pending.compare(start, 5, "error") == 0)
+                {
+                    errors++;
+                }
+                if (latencies)
+                {
+                    latencies->push_back(latency);
+                }
+                count--;
+                start = newline + 1;
+            }
+            pending.erase(0, start);
+        }
+        return errors;
+    }
+}
+
+CharacterServer::CharacterServer(const string& path) : path{ path }
+{
+    const sockaddr_un address{ socketAddress(path) };
+    unlink(path.c_str());
+
+    listener = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    epoll = epoll_create1(EPOLL_CLOEXEC);
+    stopEvent = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (listener < 0 || epoll < 0 || stopEvent < 0
+        || bind(listener, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0
+        || listen(listener, SOMAXCONN) != 0)
+    {
+        const string reason{ strerror(errno) };
+        release();
+        throw runtime_error("could not listen on " + path + ": " + reason);
+    }
+
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.fd = listener;
+    epoll_ctl(epoll, EPOLL_CTL_ADD, listener, &event);
+    event.data.fd = stopEvent;
+    epoll_ctl(epoll, EPOLL_CTL_ADD, stopEvent, &event);
+}
+
+CharacterServer::~CharacterServer()
+{
+    release();
+}
+
+void CharacterServer::release()
+{
+    for (const auto& connection : connections)
+    {
+        ::close(connection.first);
+    }
+    connections.clear();
+
+    for (int* descriptor : { &listener, &epoll, &stopEvent })
+    {
+        if (*descriptor >= 0)
+        {
+            ::close(*descriptor);
+            *descriptor = -1;
+        }
+    }
+    unlink(path.c_str());
+}
+
+void CharacterServer::run()
+{
+    epoll_event events[256];
+    vector<int> replied;
+    bool stopping{ false };
+    while (!stopping)
+    {
+        const int count{ epoll_wait(epoll, events, 256, -1) };
+        if (count < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            throw runtime_error(string{ "epoll_wait failed: " } + strerror(errno));
+        }
+
+        //handle every ready socket first, collecting the connections that have replies to send
+        replied.clear();
+        for (int i{ 0 }; i < count; i++)
+        {
+            const int socket{ events[i].data.fd };
+            if (socket == stopEvent)
+            {
+                stopping = true;
+                continue;
+            }
+            if (socket == listener)
+            {
+                acceptConnections();
+                continue;
+            }
+
+            auto connection{ connections.find(socket) };
+            if (connection == connections.end())
+            {
+                continue;
+            }
+            if ((events[i].events & (EPOLLERR | EPOLLHUP)) && !(events[i].events & EPOLLIN))
+            {
+                close(socket);
+                continue;
+            }
+            if ((events[i].events & EPOLLIN) && !receive(socket, connection->second))
+            {
+                close(socket);
+                continue;
+            }
+            if (connection->second.output.size() > connection->second.outputOffset)
+            {
+                replied.push_back(socket);
+            }
+        }
+
+        //then send each connection's replies for this pass in one write
+        for (int socket : replied)
+        {
+            auto connection{ connections.find(socket) };
+            if (connection != connections.end() && !send(socket, connection->second))
+            {
+                close(socket);
+            }
+        }
+    }
+
+    //leave the stop request consumed so run() can be called again
+    uint64_t value;
+    while (read(stopEvent, &value, sizeof(value)) > 0)
+    {
+    }
+}
+
+void CharacterServer::requestStop()
+{
+    //write() on an eventfd is async-signal-safe
+    const uint64_t value{ 1 };
+    ssize_t result{ write(stopEvent, &value, sizeof(value)) };
+    (void)result;
+}
+
+size_t CharacterServer::getCharacterCount() const
+{
+    return characters.size();
+}
+
+CharacterServer::Hosted& CharacterServer::host(string_view name)
+{
+    auto hosted{ characters.find(string{ name }) };
+    if (hosted == characters.end())
+    {
+        hosted = characters.emplace(string{ name }, make_unique<Hosted>()).first;
+    }
+    return *hosted->second;
+}
+
+void CharacterServer::acceptConnections()
+{
+    while (true)
+    {
+        const int socket{ accept4(listener, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC) };
+        if (socket < 0)
+        {
+            return; //EAGAIN once the backlog is empty; anything else is the client's problem
+        }
+
+        epoll_event event{};
+        event.events = EPOLLIN | EPOLLRDHUP;
+        event.data.fd = socket;
+        epoll_ctl(epoll, EPOLL_CTL_ADD, socket, &event);
+        connections[socket].hosted = &host("default");
+    }
+}
+
+bool CharacterServer::receive(int socket, Connection& connection)
+{
+    //one read per event, so a client that never stops sending can't starve the others; epoll is
+    //level-triggered and reports the rest on the next pass
+    char buffer[1 << 16];
+    ssize_t received;
+    do
+    {
+        received = recv(socket, buffer, sizeof(buffer), 0);
+    } while (received < 0 && errno == EINTR);
+    if (received == 0)
+    {
+        return false;
+    }
+    if (received < 0)
+    {
+        return errno == EAGAIN || errno == EWOULDBLOCK;
+    }
+
+    //run each whole line straight out of the buffer; only a line split across reads is kept
+    const string_view data{ buffer, static_cast<size_t>(received) };
+    size_t start{ 0 };
+    for (size_t newline{ data.find('\n') }; newline != string_view::npos; newline = data.find('\n', start))
+    {
+        const string_view piece{ data.substr(start, newline - start) };
+        if (connection.skippingLine || connection.input.size() + piece.size() > MAX_LINE_LENGTH)
+        {
+            connection.output.append("error line too long\n");
+            connection.skippingLine = false;
+        }
+        else if (connection.input.empty())
+        {
+            handleLine(connection, piece);
+        }
+        else
+        {
+            connection.input.append(piece);
+            handleLine(connection, connection.input);
+        }
+        connection.input.clear();
+        start = newline + 1;
+    }
+
+    //a line that's already too long is dropped as it arrives rather than buffered until its newline
+    const string_view rest{ data.substr(start) };
+    if (!connection.skippingLine && connection.input.size() + rest.size() > MAX_LINE_LENGTH)
+    {
+        connection.skippingLine = true;
+        string{}.swap(connection.input);
+    }
+    if (!connection.skippingLine)
+    {
+        connection.input.append(rest);
+    }
+    return true;
+}
+
+void CharacterServer::handleLine(Connection& connection, string_view line)
+{
+    if (!line.empty() && line.back() == '\r')
+    {
+        line.remove_suffix(1);
+    }
+
+    //"use" belongs to the connection rather than to a character
+    if (line == "use" || line.compare(0, 4, "use ") == 0)
+    {
+        string_view name{ line.substr(3) };
+        while (!name.empty() && name.front() == ' ')
+        {
+            name.remove_prefix(1);
+        }
+        if (name.empty())
+        {
+            connection.output.append("error use takes a character name\n");
+        }
+        else
+        {
+            connection.hosted = &host(name);
+            connection.output.append("ok\n");
+        }
+        return;
+    }
+
+    const size_t replyStart{ connection.output.size() };
+    try
+    {
+        //the processor appends printed output; the reply header goes in front of it
+        connection.output.append("ok\n");
+        const size_t outputStart{ connection.output.size() };
+        connection.hosted->processor.execute(line, connection.output);
+        const size_t printed{ connection.output.size() - outputStart };
+        if (printed != 0)
+        {
+            connection.output.replace(replyStart, 3, "ok " + to_string(printed) + "\n");
+        }
+    }
+    catch (const exception& e)
+    {
+        connection.output.resize(replyStart);
+        connection.output.append("error ").append(e.what()).append("\n");
+    }
+}
+
+bool CharacterServer::send(int socket, Connection& connection)
+{
+    while (connection.outputOffset < connection.output.size())
+    {
+        const ssize_t sent{ ::send(socket, connection.output.data() + connection.outputOffset, connection.output.size() - connection.outputOffset, MSG_NOSIGNAL) };
+        if (sent < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+            {
+                return false;
+            }
+
+            //the socket is full; finish when epoll says it has room, and stop taking more commands from
+            //a client that has fallen too far behind on reading its replies
+            const bool reading{ connection.output.size() - connection.outputOffset <= MAX_UNSENT_OUTPUT };
+            if (!connection.waitingToWrite || connection.reading != reading)
+            {
+                connection.waitingToWrite = true;
+                connection.reading = reading;
+                watch(socket, connection);
+            }
+            return true;
+        }
+        connection.outputOffset += static_cast<size_t>(sent);
+    }
+
+    connection.output.clear();
+    connection.outputOffset = 0;
+    if (connection.waitingToWrite || !connection.reading)
+    {
+        connection.waitingToWrite = false;
+        connection.reading = true;
+        watch(socket, connection);
+    }
+    return true;
+}
+
+void CharacterServer::watch(int socket, const Connection& connection)
+{
+    //EPOLLRDHUP goes with EPOLLIN, or a half-closed client that isn't being read would be reported on
+    //every pass; errors and hangups are always reported
+    epoll_event event{};
+    event.events = (connection.reading ? uint32_t{ EPOLLIN | EPOLLRDHUP } : 0u) | (connection.waitingToWrite ? uint32_t{ EPOLLOUT } : 0u);
+    event.data.fd = socket;
+    epoll_ctl(epoll, EPOLL_CTL_MOD, socket, &event);
+}
+
+void CharacterServer::close(int socket)
+{
+    epoll_ctl(epoll, EPOLL_CTL_DEL, socket, nullptr);
+    ::close(socket);
+    connections.erase(socket);
+}
+
+LoadReport LoadGenerator::run(const string& path, unsigned int connections, unsigned int commandsPerConnection, unsigned int pipelineDepth)
+{
+    const sockaddr_un address{ socketAddress(path) };
+    pipelineDepth = max(pipelineDepth, 1u);
+
+    vector<vector<chrono::nanoseconds>> latencies(connections);
+    vector<uint64_t> errors(connections);
+    vector<string> failures(connections);
+
+    auto client{ [&](unsigned int index)
+        {
+            const int socket{ ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0) };
+            try
+            {
+                if (socket < 0 || connect(socket, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0)
+                {
+                    throw runtime_error("could not connect to " + path + ": " + strerror(errno));
+                }
+
+                //each connection works on its own character; a regular optimize keeps the inventory small
+                string pending;
+                sendAll(socket, "use load" + to_string(index) + "\n");
+                errors[index] += awaitReplies(socket, pending, 1, chrono::steady_clock::now(), nullptr);
+
+                latencies[index].reserve(commandsPerConnection);
+                string batch;
+                for (unsigned int sent{ 0 }; sent < commandsPerConnection;)
+                {
+                    const unsigned int count{ min(pipelineDepth, commandsPerConnection - sent) };
+                    for (unsigned int i{ 0 }; i < count; i++, sent++)
+                    {
+                        if (sent % 8 == 7)
+                        {
+                            batch.append("optimize-inventory 500\n");
+                        }
+                        else
+                        {
+                            batch.append("add-weapon \"Load Sword\" ").append(to_string(sent % 500 + 1)).append(" 6 ").append(to_string(sent % 40)).append("\n");
+                        }
+                    }
+                    const chrono::steady_clock::time_point batchSent{ chrono::steady_clock::now() };
+                    sendAll(socket, batch);
+                    batch.clear();
+                    errors[index] += awaitReplies(socket, pending, count, batchSent, &latencies[index]);
+                }
+            }
+            catch (const exception& e)
+            {
+                failures[index] = e.what();
+            }
+            if (socket >= 0)
+            {
+                ::close(socket);
+            }
+        } };
+
+    const chrono::steady_clock::time_point started{ chrono::steady_clock::now() };
+    vector<thread> threads;
+    for (unsigned int index{ 0 }; index < connections; index++)
+    {
+        threads.emplace_back(client, index);
+    }
+    for (thread& worker : threads)
+    {
+        worker.join();
+    }
+    const double seconds{ chrono::duration<double>(chrono::steady_clock::now() - started).count() };
+
+    //throw an exception if any connection failed
+    for (const string& failure : failures)
+    {
+        if (!failure.empty())
+        {
+            throw runtime_error(failure);
+        }
+    }
+
+    LoadReport report;
+    vector<chrono::nanoseconds> all;
+    for (unsigned int index{ 0 }; index < connections; index++)
+    {
+        all.insert(all.end(), latencies[index].begin(), latencies[index].end());
+        report.errors += errors[index];
+    }
+    report.commands = static_cast<uint64_t>(connections) * commandsPerConnection;
+    report.seconds = seconds;
+    report.throughput = seconds > 0 ? report.commands / seconds : 0.0;
+    if (!all.empty())
+    {
+        sort(all.begin(), all.end());
+        report.p50 = all[all.size() / 2];
+        report.p99 = all[min(all.size() - 1, all.size() * 99 / 100)];
+    }
+    return report;
+}
+#endif
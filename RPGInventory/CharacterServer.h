@@ -0,0 +1,154 @@
+#pragma once
+#ifdef __linux__
+#include "Character.h"
+#include "CommandProcessor.h"
+#include <cstddef>
+#include <cstdint>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Hosts many characters for local clients connected to a Unix-domain socket.
+//
+// Clients send the text commands of CommandProcessor, one per line, and may pipeline as many as they
+// like without waiting for replies.  Each connection starts on the character named "default";
+// "use <name>" switches it to another character, creating it the first time the name is used.
+// Every command gets one reply, in order:
+//   ok\n                      the command succeeded and printed nothing
+//   ok <length>\n<output>     the command succeeded and printed length bytes
+//   error <message>\n         the command failed and the character is unchanged
+// A line longer than MAX_LINE_LENGTH is not run; its reply is "error line too long".
+//
+// A single thread runs an epoll event loop.  Replies to everything read in one pass of the loop are
+// collected per connection and sent with one write each, so a pipelined batch costs one system call
+// in each direction.  A client that keeps sending without reading its replies stops being read from
+// once more than MAX_UNSENT_OUTPUT bytes of replies are waiting, until they drop back under it, so
+// what the server holds for it is bounded by that plus the replies to a single read.
+// Only available on Linux.
+class CharacterServer
+{
+public:
+    // The longest line a client may send, not counting the newline.
+    const static std::size_t MAX_LINE_LENGTH = 1 << 16;
+
+    // How many bytes of replies may wait for a client before its connection stops being read.
+    const static std::size_t MAX_UNSENT_OUTPUT = 1 << 20;
+
+    // Listens on the socket at path, replacing any stale socket file there.
+    // A runtime_error is thrown if the socket can't be created.
+    explicit CharacterServer(const std::string& path);
+
+    // Closes every connection and removes the socket file.
+    ~CharacterServer();
+
+    // Copying is deleted; each server owns its socket.
+    CharacterServer(const CharacterServer& server) = delete;
+
+    // Copy assignment is deleted; each server owns its socket.
+    CharacterServer& operator = (const CharacterServer& server) = delete;
+
+    // Serves clients until requestStop() is called.
+    void run();
+
+    // Makes run() return.  Safe to call from another thread or a signal handler.
+    void requestStop();
+
+    // Gets the number of characters hosted.  Only call this while run() isn't running.
+    std::size_t getCharacterCount() const;
+
+private:
+    // A hosted character and the processor that runs commands against it
+    struct Hosted
+    {
+        Character character;
+        CommandProcessor processor{ character };
+    };
+
+    // One client connection
+    struct Connection
+    {
+        // Bytes received that don't make a whole line yet
+        std::string input;
+
+        // True while the rest of a line that grew past MAX_LINE_LENGTH is being skipped
+        bool skippingLine{ false };
+
+        // Replies not yet sent, starting at outputOffset
+        std::string output;
+        std::size_t outputOffset{ 0 };
+
+        // True while the socket is registered for EPOLLOUT because a send would have blocked
+        bool waitingToWrite{ false };
+
+        // False while the socket isn't registered for EPOLLIN because too much output is unsent
+        bool reading{ true };
+
+        // The character the connection's commands run against
+        Hosted* hosted{ nullptr };
+    };
+
+    std::string path;
+    int listener{ -1 };
+    int epoll{ -1 };
+    int stopEvent{ -1 };
+
+    // Open connections by file descriptor
+    std::unordered_map<int, Connection> connections;
+
+    // Hosted characters by name
+    std::unordered_map<std::string, std::unique_ptr<Hosted>> characters;
+
+    // Gets the character with this name, creating it if needed
+    Hosted& host(std::string_view name);
+
+    // Accepts every pending connection
+    void acceptConnections();
+
+    // Reads everything available and runs each whole line; returns false if the client has gone
+    bool receive(int socket, Connection& connection);
+
+    // Runs one line and appends its reply
+    void handleLine(Connection& connection, std::string_view line);
+
+    // Sends as much of the pending output as the socket takes; returns false if the client has gone
+    bool send(int socket, Connection& connection);
+
+    // Registers the socket for the events its connection's state calls for
+    void watch(int socket, const Connection& connection);
+
+    // Closes a connection
+    void close(int socket);
+
+    // Closes every descriptor and removes the socket file
+    void release();
+};
+
+// Results of a run of LoadGenerator.
+struct LoadReport
+{
+    // Commands sent and replies that were errors
+    std::uint64_t commands{ 0 };
+    std::uint64_t errors{ 0 };
+
+    // Wall time of the whole run, in seconds, and commands per second
+    double seconds{ 0.0 };
+    double throughput{ 0.0 };
+
+    // Time from sending a command until its reply arrived
+    std::chrono::nanoseconds p50{ 0 };
+    std::chrono::nanoseconds p99{ 0 };
+};
+
+// A client for load testing a CharacterServer.  Each connection runs on its own thread against its
+// own character, sending commands in pipelined batches and timing every reply.
+class LoadGenerator
+{
+public:
+    // Sends commandsPerConnection commands on each of the connections, pipelineDepth at a time.
+    // A runtime_error is thrown if a connection fails.
+    static LoadReport run(const std::string& path, unsigned int connections, unsigned int commandsPerConnection, unsigned int pipelineDepth);
+};
+#endif
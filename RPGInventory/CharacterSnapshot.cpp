@@ -0,0 +1,112 @@
+#include "CharacterSnapshot.h"
+#include "CharacterSerializer.h"
+#include "DurableFile.h"
+#include <stdexcept>
+#include <sstream>
+
+using namespace std;
+
+CharacterSnapshot::CharacterSnapshot(const Character& character)
+{
+    //only pointers are copied; the items themselves are shared with the character
+    character.inventory.shareItems(inventory);
+    for (unsigned int slotID{ 0 }; slotID < Armor::SLOT_COUNT; slotID++)
+    {
+        armor[slotID] = character.equipment.shareArmor(slotID);
+    }
+    weapon = character.equipment.shareWeapon();
+}
+
+const vector<ItemPtr<const Item>>& CharacterSnapshot::getInventory() const
+{
+    return inventory;
+}
+
+const Armor* CharacterSnapshot::getEquippedArmor(unsigned int slotID) const
+{
+    //throw an out_of_range exception if slotID is greater than 5
+    if (slotID >= Armor::SLOT_COUNT)
+    {
+        throw out_of_range("slotID should be between 0-5");
+    }
+    return armor[slotID].get();
+}
+
+const Weapon* CharacterSnapshot::getEquippedWeapon() const
+{
+    return weapon.get();
+}
+
+AsyncSnapshotter::~AsyncSnapshotter()
+{
+    //don't leave a write running after the snapshotter is gone
+    if (pending.valid())
+    {
+        pending.wait();
+    }
+}
+
+void AsyncSnapshotter::start(const Character& character, const string& path)
+{
+    //throw an exception if the previous snapshot's result hasn't been collected
+    if (pending.valid())
+    {
+        throw logic_error("a snapshot is already pending");
+    }
+
+    //capturing is the only part that has to happen while the character can't change
+    const chrono::steady_clock::time_point started{ chrono::steady_clock::now() };
+#ifdef RPG_SINGLE_THREADED
+    //the items' reference counts aren't atomic in this build, so no handle to them can go to another
+    //thread; the character is encoded here, which costs no more than copying the items would, and only
+    //the write happens in the background
+    ostringstream saved;
+    CharacterSerializer::save(character, saved);
+    shared_ptr<const string> encoded{ make_shared<const string>(saved.str()) };
+    const chrono::microseconds captureTime{ chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - started) };
+
+    pending = async(launch::async, [encoded, path, started, captureTime]()
+        {
+            const string& contents{ *encoded };
+            replaceFile(path, contents);
+#else
+    shared_ptr<const CharacterSnapshot> snapshot{ make_shared<const CharacterSnapshot>(character) };
+    const chrono::microseconds captureTime{ chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - started) };
+
+    pending = async(launch::async, [snapshot, path, started, captureTime]()
+        {
+            ostringstream saved;
+            CharacterSerializer::save(*snapshot, saved);
+            const string contents{ saved.str() };
+            replaceFile(path, contents);
+#endif
+
+            SnapshotStatistics statistics;
+            statistics.captureTime = captureTime;
+            statistics.latency = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - started);
+            statistics.bytesWritten = contents.size();
+            return statistics;
+        });
+}
+
+bool AsyncSnapshotter::isPending() const
+{
+    return pending.valid();
+}
+
+bool AsyncSnapshotter::isReady() const
+{
+    return pending.valid() && pending.wait_for(chrono::seconds{ 0 }) == future_status::ready;
+}
+
+SnapshotStatistics AsyncSnapshotter::wait()
+{
+    //throw an exception if there is nothing to wait for
+    if (!pending.valid())
+    {
+        throw logic_error("no snapshot is pending");
+    }
+
+    //get() rethrows anything the background thread threw
+    return pending.get();
+}
@@ -0,0 +1,94 @@
+#pragma once
+#include "Character.h"
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+// A point-in-time image of a character's inventory and equipment.  Items are never changed while a
+// character holds them (adds, drops and equips only move pointers around), so taking a snapshot only
+// copies shared references to the items rather than the items themselves.  The snapshot is unaffected
+// by later changes to the character and can be read from another thread while they happen.  When
+// RPG_SINGLE_THREADED is defined the items' reference counts aren't atomic, so a snapshot must stay on
+// the thread that holds the character.
+class CharacterSnapshot
+{
+public:
+    // Captures the character's current inventory and equipment.
+    explicit CharacterSnapshot(const Character& character);
+
+    // Gets the inventory, in descending value to weight order.
+    const std::vector<ItemPtr<const Item>>& getInventory() const;
+
+    // Gets the armor piece that was equipped in a slot, or nullptr if the slot was empty.
+    // An out_of_range exception is thrown if slotID is not 0, 1, 2, 3, 4, or 5.
+    const Armor* getEquippedArmor(unsigned int slotID) const;
+
+    // Gets the weapon that was equipped, or nullptr if none was.
+    const Weapon* getEquippedWeapon() const;
+
+private:
+    // The inventory at the time of the snapshot
+    std::vector<ItemPtr<const Item>> inventory;
+
+    // The equipment at the time of the snapshot
+    std::array<ItemPtr<const Armor>, Armor::SLOT_COUNT> armor;
+    ItemPtr<const Weapon> weapon;
+};
+
+// Timings and size of one background snapshot.
+struct SnapshotStatistics
+{
+    // Time the calling thread spent capturing the snapshot (and encoding it, when RPG_SINGLE_THREADED is
+    // defined); the only part that blocks mutations
+    std::chrono::microseconds captureTime{ 0 };
+
+    // Time from the start of the snapshot until the file was written and synced
+    std::chrono::microseconds latency{ 0 };
+
+    // Size of the file written
+    std::uint64_t bytesWritten{ 0 };
+};
+
+// Saves snapshots of a character on a background thread.  start() captures a CharacterSnapshot on the
+// calling thread and returns; encoding it with CharacterSerializer and writing it to disk happen on
+// another thread while the character keeps changing.  When RPG_SINGLE_THREADED is defined the character
+// is encoded on the calling thread instead, and only the write happens in the background.  The file is
+// replaced in one step, so it holds either the previous snapshot or the new one, and loads with
+// CharacterSerializer::load().
+class AsyncSnapshotter
+{
+public:
+    // Default constructor
+    AsyncSnapshotter() = default;
+
+    // Waits for a snapshot that is still being written.
+    ~AsyncSnapshotter();
+
+    // Copying is deleted; a snapshot in progress belongs to one snapshotter.
+    AsyncSnapshotter(const AsyncSnapshotter& snapshotter) = delete;
+
+    // Copy assignment is deleted; a snapshot in progress belongs to one snapshotter.
+    AsyncSnapshotter& operator = (const AsyncSnapshotter& snapshotter) = delete;
+
+    // Captures the character and starts writing it to the file at path.
+    // A logic_error is thrown if the previous snapshot hasn't been waited for.
+    void start(const Character& character, const std::string& path);
+
+    // Returns true if a snapshot has been started and not yet waited for.
+    bool isPending() const;
+
+    // Returns true if the pending snapshot has finished writing, so wait() won't block.
+    bool isReady() const;
+
+    // Waits for the pending snapshot to finish and returns its statistics.
+    // A logic_error is thrown if no snapshot is pending, and a runtime_error if the write failed.
+    SnapshotStatistics wait();
+
+private:
+    // The snapshot being written
+    std::future<SnapshotStatistics> pending;
+};
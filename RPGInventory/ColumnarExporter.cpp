@@ -0,0 +1,248 @@
+#include "ColumnarExporter.h"
+#include <stdexcept>
+#include <cstring>
+
+using namespace std;
+
+namespace
+{
+    const char MAGIC[4]{ 'R', 'P', 'G', 'X' };
+    const uint32_t BYTE_ORDER_MARK{ 0x01020304 };
+
+    template <typename T>
+    void writeValue(ostream& out, T value)
+    {
+        out.write(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    //a whole column goes to the stream in a single write
+    template <typename T>
+    void writeColumn(ostream& out, const vector<T>& column)
+    {
+        out.write(reinterpret_cast<const char*>(column.data()), static_cast<streamsize>(column.size() * sizeof(T)));
+    }
+
+    template <typename T>
+    T readValue(istream& in)
+    {
+        T value{};
+        if (!in.read(reinterpret_cast<char*>(&value), sizeof(value)))
+        {
+            throw runtime_error("truncated columnar export");
+        }
+        return value;
+    }
+
+    //appends count values read straight into the end of the column
+    template <typename T>
+    void readColumn(istream& in, vector<T>& column, size_t count)
+    {
+        const size_t start{ column.size() };
+        column.resize(start + count);
+        if (!in.read(reinterpret_cast<char*>(column.data() + start), static_cast<streamsize>(count * sizeof(T))))
+        {
+            throw runtime_error("truncated columnar export");
+        }
+    }
+}
+
+ColumnarExporter::ColumnarExporter(ostream& out) : out{ out }
+{
+    out.write(MAGIC, sizeof(MAGIC));
+    writeValue<uint32_t>(out, BYTE_ORDER_MARK);
+    writeValue<uint32_t>(out, VERSION);
+}
+
+uint32_t ColumnarExporter::addCharacter(const Character& character)
+{
+    //throw an exception if the footer has already been written
+    if (finished)
+    {
+        throw logic_error("export has already been finished");
+    }
+
+    const uint32_t characterID{ characterCount++ };
+    character.getInventory().forEach([this, characterID](const Item& item)
+        {
+            addRow(characterID, item, false);
+        });
+    for (unsigned int slotID{ 0 }; slotID < Armor::SLOT_COUNT; slotID++)
+    {
+        if (character.getEquippedArmor(slotID))
+        {
+            addRow(characterID, *character.getEquippedArmor(slotID), true);
+        }
+    }
+    if (character.getEquippedWeapon())
+    {
+        addRow(characterID, *character.getEquippedWeapon(), true);
+    }
+
+    return characterID;
+}
+
+void ColumnarExporter::finish()
+{
+    //throw an exception if the footer has already been written
+    if (finished)
+    {
+        throw logic_error("export has already been finished");
+    }
+    finished = true;
+
+    writeGroup();
+    writeValue<uint32_t>(out, 0);
+
+    //the dictionary is only complete once every row has been seen
+    writeValue<uint32_t>(out, static_cast<uint32_t>(names.size()));
+    for (const string* name : names)
+    {
+        writeValue<uint32_t>(out, static_cast<uint32_t>(name->size()));
+        out.write(name->data(), static_cast<streamsize>(name->size()));
+    }
+
+    writeValue<uint64_t>(out, rowCount);
+    writeValue<uint32_t>(out, characterCount);
+    out.write(MAGIC, sizeof(MAGIC));
+    out.flush();
+
+    //throw an exception if the stream failed, rather than leave a truncated export behind
+    if (!out)
+    {
+        throw runtime_error("could not write columnar export");
+    }
+}
+
+uint64_t ColumnarExporter::getRowCount() const
+{
+    return rowCount;
+}
+
+ColumnarTable ColumnarExporter::read(istream& in)
+{
+    //throw an exception if this isn't an export this version can read
+    char magic[4];
+    if (!in.read(magic, sizeof(magic)) || memcmp(magic, MAGIC, sizeof(MAGIC)) != 0)
+    {
+        throw runtime_error("not a columnar export");
+    }
+    if (readValue<uint32_t>(in) != BYTE_ORDER_MARK)
+    {
+        throw runtime_error("columnar export was written with a different byte order");
+    }
+    if (readValue<uint32_t>(in) != VERSION)
+    {
+        throw runtime_error("unsupported columnar export version");
+    }
+
+    ColumnarTable table;
+    for (uint32_t count{ readValue<uint32_t>(in) }; count != 0; count = readValue<uint32_t>(in))
+    {
+        if (count > ROWS_PER_GROUP)
+        {
+            throw runtime_error("corrupt columnar export: row group size");
+        }
+        readColumn(in, table.characterIDs, count);
+        readColumn(in, table.kinds, count);
+        readColumn(in, table.nameIDs, count);
+        readColumn(in, table.goldValues, count);
+        readColumn(in, table.weights, count);
+        readColumn(in, table.damages, count);
+        readColumn(in, table.slots, count);
+        readColumn(in, table.ratings, count);
+        readColumn(in, table.equipped, count);
+    }
+
+    const uint32_t nameCount{ readValue<uint32_t>(in) };
+    for (uint32_t i{ 0 }; i < nameCount; i++)
+    {
+        string name(readValue<uint32_t>(in), '\0');
+        if (!in.read(&name[0], static_cast<streamsize>(name.size())))
+        {
+            throw runtime_error("truncated columnar export");
+        }
+        table.names.push_back(move(name));
+    }
+
+    //check the footer against what was read
+    const uint64_t rows{ readValue<uint64_t>(in) };
+    readValue<uint32_t>(in);
+    if (!in.read(magic, sizeof(magic)) || memcmp(magic, MAGIC, sizeof(MAGIC)) != 0 || rows != table.kinds.size())
+    {
+        throw runtime_error("corrupt columnar export: footer");
+    }
+    for (uint32_t nameID : table.nameIDs)
+    {
+        if (nameID >= table.names.size())
+        {
+            throw runtime_error("corrupt columnar export: name ID");
+        }
+    }
+
+    return table;
+}
+
+void ColumnarExporter::addRow(uint32_t characterID, const Item& item, bool isEquipped)
+{
+    //look the name up in the dictionary, adding it the first time it's seen; find() first, since
+    //emplace() would allocate a node, and copy the name, even for a name that is already there
+    auto nameID{ nameIDs.find(item.getName()) };
+    if (nameID == nameIDs.end())
+    {
+        nameID = nameIDs.emplace(item.getName(), static_cast<uint32_t>(names.size())).first;
+        names.push_back(&nameID->first);
+    }
+
+    const ItemKind kind{ kindOf(item) };
+    group.characterIDs.push_back(characterID);
+    group.kinds.push_back(kind);
+    group.nameIDs.push_back(nameID->second);
+    group.goldValues.push_back(item.getGoldValue());
+    group.weights.push_back(item.getWeight());
+    group.damages.push_back(kind == ItemKind::Weapon ? static_cast<const Weapon&>(item).getDamage() : 0);
+    group.slots.push_back(kind == ItemKind::Armor ? static_cast<uint8_t>(static_cast<const Armor&>(item).getSlotID()) : 0);
+    group.ratings.push_back(kind == ItemKind::Armor ? static_cast<const Armor&>(item).getRating() : 0);
+    group.equipped.push_back(isEquipped ? 1 : 0);
+    rowCount++;
+
+    if (group.kinds.size() == ROWS_PER_GROUP)
+    {
+        writeGroup();
+    }
+}
+
+void ColumnarExporter::writeGroup()
+{
+    if (group.kinds.empty())
+    {
+        return;
+    }
+
+    writeValue<uint32_t>(out, static_cast<uint32_t>(group.kinds.size()));
+    writeColumn(out, group.characterIDs);
+    writeColumn(out, group.kinds);
+    writeColumn(out, group.nameIDs);
+    writeColumn(out, group.goldValues);
+    writeColumn(out, group.weights);
+    writeColumn(out, group.damages);
+    writeColumn(out, group.slots);
+    writeColumn(out, group.ratings);
+    writeColumn(out, group.equipped);
+
+    //throw an exception if the stream failed, rather than leave a truncated export behind
+    if (!out)
+    {
+        throw runtime_error("could not write columnar export");
+    }
+
+    //clear() keeps the capacity, so the next group doesn't reallocate
+    group.characterIDs.clear();
+    group.kinds.clear();
+    group.nameIDs.clear();
+    group.goldValues.clear();
+    group.weights.clear();
+    group.damages.clear();
+    group.slots.clear();
+    group.ratings.clear();
+    group.equipped.clear();
+}
@@ -0,0 +1,105 @@
+#pragma once
+#include "Character.h"
+#include "ItemKind.h"
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// The rows of a columnar export, one vector per column, as read back by ColumnarExporter::read().
+struct ColumnarTable
+{
+    // Which character each row belongs to, numbered in the order they were added
+    std::vector<std::uint32_t> characterIDs;
+
+    // The attributes of each row's item; damage is 0 for anything but a weapon, slot and rating
+    // are 0 for anything but armor
+    std::vector<ItemKind> kinds;
+    std::vector<std::uint32_t> nameIDs;
+    std::vector<std::uint32_t> goldValues;
+    std::vector<double> weights;
+    std::vector<std::int32_t> damages;
+    std::vector<std::uint8_t> slots;
+    std::vector<std::int32_t> ratings;
+
+    // 1 if the item is equipped, 0 if it is in the inventory
+    std::vector<std::uint8_t> equipped;
+
+    // The distinct item names; nameIDs index into this
+    std::vector<std::string> names;
+};
+
+// Exports the items of many characters to a columnar file for offline analysis.
+//
+// Rows are buffered in typed columns and written a row group at a time, each column as one large
+// sequential write, so exporting is bound by the output rather than by formatting.  Names are
+// replaced by IDs into a dictionary that is written once, after the last row group.
+//
+// Layout, with fixed-width values in the host's byte order:
+//   "RPGX" magic, uint32 byte-order mark 0x01020304, uint32 version
+//   row groups: uint32 row count, then each column of the group in ColumnarTable order
+//   a row count of 0, ending the row groups
+//   name dictionary: uint32 count, then each name as a uint32 length and its bytes
+//   uint64 total rows, uint32 character count, "RPGX" magic
+class ColumnarExporter
+{
+public:
+    // The number of rows buffered before a row group is written.
+    const static unsigned int ROWS_PER_GROUP = 65536;
+
+    // The version written to the header.
+    const static unsigned int VERSION = 1;
+
+    // Starts an export to the stream by writing the header.
+    explicit ColumnarExporter(std::ostream& out);
+
+    // Copying is deleted; an export in progress belongs to one exporter.
+    ColumnarExporter(const ColumnarExporter& exporter) = delete;
+
+    // Copy assignment is deleted; an export in progress belongs to one exporter.
+    ColumnarExporter& operator = (const ColumnarExporter& exporter) = delete;
+
+    // Adds a row for every item the character has: the inventory in order, then the equipped armor in
+    // slot order, then the equipped weapon.  Returns the character's ID in the export.
+    // A logic_error is thrown if the export has been finished, and a runtime_error if a full row group
+    // can't be written to the stream.
+    std::uint32_t addCharacter(const Character& character);
+
+    // Writes the remaining rows, the name dictionary and the footer.
+    // A logic_error is thrown if the export has already been finished, and a runtime_error if the
+    // stream fails.
+    void finish();
+
+    // Gets the number of rows added so far.
+    std::uint64_t getRowCount() const;
+
+    // Reads a whole export back into memory.
+    // A runtime_error is thrown if the data is not a valid export.
+    static ColumnarTable read(std::istream& in);
+
+private:
+    // The stream being written to
+    std::ostream& out;
+
+    // The rows of the current row group
+    ColumnarTable group;
+
+    // The ID of each name seen so far, and the names in ID order
+    std::unordered_map<std::string, std::uint32_t> nameIDs;
+    std::vector<const std::string*> names;
+
+    // Totals for the footer
+    std::uint64_t rowCount{ 0 };
+    std::uint32_t characterCount{ 0 };
+
+    // True once finish() has been called
+    bool finished{ false };
+
+    // Buffers one row
+    void addRow(std::uint32_t characterID, const Item& item, bool isEquipped);
+
+    // Writes the buffered rows as a row group and clears them
+    void writeGroup();
+};
@@ -1,11 +1,24 @@
 #include <iostream>
+#include <fstream>
 #include <string>
+#include <chrono>
+#include <charconv>
+#include <cstring>
 #include "Character.h"
+#include "CommandProcessor.h"
 #include "Item.h"
 #include "Armor.h"
 #include "Weapon.h"
+#include "CharacterServer.h"
+#ifdef __linux__
+#include <csignal>
+#endif
 using namespace std;
 
+int runBatch(istream& in);
+int runDaemon(const string& path);
+int runLoad(const string& path, unsigned int connections, unsigned int commands, unsigned int depth);
+bool parseCount(const char* text, unsigned int& count);
 unsigned int askForUserInput();
 bool executeUserInput(Character& character, unsigned int userInput);
 void printOptions();
@@ -23,8 +36,44 @@ Weapon createWeapon();
 Armor createArmor();
 
 
-int main()
+int main(int argc, char* argv[])
 {
+    //batch mode: "--batch" reads commands from stdin, "--batch path" from a file
+    if (argc > 1 && string{ argv[1] } == "--batch")
+    {
+        if (argc > 2 && string{ argv[2] } != "-")
+        {
+            ifstream script{ argv[2] };
+            if (!script)
+            {
+                cerr << "Error (Could not open script): " << argv[2] << "\n";
+                return 1;
+            }
+            return runBatch(script);
+        }
+        return runBatch(cin);
+    }
+
+    //daemon mode: "--daemon path" serves characters on a Unix socket until interrupted
+    if (argc > 2 && string{ argv[1] } == "--daemon")
+    {
+        return runDaemon(argv[2]);
+    }
+
+    //load mode: "--load path [connections] [commands per connection] [pipeline depth]" measures a daemon
+    if (argc > 2 && string{ argv[1] } == "--load")
+    {
+        unsigned int connections{ 4 };
+        unsigned int commands{ 100000 };
+        unsigned int depth{ 64 };
+        if ((argc > 3 && !parseCount(argv[3], connections)) || (argc > 4 && !parseCount(argv[4], commands))
+            || (argc > 5 && !parseCount(argv[5], depth)))
+        {
+            return 1;
+        }
+        return runLoad(argv[2], connections, commands, depth);
+    }
+
     // TODO: Implement your command-line interface (CLI) here.
     Character character;
 
@@ -34,6 +83,131 @@ int main()
     return 0;
 }
 
+int runBatch(istream& in)
+{
+    //no menus or prompts; output is collected and written in large blocks
+    ios::sync_with_stdio(false);
+    Character character;
+    CommandProcessor processor{ character };
+    string output;
+    string line;
+    unsigned long long lineNumber{ 0 };
+    unsigned long long commands{ 0 };
+    unsigned long long errors{ 0 };
+
+    const chrono::steady_clock::time_point started{ chrono::steady_clock::now() };
+    while (getline(in, line))
+    {
+        lineNumber++;
+        try
+        {
+            if (processor.execute(line, output))
+            {
+                commands++;
+            }
+        }
+        catch (const exception& e)
+        {
+            //report the line and carry on with the next one
+            commands++;
+            errors++;
+            output.append("Error on line ").append(to_string(lineNumber)).append(": ").append(e.what()).append("\n");
+        }
+
+        if (output.size() >= (1 << 16))
+        {
+            cout.write(output.data(), output.size());
+            output.clear();
+        }
+    }
+    const double seconds{ chrono::duration<double>(chrono::steady_clock::now() - started).count() };
+
+    cout.write(output.data(), output.size());
+    cout.flush();
+
+    //the summary goes to stderr so it doesn't mix with the commands' output
+    cerr << commands << " commands (" << errors << " errors) in " << seconds << " s, "
+         << (seconds > 0 ? commands / seconds : 0.0) << " ops/sec" << "\n";
+
+    return errors == 0 ? 0 : 1;
+}
+
+#ifdef __linux__
+namespace
+{
+    CharacterServer* runningServer{ nullptr };
+
+    void stopServer(int)
+    {
+        runningServer->requestStop();
+    }
+}
+
+int runDaemon(const string& path)
+{
+    try
+    {
+        CharacterServer server{ path };
+        runningServer = &server;
+        signal(SIGINT, stopServer);
+        signal(SIGTERM, stopServer);
+        cerr << "Serving characters on " << path << "\n";
+        server.run();
+        signal(SIGINT, SIG_DFL);
+        signal(SIGTERM, SIG_DFL);
+        cerr << "Stopped with " << server.getCharacterCount() << " characters\n";
+    }
+    catch (const exception& e)
+    {
+        cerr << "Error (" << e.what() << ")\n";
+        return 1;
+    }
+    return 0;
+}
+
+int runLoad(const string& path, unsigned int connections, unsigned int commands, unsigned int depth)
+{
+    try
+    {
+        const LoadReport report{ LoadGenerator::run(path, connections, commands, depth) };
+        cout << report.commands << " commands (" << report.errors << " errors) on " << connections
+             << " connections in " << report.seconds << " s, " << report.throughput << " ops/sec\n"
+             << "latency p50 " << report.p50.count() / 1000.0 << " us, p99 " << report.p99.count() / 1000.0 << " us\n";
+        return report.errors == 0 ? 0 : 1;
+    }
+    catch (const exception& e)
+    {
+        cerr << "Error (" << e.what() << ")\n";
+        return 1;
+    }
+}
+#else
+int runDaemon(const string&)
+{
+    cerr << "Error (Daemon mode is only available on Linux)\n";
+    return 1;
+}
+
+int runLoad(const string&, unsigned int, unsigned int, unsigned int)
+{
+    cerr << "Error (Load mode is only available on Linux)\n";
+    return 1;
+}
+#endif
+
+bool parseCount(const char* text, unsigned int& count)
+{
+    //the whole argument has to be a number that fits, or the run would use a count nobody asked for
+    const char* end{ text + strlen(text) };
+    const from_chars_result result{ from_chars(text, end, count) };
+    if (result.ec != errc{} || result.ptr != end)
+    {
+        cerr << "Error (Invalid count): " << text << "\n";
+        return false;
+    }
+    return true;
+}
+
 unsigned int askForUserInput()
 {
     unsigned int userInput;
@@ -193,7 +367,7 @@ void createItemHelper(Item& item)
         //get user input for the name of the item
         cout << "What is the name of the item?" << "\n";
         getline(cin, userInput);
-        item.setName(userInput);
+        item.setName(move(userInput));
     } while (userInputFailed()); //repeat while user input fails the test
 
     cout << "\n";
@@ -0,0 +1,279 @@
+#include "CommandProcessor.h"
+#include "CharacterFormatter.h"
+#include <stdexcept>
+#include <charconv>
+#include <cmath>
+
+using namespace std;
+
+namespace
+{
+    //converts a whole argument to a number, throwing an exception naming it if it can't
+    template <typename T>
+    T parseNumber(string_view text, const char* what)
+    {
+        T value{};
+        const char* end{ text.data() + text.size() };
+        const from_chars_result result{ from_chars(text.data(), end, value) };
+        if (result.ec != errc{} || result.ptr != end)
+        {
+            throw runtime_error(string{ "invalid " } + what + ": " + string{ text });
+        }
+        return value;
+    }
+
+    double parseWeight(string_view text, const char* what)
+    {
+        const double weight{ parseNumber<double>(text, what) };
+        if (!isfinite(weight))
+        {
+            throw runtime_error(string{ "invalid " } + what + ": " + string{ text });
+        }
+        return weight;
+    }
+}
+
+CommandProcessor::CommandProcessor(Character& character) : character{ character }
+{
+}
+
+bool CommandProcessor::execute(string_view line, string& out)
+{
+    if (tokenize(line) == 0)
+    {
+        return false;
+    }
+
+    const string_view command{ arguments[0] };
+    if (command == "add-item")
+    {
+        expectArguments(command, 4);
+        character.addItem(readItem(1));
+    }
+    else if (command == "add-weapon")
+    {
+        expectArguments(command, 5);
+        character.addItem(readWeapon(1));
+    }
+    else if (command == "add-armor")
+    {
+        expectArguments(command, 6);
+        character.addItem(readArmor(1));
+    }
+    else if (command == "drop-item")
+    {
+        expectArguments(command, 4);
+        character.dropItem(readItemKey(1));
+    }
+    else if (command == "drop-weapon")
+    {
+        expectArguments(command, 5);
+        character.dropItem(readWeaponKey(1));
+    }
+    else if (command == "drop-armor")
+    {
+        expectArguments(command, 6);
+        character.dropItem(readArmorKey(1));
+    }
+    else if (command == "equip-weapon")
+    {
+        expectArguments(command, 5);
+        character.equipWeapon(readWeaponKey(1));
+    }
+    else if (command == "equip-armor")
+    {
+        expectArguments(command, 6);
+        character.equipArmor(readArmorKey(1));
+    }
+    else if (command == "unequip-weapon")
+    {
+        expectArguments(command, 1);
+        character.unequipWeapon();
+    }
+    else if (command == "unequip-armor")
+    {
+        expectArguments(command, 2);
+        character.unequipArmor(parseNumber<unsigned int>(arguments[1], "slot"));
+    }
+    else if (command == "optimize-inventory")
+    {
+        expectArguments(command, 2);
+        character.optimizeInventory(parseWeight(arguments[1], "maximum weight"));
+    }
+    else if (command == "optimize-equipment")
+    {
+        expectArguments(command, 1);
+        character.optimizeEquipment();
+    }
+    else if (command == "search")
+    {
+        //search "text" finds names starting with the text in any case; search exact "text" finds whole names
+        if (argumentCount == 3 && arguments[1] == "exact")
+        {
+            appendItems(character.getInventory().searchByName(arguments[2], NameSearch::Exact), out);
+        }
+        else
+        {
+            expectArguments(command, 2);
+            appendItems(character.getInventory().searchByName(arguments[1], NameSearch::PrefixIgnoringCase), out);
+        }
+    }
+    else if (command == "print")
+    {
+        expectArguments(command, 1);
+        CharacterFormatter::appendTo(character, out);
+    }
+    else
+    {
+        throw runtime_error("unknown command: " + string{ command });
+    }
+
+    return true;
+}
+
+Character& CommandProcessor::getCharacter()
+{
+    return character;
+}
+
+size_t CommandProcessor::tokenize(string_view line)
+{
+    argumentCount = 0;
+    size_t position{ 0 };
+    while (true)
+    {
+        while (position < line.size() && (line[position] == ' ' || line[position] == '\t' || line[position] == '\r'))
+        {
+            position++;
+        }
+        if (position >= line.size() || (argumentCount == 0 && line[position] == '#'))
+        {
+            break;
+        }
+        if (argumentCount == arguments.size())
+        {
+            throw runtime_error("too many arguments");
+        }
+
+        if (line[position] == '"')
+        {
+            //a quoted name; only one that contains escapes is copied
+            const size_t start{ position + 1 };
+            bool escaped{ false };
+            for (position = start; position < line.size() && line[position] != '"'; position++)
+            {
+                if (line[position] == '\\')
+                {
+                    escaped = true;
+                    position++;
+                }
+            }
+            if (position >= line.size())
+            {
+                throw runtime_error("unterminated quoted name");
+            }
+
+            string_view name{ line.substr(start, position - start) };
+            if (escaped)
+            {
+                scratch.clear();
+                for (size_t i{ 0 }; i < name.size(); i++)
+                {
+                    if (name[i] == '\\')
+                    {
+                        i++;
+                    }
+                    scratch.push_back(name[i]);
+                }
+                name = scratch;
+            }
+            arguments[argumentCount++] = name;
+            position++; //skip the closing quote
+        }
+        else
+        {
+            const size_t start{ position };
+            while (position < line.size() && line[position] != ' ' && line[position] != '\t' && line[position] != '\r')
+            {
+                position++;
+            }
+            arguments[argumentCount++] = line.substr(start, position - start);
+        }
+    }
+
+    return argumentCount;
+}
+
+void CommandProcessor::expectArguments(string_view command, size_t expected) const
+{
+    if (argumentCount != expected)
+    {
+        throw runtime_error(string{ command } + " takes " + to_string(expected - 1) + " arguments, found " + to_string(argumentCount - 1));
+    }
+}
+
+void CommandProcessor::appendItems(const vector<ItemPtr<const Item>>& items, string& out)
+{
+    for (const ItemPtr<const Item>& item : items)
+    {
+        item->appendTo(out);
+        out.push_back('\n');
+    }
+}
+
+Item CommandProcessor::readItem(size_t first)
+{
+    Item item;
+    item.setName(string{ arguments[first] });
+    item.setGoldValue(parseNumber<unsigned int>(arguments[first + 1], "gold value"));
+    item.setWeight(parseWeight(arguments[first + 2], "weight"));
+    return item;
+}
+
+Weapon CommandProcessor::readWeapon(size_t first)
+{
+    Weapon weapon;
+    weapon.setName(string{ arguments[first] });
+    weapon.setGoldValue(parseNumber<unsigned int>(arguments[first + 1], "gold value"));
+    weapon.setWeight(parseWeight(arguments[first + 2], "weight"));
+    weapon.setDamage(parseNumber<int>(arguments[first + 3], "damage"));
+    return weapon;
+}
+
+Armor CommandProcessor::readArmor(size_t first)
+{
+    //setSlotID throws out_of_range for a slot that doesn't exist
+    Armor armor;
+    armor.setName(string{ arguments[first] });
+    armor.setGoldValue(parseNumber<unsigned int>(arguments[first + 1], "gold value"));
+    armor.setWeight(parseWeight(arguments[first + 2], "weight"));
+    armor.setSlotID(parseNumber<unsigned int>(arguments[first + 3], "slot"));
+    armor.setRating(parseNumber<int>(arguments[first + 4], "rating"));
+    return armor;
+}
+
+ItemKey CommandProcessor::readItemKey(size_t first) const
+{
+    //the key views the name in place, which stays put until the next line
+    return ItemKey{ arguments[first], parseNumber<unsigned int>(arguments[first + 1], "gold value"), parseWeight(arguments[first + 2], "weight") };
+}
+
+ItemKey CommandProcessor::readWeaponKey(size_t first) const
+{
+    return ItemKey{ arguments[first], parseNumber<unsigned int>(arguments[first + 1], "gold value"), parseWeight(arguments[first + 2], "weight"),
+        parseNumber<int>(arguments[first + 3], "damage") };
+}
+
+ItemKey CommandProcessor::readArmorKey(size_t first) const
+{
+    const unsigned int goldValue{ parseNumber<unsigned int>(arguments[first + 1], "gold value") };
+    const double weight{ parseWeight(arguments[first + 2], "weight") };
+
+    //the same check as Armor::setSlotID, so a bad slot is reported the same way as when adding armor
+    const unsigned int slotID{ parseNumber<unsigned int>(arguments[first + 3], "slot") };
+    if (slotID >= Armor::SLOT_COUNT)
+    {
+        throw out_of_range("Invalid slot ID: " + to_string(slotID));
+    }
+    return ItemKey{ arguments[first], goldValue, weight, slotID, parseNumber<int>(arguments[first + 4], "rating") };
+}
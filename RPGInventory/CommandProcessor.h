@@ -0,0 +1,65 @@
+#pragma once
+#include "Character.h"
+#include <array>
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <memory>
+#include <vector>
+
+// Runs compact one-line commands against a character, for scripts and other non-interactive use.
+//
+// Each line is a command followed by its arguments, separated by spaces.  Names are written in double
+// quotes, with \" and \\ for a quote and a backslash.  Blank lines and lines starting with # are ignored.
+//   add-item "Name" gold weight            drop-item "Name" gold weight
+//   add-weapon "Name" gold weight damage   drop-weapon "Name" gold weight damage
+//   add-armor "Name" gold weight slot rating
+//   drop-armor "Name" gold weight slot rating
+//   equip-weapon "Name" gold weight damage
+//   equip-armor "Name" gold weight slot rating
+//   unequip-weapon                         unequip-armor slot
+//   optimize-inventory maximumWeight       optimize-equipment
+//   search "Prefix"                        search exact "Name"
+//   print
+class CommandProcessor
+{
+public:
+    // Creates a processor that runs commands against the character.
+    explicit CommandProcessor(Character& character);
+
+    // Runs one command line, appending anything it prints to out.  Returns false if the line held no
+    // command.  A runtime_error is thrown if the command is malformed; otherwise any exception thrown
+    // by the Character function (a logic_error or out_of_range) is passed on.
+    bool execute(std::string_view line, std::string& out);
+
+    // Gets the character the commands run against.
+    Character& getCharacter();
+
+private:
+    // The character the commands run against
+    Character& character;
+
+    // The arguments of the current line; names are unescaped into scratch only if they need it
+    std::array<std::string_view, 8> arguments;
+    std::size_t argumentCount{ 0 };
+    std::string scratch;
+
+    // Splits a line into arguments, returning the number found
+    std::size_t tokenize(std::string_view line);
+
+    // Throws a runtime_error unless the command was given the expected number of arguments
+    void expectArguments(std::string_view command, std::size_t expected) const;
+
+    // Appends one line per item
+    static void appendItems(const std::vector<ItemPtr<const Item>>& items, std::string& out);
+
+    // Builds the item described by the arguments starting at the name
+    Item readItem(std::size_t first);
+    Weapon readWeapon(std::size_t first);
+    Armor readArmor(std::size_t first);
+
+    // Builds the key described by the arguments starting at the name, for commands that only look an item up
+    ItemKey readItemKey(std::size_t first) const;
+    ItemKey readWeaponKey(std::size_t first) const;
+    ItemKey readArmorKey(std::size_t first) const;
+};
@@ -0,0 +1,25 @@
+#pragma once
+#include <utility>
+#include <functional>
+#include "Item.h"
+
+//Functor type for the inventory's secondary indexes, which hold (key, item) pairs ordered by key.
+//The item pointer only breaks ties, so that every element is unique and can be erased directly.
+//A key on its own can also be used for a lookup such as lower_bound
+template <typename Key>
+struct CompareIndexKey
+{
+    using is_transparent = void;
+
+    bool operator()(const std::pair<Key, const Item*>& lhs, const std::pair<Key, const Item*>& rhs) const {
+        return lhs.first < rhs.first || (!(rhs.first < lhs.first) && std::less<const Item*>{}(lhs.second, rhs.second));
+    }
+
+    bool operator()(const std::pair<Key, const Item*>& lhs, Key rhs) const {
+        return lhs.first < rhs;
+    }
+
+    bool operator()(Key lhs, const std::pair<Key, const Item*>& rhs) const {
+        return lhs < rhs.first;
+    }
+};
@@ -1,15 +1,37 @@
 #pragma once
 #include <set>
 #include <memory>
-#include <typeindex>
+#include <cmath>
 #include "Item.h"
+#include "ItemPtr.h"
 
 //Functor type for the inventory multiset to be ordered in descending value to weight ratio
+//A ratio can also be used as the key of a lookup such as equal_range
 struct CompareValueToWeight
 {
-    bool operator()(const std::pair<std::type_index, std::shared_ptr<Item>>& lhs,
-        const std::pair<std::type_index, std::shared_ptr<Item>>& rhs) const {
-        return static_cast<double>(lhs.second->getGoldValue()) / lhs.second->getWeight() >
-            static_cast<double>(rhs.second->getGoldValue()) / rhs.second->getWeight();
+    using is_transparent = void;
+
+    //the value to weight ratio that the inventory is sorted by
+    static double ratio(const Item& item) {
+        return static_cast<double>(item.getGoldValue()) / item.getWeight();
+    }
+
+    //true if an item with the ratio lhs goes before one with the ratio rhs: higher ratios come first, and
+    //a ratio that isn't a number (a weightless item worth nothing) comes after every other, so the order
+    //stays consistent and a lookup by that ratio finds those items too
+    static bool before(double lhs, double rhs) {
+        return lhs > rhs || (std::isnan(rhs) && !std::isnan(lhs));
+    }
+
+    bool operator()(const ItemPtr<Item>& lhs, const ItemPtr<Item>& rhs) const {
+        return before(ratio(*lhs), ratio(*rhs));
+    }
+
+    bool operator()(const ItemPtr<Item>& lhs, double rhs) const {
+        return before(ratio(*lhs), rhs);
+    }
+
+    bool operator()(double lhs, const ItemPtr<Item>& rhs) const {
+        return before(lhs, ratio(*rhs));
     }
-};
\ No newline at end of file
+};
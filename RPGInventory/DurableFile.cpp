@@ -0,0 +1,94 @@
+#include "DurableFile.h"
+#include <stdexcept>
+#include <filesystem>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+namespace
+{
+    //makes a rename in the directory durable; Windows has no equivalent and doesn't need one
+    void syncDirectory(const string& path)
+    {
+#ifndef _WIN32
+        string directory{ filesystem::path{ path }.parent_path().string() };
+        const int handle{ open(directory.empty() ? "." : directory.c_str(), O_RDONLY) };
+        if (handle >= 0)
+        {
+            fsync(handle);
+            close(handle);
+        }
+#endif
+    }
+}
+
+FILE* openFile(const string& path, const char* mode)
+{
+#ifdef _WIN32
+    FILE* file{ nullptr };
+    if (fopen_s(&file, path.c_str(), mode) != 0)
+    {
+        file = nullptr;
+    }
+#else
+    FILE* file{ fopen(path.c_str(), mode) };
+#endif
+    if (!file)
+    {
+        throw runtime_error("could not open " + path);
+    }
+    return file;
+}
+
+void syncFile(FILE* file, const string& path)
+{
+#ifdef _WIN32
+    const bool synced{ fflush(file) == 0 && _commit(_fileno(file)) == 0 };
+#else
+    const bool synced{ fflush(file) == 0 && fsync(fileno(file)) == 0 };
+#endif
+    if (!synced)
+    {
+        throw runtime_error("could not sync " + path);
+    }
+}
+
+void replaceFile(const string& path, const string& contents)
+{
+    const string temporaryPath{ path + ".tmp" };
+    FILE* file{ openFile(temporaryPath, "wb") };
+    const bool written{ fwrite(contents.data(), 1, contents.size(), file) == contents.size() };
+    try
+    {
+        syncFile(file, temporaryPath);
+    }
+    catch (const runtime_error&)
+    {
+        fclose(file);
+        throw;
+    }
+    fclose(file);
+    if (!written)
+    {
+        throw runtime_error("could not write " + temporaryPath);
+    }
+
+    //a failed rename leaves the old file in place; don't leave the new one lying beside it
+    try
+    {
+        filesystem::rename(temporaryPath, path);
+    }
+    catch (const filesystem::filesystem_error&)
+    {
+        error_code ignored;
+        filesystem::remove(temporaryPath, ignored);
+        throw;
+    }
+    syncDirectory(path);
+}
@@ -0,0 +1,18 @@
+#pragma once
+#include <cstdio>
+#include <string>
+
+// Helpers for writing files that must survive a crash or power loss.
+// Each one throws a runtime_error if the file can't be opened or written.
+
+// Opens a file with fopen() modes.
+std::FILE* openFile(const std::string& path, const char* mode);
+
+// Flushes a file and waits until everything written to it has reached the disk.
+void syncFile(std::FILE* file, const std::string& path);
+
+// Replaces the file at path with the contents in one step: the contents are written and synced to a
+// temporary file beside it, which is then renamed over path.  After a crash the file holds either the
+// old or the new contents, never a mix.  On Windows the rename fails while path is mapped, as it is
+// by an open CharacterImage; then the temporary file is removed and path is left as it was.
+void replaceFile(const std::string& path, const std::string& contents);
@@ -0,0 +1,204 @@
+#include "Equipment.h"
+#include "ItemKind.h"
+#include <memory>
+#include <utility>
+
+using namespace std;
+
+const Armor* SharedEquipment::getArmor(unsigned int slotID) const
+{
+    return armorSlots[slotID].get();
+}
+
+const Weapon* SharedEquipment::getWeapon() const
+{
+    return weapon.get();
+}
+
+ItemPtr<const Armor> SharedEquipment::shareArmor(unsigned int slotID) const
+{
+    return armorSlots[slotID];
+}
+
+ItemPtr<const Weapon> SharedEquipment::shareWeapon() const
+{
+    return weapon;
+}
+
+ItemPtr<Armor> SharedEquipment::equipArmor(ItemPtr<Armor> armor)
+{
+    //take the old piece out first so the cached totals only ever describe what is in the slots
+    const unsigned int slotID{ armor->getSlotID() };
+    ItemPtr<Armor> replaced{ unequipArmor(slotID) };
+
+    totalArmorRating += armor->getRating();
+    armorMask |= 1u << slotID;
+    totalWeight.add(armor->getWeight());
+    armorSlots[slotID] = move(armor);
+
+    return replaced;
+}
+
+ItemPtr<Armor> SharedEquipment::unequipArmor(unsigned int slotID)
+{
+    //moving out of the slot leaves it as nullptr
+    ItemPtr<Armor> removed{ move(armorSlots[slotID]) };
+
+    if (removed)
+    {
+        totalArmorRating -= removed->getRating();
+        armorMask &= ~(1u << slotID);
+        totalWeight.subtract(removed->getWeight());
+    }
+
+    return removed;
+}
+
+ItemPtr<Weapon> SharedEquipment::equipWeapon(ItemPtr<Weapon> weapon)
+{
+    ItemPtr<Weapon> replaced{ unequipWeapon() };
+
+    totalWeight.add(weapon->getWeight());
+    this->weapon = move(weapon);
+
+    return replaced;
+}
+
+ItemPtr<Weapon> SharedEquipment::unequipWeapon()
+{
+    //moving out of the weapon leaves it as nullptr
+    ItemPtr<Weapon> removed{ move(weapon) };
+
+    if (removed)
+    {
+        totalWeight.subtract(removed->getWeight());
+    }
+
+    return removed;
+}
+
+int SharedEquipment::getTotalArmorRating() const
+{
+    return totalArmorRating;
+}
+
+unsigned int SharedEquipment::getArmorMask() const
+{
+    return armorMask;
+}
+
+double SharedEquipment::getTotalWeight() const
+{
+    return totalWeight.value();
+}
+
+const Armor* InlineEquipment::getArmor(unsigned int slotID) const
+{
+    return armorSlots[slotID] ? &*armorSlots[slotID] : nullptr;
+}
+
+const Weapon* InlineEquipment::getWeapon() const
+{
+    return weapon ? &*weapon : nullptr;
+}
+
+ItemPtr<const Armor> InlineEquipment::shareArmor(unsigned int slotID) const
+{
+    //the slot's object changes in place, so a reference that must outlive it needs its own copy
+    return armorSlots[slotID] ? makeItem<const Armor>(*armorSlots[slotID]) : nullptr;
+}
+
+ItemPtr<const Weapon> InlineEquipment::shareWeapon() const
+{
+    return weapon ? makeItem<const Weapon>(*weapon) : nullptr;
+}
+
+ItemPtr<Armor> InlineEquipment::equipArmor(ItemPtr<Armor> armor)
+{
+    const unsigned int slotID{ armor->getSlotID() };
+    ItemPtr<Armor> replaced{ unequipArmor(slotID) };
+
+    //the inventory's object can be moved from if nobody else still refers to it
+    if (armor.use_count() == 1)
+    {
+        armorSlots[slotID].emplace(move(*armor));
+    }
+    else
+    {
+        armorSlots[slotID].emplace(*armor);
+    }
+
+    totalArmorRating += armorSlots[slotID]->getRating();
+    armorMask |= 1u << slotID;
+    totalWeight.add(armorSlots[slotID]->getWeight());
+
+    return replaced;
+}
+
+ItemPtr<Armor> InlineEquipment::unequipArmor(unsigned int slotID)
+{
+    if (!armorSlots[slotID])
+    {
+        return nullptr;
+    }
+
+    //the inventory needs its own object again, allocated the same way as the clones Inventory::addItem makes
+    ItemPtr<Armor> removed{ moveShared(*armorSlots[slotID]) };
+    armorSlots[slotID].reset();
+
+    totalArmorRating -= removed->getRating();
+    armorMask &= ~(1u << slotID);
+    totalWeight.subtract(removed->getWeight());
+
+    return removed;
+}
+
+ItemPtr<Weapon> InlineEquipment::equipWeapon(ItemPtr<Weapon> weapon)
+{
+    ItemPtr<Weapon> replaced{ unequipWeapon() };
+
+    //the inventory's object can be moved from if nobody else still refers to it
+    if (weapon.use_count() == 1)
+    {
+        this->weapon.emplace(move(*weapon));
+    }
+    else
+    {
+        this->weapon.emplace(*weapon);
+    }
+
+    totalWeight.add(this->weapon->getWeight());
+
+    return replaced;
+}
+
+ItemPtr<Weapon> InlineEquipment::unequipWeapon()
+{
+    if (!weapon)
+    {
+        return nullptr;
+    }
+
+    //the inventory needs its own object again, allocated the same way as the clones Inventory::addItem makes
+    ItemPtr<Weapon> removed{ moveShared(*weapon) };
+    weapon.reset();
+
+    totalWeight.subtract(removed->getWeight());
+
+    return removed;
+}
+
+int InlineEquipment::getTotalArmorRating() const
+{
+    return totalArmorRating;
+}
+
+unsigned int InlineEquipment::getArmorMask() const
+{
+    return armorMask;
+}
+
+double InlineEquipment::getTotalWeight() const
+{
+    return totalWeight.value();
+}
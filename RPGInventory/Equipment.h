@@ -0,0 +1,130 @@
+#pragma once
+#include "Armor.h"
+#include "Weapon.h"
+#include "ItemPtr.h"
+#include "ExactSum.h"
+#include <array>
+#include <memory>
+#include <optional>
+
+// Equipped gear that shares the inventory's item objects.  Equipping and unequipping only moves a
+// pointer between the inventory and a slot, so a swap never copies or allocates an item.
+class SharedEquipment
+{
+public:
+    // Gets the armor piece equipped in a slot, or nullptr if the slot is empty.  slotID is not checked.
+    const Armor* getArmor(unsigned int slotID) const;
+
+    // Gets the equipped weapon, or nullptr if no weapon is equipped.
+    const Weapon* getWeapon() const;
+
+    // Gets a shared reference to the armor in a slot, which later changes to the slot don't affect.
+    ItemPtr<const Armor> shareArmor(unsigned int slotID) const;
+
+    // Gets a shared reference to the equipped weapon, which later changes to the weapon don't affect.
+    ItemPtr<const Weapon> shareWeapon() const;
+
+    // Equips the armor in its slot and returns the piece it replaced (a null pointer if the slot was empty).
+    ItemPtr<Armor> equipArmor(ItemPtr<Armor> armor);
+
+    // Empties a slot and returns the piece that was in it (a null pointer if the slot was empty).
+    ItemPtr<Armor> unequipArmor(unsigned int slotID);
+
+    // Equips the weapon and returns the weapon it replaced (a null pointer if none was equipped).
+    ItemPtr<Weapon> equipWeapon(ItemPtr<Weapon> weapon);
+
+    // Unequips the weapon and returns it (a null pointer if none was equipped).
+    ItemPtr<Weapon> unequipWeapon();
+
+    // Gets the sum of the ratings of the equipped armor.
+    int getTotalArmorRating() const;
+
+    // Gets a bitmask of the occupied armor slots: bit N is set if armor is equipped in slot N.
+    unsigned int getArmorMask() const;
+
+    // Gets the total weight of the equipped armor and weapon.
+    double getTotalWeight() const;
+
+private:
+    // Holds the armor currently equiped
+    std::array<ItemPtr<Armor>, Armor::SLOT_COUNT> armorSlots;
+
+    // Holds the weapon currently equiped
+    ItemPtr<Weapon> weapon;
+
+    // Sum of the ratings of the equipped armor
+    int totalArmorRating{ 0 };
+
+    // Bit N is set if armor is equipped in slot N
+    unsigned int armorMask{ 0 };
+
+    // Sum of the weights of the equipped armor and weapon, kept exactly
+    ExactSum totalWeight;
+};
+
+// Equipped gear stored by value inside the owning object, so finding an equipped item doesn't go
+// through a separate heap object; the names are still strings on the heap.  The totals come first so
+// they share the object's first bytes.  Pointers returned by getArmor() and getWeapon() stay valid
+// until that slot changes.  Equipping moves the item out of the inventory's object, and unequipping
+// has to allocate a new object for the inventory.  A slot holds exactly an Armor or a Weapon, so an
+// item of a class derived from either is stored as that class.
+class InlineEquipment
+{
+public:
+    // Gets the armor piece equipped in a slot, or nullptr if the slot is empty.  slotID is not checked.
+    const Armor* getArmor(unsigned int slotID) const;
+
+    // Gets the equipped weapon, or nullptr if no weapon is equipped.
+    const Weapon* getWeapon() const;
+
+    // Gets a copy of the armor in a slot, or a null pointer if the slot is empty.
+    ItemPtr<const Armor> shareArmor(unsigned int slotID) const;
+
+    // Gets a copy of the equipped weapon, or a null pointer if no weapon is equipped.
+    ItemPtr<const Weapon> shareWeapon() const;
+
+    // Equips the armor in its slot and returns the piece it replaced (a null pointer if the slot was empty).
+    ItemPtr<Armor> equipArmor(ItemPtr<Armor> armor);
+
+    // Empties a slot and returns the piece that was in it (a null pointer if the slot was empty).
+    ItemPtr<Armor> unequipArmor(unsigned int slotID);
+
+    // Equips the weapon and returns the weapon it replaced (a null pointer if none was equipped).
+    ItemPtr<Weapon> equipWeapon(ItemPtr<Weapon> weapon);
+
+    // Unequips the weapon and returns it (a null pointer if none was equipped).
+    ItemPtr<Weapon> unequipWeapon();
+
+    // Gets the sum of the ratings of the equipped armor.
+    int getTotalArmorRating() const;
+
+    // Gets a bitmask of the occupied armor slots: bit N is set if armor is equipped in slot N.
+    unsigned int getArmorMask() const;
+
+    // Gets the total weight of the equipped armor and weapon.
+    double getTotalWeight() const;
+
+private:
+    // Sum of the ratings of the equipped armor
+    int totalArmorRating{ 0 };
+
+    // Bit N is set if armor is equipped in slot N
+    unsigned int armorMask{ 0 };
+
+    // Sum of the weights of the equipped armor and weapon, kept exactly
+    ExactSum totalWeight;
+
+    // Holds the armor currently equiped
+    std::array<std::optional<Armor>, Armor::SLOT_COUNT> armorSlots;
+
+    // Holds the weapon currently equiped
+    std::optional<Weapon> weapon;
+};
+
+// The equipment layout used by Character.  Define RPG_INLINE_EQUIPMENT to store equipped gear
+// inline in Character instead of sharing the inventory's item objects.
+#ifdef RPG_INLINE_EQUIPMENT
+typedef InlineEquipment Equipment;
+#else
+typedef SharedEquipment Equipment;
+#endif
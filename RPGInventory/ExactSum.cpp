@@ -0,0 +1,168 @@
+#include "ExactSum.h"
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+using namespace std;
+
+void ExactSum::add(double value)
+{
+    accumulate(value, false);
+}
+
+void ExactSum::subtract(double value)
+{
+    accumulate(value, true);
+}
+
+void ExactSum::accumulate(double value, bool negate)
+{
+    //infinities and NaNs can't be held in the fixed-point part, so they're only counted
+    if (!isfinite(value))
+    {
+        const int64_t step{ negate ? -1 : 1 };
+        if (isnan(value))
+        {
+            nans += step;
+        }
+        else if (value > 0)
+        {
+            positiveInfinities += step;
+        }
+        else
+        {
+            negativeInfinities += step;
+        }
+        return;
+    }
+
+    //split the double into its integer significand and the bit it starts at, counting from 2^-1074
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    const bool negative{ (bits >> 63) != 0 };
+    const unsigned int exponent{ static_cast<unsigned int>((bits >> 52) & 0x7FF) };
+    uint64_t significand{ bits & ((uint64_t{ 1 } << 52) - 1) };
+    unsigned int shift{ 0 };
+    if (exponent != 0)
+    {
+        significand |= uint64_t{ 1 } << 52;
+        shift = exponent - 1;
+    }
+    if (significand == 0)
+    {
+        return;
+    }
+
+    //the significand covers at most two limbs; the carry or borrow runs on from there
+    const int limb{ static_cast<int>(shift / 64) };
+    const unsigned int offset{ shift % 64 };
+    const uint64_t parts[2]{ significand << offset, offset == 0 ? 0 : significand >> (64 - offset) };
+    if (negative == negate)
+    {
+        uint64_t carry{ 0 };
+        for (int i{ limb }; i < LIMB_COUNT; i++)
+        {
+            const uint64_t part{ i - limb < 2 ? parts[i - limb] : 0 };
+            if (part == 0 && carry == 0 && i - limb >= 2)
+            {
+                break;
+            }
+            const uint64_t sum{ limbs[i] + part };
+            const uint64_t carried{ sum + carry };
+            carry = (sum < part || carried < sum) ? 1 : 0;
+            limbs[i] = carried;
+        }
+    }
+    else
+    {
+        uint64_t borrow{ 0 };
+        for (int i{ limb }; i < LIMB_COUNT; i++)
+        {
+            const uint64_t part{ i - limb < 2 ? parts[i - limb] : 0 };
+            if (part == 0 && borrow == 0 && i - limb >= 2)
+            {
+                break;
+            }
+            const uint64_t difference{ limbs[i] - part };
+            const uint64_t borrowed{ difference - borrow };
+            borrow = (limbs[i] < part || difference < borrow) ? 1 : 0;
+            limbs[i] = borrowed;
+        }
+    }
+}
+
+double ExactSum::value() const
+{
+    if (nans != 0 || (positiveInfinities != 0 && negativeInfinities != 0))
+    {
+        return numeric_limits<double>::quiet_NaN();
+    }
+    if (positiveInfinities != 0)
+    {
+        return numeric_limits<double>::infinity();
+    }
+    if (negativeInfinities != 0)
+    {
+        return -numeric_limits<double>::infinity();
+    }
+
+    //work with the magnitude; the top bit of the top limb is the sign
+    array<uint64_t, LIMB_COUNT> magnitude{ limbs };
+    const bool negative{ (magnitude[LIMB_COUNT - 1] >> 63) != 0 };
+    if (negative)
+    {
+        uint64_t carry{ 1 };
+        for (uint64_t& limb : magnitude)
+        {
+            limb = ~limb + carry;
+            carry = (carry != 0 && limb == 0) ? 1 : 0;
+        }
+    }
+
+    int top{ LIMB_COUNT - 1 };
+    while (top >= 0 && magnitude[top] == 0)
+    {
+        top--;
+    }
+    if (top < 0)
+    {
+        return 0.0;
+    }
+
+    //take the 64 bits below the highest set bit, and fold every bit under those into the lowest one so
+    //the conversion to 53 bits still rounds to nearest; that bit is always below the rounding point
+    int highest{ 63 };
+    while ((magnitude[top] >> highest) == 0)
+    {
+        highest--;
+    }
+    const int position{ top * 64 + highest };
+    uint64_t leading;
+    bool sticky{ false };
+    int scale;
+    if (position < 64)
+    {
+        leading = magnitude[0];
+        scale = 0;
+    }
+    else
+    {
+        const int lowest{ position - 63 };
+        const int limb{ lowest / 64 };
+        const int offset{ lowest % 64 };
+        leading = offset == 0 ? magnitude[limb] : (magnitude[limb] >> offset) | (magnitude[limb + 1] << (64 - offset));
+        sticky = offset != 0 && (magnitude[limb] & ((uint64_t{ 1 } << offset) - 1)) != 0;
+        for (int i{ 0 }; i < limb && !sticky; i++)
+        {
+            sticky = magnitude[i] != 0;
+        }
+        scale = lowest;
+    }
+    if (sticky)
+    {
+        leading |= 1;
+    }
+
+    const double result{ ldexp(static_cast<double>(leading), scale - 1074) };
+    return negative ? -result : result;
+}
@@ -0,0 +1,38 @@
+#pragma once
+#include <array>
+#include <cstdint>
+
+// A running sum of doubles that is kept exactly, so adding and removing the same values in any order
+// always leaves the same total.  A plain double total picks up a rounding error with every += and -=,
+// which can leave it just over a limit that the true sum of the values is within.
+//
+// Finite values are held as one fixed-point integer in units of the smallest double, wide enough for
+// the sum of 2^64 of the largest ones.  Infinities and NaNs are counted separately.  value() rounds the
+// exact sum to the nearest double.
+class ExactSum
+{
+public:
+    // Adds a value to the sum.
+    void add(double value);
+
+    // Removes a value that was added before.
+    void subtract(double value);
+
+    // Gets the sum, rounded to the nearest double.
+    double value() const;
+
+private:
+    // Enough 64-bit limbs for every bit of a double (2^-1074 to 2^1024) plus 64 bits of headroom
+    const static int LIMB_COUNT = 34;
+
+    // The finite part of the sum, times 2^1074, in two's complement with the least significant limb first
+    std::array<std::uint64_t, LIMB_COUNT> limbs{};
+
+    // How many infinities and NaNs are in the sum
+    std::int64_t positiveInfinities{ 0 };
+    std::int64_t negativeInfinities{ 0 };
+    std::int64_t nans{ 0 };
+
+    // Adds or subtracts a value
+    void accumulate(double value, bool negate);
+};
@@ -0,0 +1,53 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+// A 64-bit FNV-1a hash built up one field at a time, for Item::getFingerprint() and ItemKey, which
+// have to add the same fields in the same order to get the same value.  The result is never 0, so 0
+// can stand for a fingerprint that hasn't been worked out yet.
+class Fingerprint
+{
+public:
+    // Adds raw bytes.
+    Fingerprint& add(const void* data, std::size_t size)
+    {
+        const unsigned char* bytes{ static_cast<const unsigned char*>(data) };
+        for (std::size_t i{ 0 }; i < size; i++)
+        {
+            value = (value ^ bytes[i]) * PRIME;
+        }
+        return *this;
+    }
+
+    // Adds the characters of a string, followed by its length so adjacent strings can't run together.
+    Fingerprint& add(std::string_view text)
+    {
+        add(text.data(), text.size());
+        return add(static_cast<std::uint64_t>(text.size()));
+    }
+
+    // Adds a weight.  0.0 and -0.0 are equal weights, so they add the same bytes.
+    Fingerprint& add(double weight)
+    {
+        const double normalized{ weight == 0.0 ? 0.0 : weight };
+        return add(&normalized, sizeof(normalized));
+    }
+
+    // Adds an integer field.
+    Fingerprint& add(int number) { return add(&number, sizeof(number)); }
+    Fingerprint& add(unsigned int number) { return add(&number, sizeof(number)); }
+    Fingerprint& add(std::uint64_t number) { return add(&number, sizeof(number)); }
+
+    // Gets the hash of everything added so far.
+    std::uint64_t get() const
+    {
+        return value != 0 ? value : 1;
+    }
+
+private:
+    static const std::uint64_t OFFSET = 14695981039346656037ull;
+    static const std::uint64_t PRIME = 1099511628211ull;
+
+    std::uint64_t value{ OFFSET };
+};
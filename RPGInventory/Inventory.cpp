@@ -1,13 +1,13 @@
 #include "Inventory.h"
 #include "Armor.h"
 #include "Weapon.h"
-#include <typeindex>
+#include "ItemKind.h"
 #include <memory>
-#include <set>
 #include <algorithm>
 #include <functional>
 #include <stdexcept>
 #include <string>
+#include <iterator>
 
 unsigned int Inventory::getSize() const
 {
@@ -18,10 +18,10 @@ unsigned int Inventory::getSize() const
 void Inventory::forEach(const std::function<void(const Item&)>& accept) const
 {
     // TODO: Implement this function.
-	for (auto element : inventory) 
+	for (const auto& element : inventory) 
 	{
-		//element.second is the item
-		accept(*(element.second)); 
+		//element is the item
+		accept(*element); 
 	}
 }
 
@@ -29,36 +29,120 @@ void Inventory::forEach(const std::function<void(const Item&)>& accept)
 {
     // TODO: Implement this function.
     // Can be basically the same as the first version of forEach with possibly some const differences.
-	for (auto element : inventory)
+	for (const auto& element : inventory)
 	{
-		//element.second is the item
-		accept(*(element.second)); 
+		//element is the item
+		accept(*element); 
 	}
 }
 
 void Inventory::addItem(const Item& item)
 {
-	//insert the pair of typeid and the item into the multiset
-	inventory.insert(std::pair<std::type_index, std::shared_ptr<Item>>{typeid(item), item.clone()}); 
+	//insert a clone of the item, copied as its concrete class without a virtual call; makeItem puts
+	//the object and its reference count in one allocation
+	insertElement(visitItem(item, [](const auto& concrete) { return ItemPtr<Item>{ cloneShared(concrete) }; }));
 }
 
-bool Inventory::dropItem(const Item& item)
+void Inventory::addItem(Item&& item)
 {
-	//iterate the inventory
-	for (auto element{ inventory.begin() }; element != inventory.end(); element++) 
+	//insert a new object of the same class that takes over the item's name
+	insertElement(visitItem(item, [](auto& concrete) { return ItemPtr<Item>{ moveShared(concrete) }; }));
+}
+
+void Inventory::addItem(ItemPtr<Item> item)
+{
+	//insert the item itself
+	insertElement(std::move(item));
+}
+
+void Inventory::addItems(std::vector<ItemPtr<Item>> items)
+{
+	//sort the new items like the inventory; the sort is stable so equal ratios keep the order they were given in
+	auto compareItems{ [](const ItemPtr<Item>& lhs, const ItemPtr<Item>& rhs)
+		{
+			return CompareValueToWeight::before(CompareValueToWeight::ratio(*lhs), CompareValueToWeight::ratio(*rhs));
+		} };
+	if (!std::is_sorted(items.begin(), items.end(), compareItems))
+	{
+		std::stable_sort(items.begin(), items.end(), compareItems);
+	}
+
+	//like addItem, each new item goes right before the first existing item with a smaller ratio.  
+	//Since the new items are sorted, that position only ever moves forward, so for a large batch it is
+	//cheaper to walk it forward than to search for it every time.
+	const bool walk{ items.size() * 16 >= inventory.size() };
+	auto position{ inventory.begin() };
+	for (auto& item : items)
 	{
-		//find the exact item
-		if (element->first.name() == typeid(item).name() && *(element->second) == item) 
+		const double ratio{ CompareValueToWeight::ratio(*item) };
+		if (walk)
 		{
-			//erase the element
-			inventory.erase(element); 
-			return true; //item found
+			while (position != inventory.end() && !CompareValueToWeight::before(ratio, CompareValueToWeight::ratio(**position)))
+			{
+				position++;
+			}
 		}
+		else
+		{
+			position = inventory.upper_bound(ratio);
+		}
+
+		insertElement(std::move(item), position);
+	}
+}
+
+void Inventory::clear()
+{
+	//erase from the back, so each erase is cheap and a transaction can still undo it
+	while (!inventory.empty())
+	{
+		eraseElement(std::prev(inventory.end()));
 	}
-	return false; //item not found
 }
 
-void Inventory::dropLastItem()
+bool Inventory::dropItem(const Item& item)
+{
+	//the removed item is destroyed once the returned pointer goes out of scope
+	return takeItem(item) != nullptr;
+}
+
+ItemPtr<Item> Inventory::takeItem(const Item& item)
+{
+	auto element{ findEqualElement(item) };
+	if (element == inventory.end())
+	{
+		return nullptr; //item not found
+	}
+	return eraseElement(element);
+}
+
+ItemPtr<Item> Inventory::takeItem(const ItemKey& key)
+{
+	auto element{ findKeyElement(key) };
+	if (element == inventory.end())
+	{
+		return nullptr; //item not found
+	}
+	return eraseElement(element);
+}
+
+bool Inventory::dropItem(const ItemKey& key)
+{
+	//the removed item is destroyed once the returned pointer goes out of scope
+	return takeItem(key) != nullptr;
+}
+
+ItemPtr<const Item> Inventory::findItem(const ItemKey& key) const
+{
+	auto element{ findKeyElement(key) };
+	if (element == inventory.end())
+	{
+		return nullptr;
+	}
+	return *element;
+}
+
+ItemPtr<Item> Inventory::dropLastItem()
 {
 	//throw an exception if the last item does not exist
 	if (inventory.size() == 0) 
@@ -70,69 +154,454 @@ void Inventory::dropLastItem()
 	auto lastItem{ inventory.rbegin() }; 
 
 	//delete the last element
-	inventory.erase(--lastItem.base()); 
+	return eraseElement(--lastItem.base()); 
 }
 
-std::shared_ptr<Weapon> Inventory::findBestWeapon()
+std::vector<ItemPtr<const Item>> Inventory::getInventoryPage(unsigned int offset, unsigned int limit) const
 {
-	//the best inventory weapon
-	std::shared_ptr<Weapon> bestWeapon; 
+	//jump straight to the first item of the page, then walk the rest of it
+	std::vector<ItemPtr<const Item>> page;
+	page.reserve(std::min<std::size_t>(limit, offset < inventory.size() ? inventory.size() - offset : 0));
+	for (auto element{ inventory.select(offset) }; element != inventory.end() && page.size() < limit; element++)
+	{
+		page.push_back(*element);
+	}
+	return page;
+}
 
-	//iterate the inventory
-	for (auto element : inventory) 
+unsigned int Inventory::rankOf(const Item& item) const
+{
+	//throw an exception if the item is not in the inventory
+	auto element{ findEqualElement(item) };
+	if (element == inventory.end())
 	{
-		//test to see if the item is a weapon
-		if (element.first == typeid(Weapon)) 
+		throw std::logic_error("item not found in inventory");
+	}
+	return static_cast<unsigned int>(inventory.rank(element));
+}
+
+ItemView<customMultiset::const_iterator> Inventory::getItemsByRatio(double minimum, double maximum) const
+{
+	//the inventory is in descending ratio order, so the range starts at the maximum
+	if (!(minimum <= maximum))
+	{
+		return { inventory.end(), inventory.end() };
+	}
+	return { inventory.lower_bound(maximum), inventory.upper_bound(minimum) };
+}
+
+ItemView<weightIndex::const_iterator> Inventory::getItemsByWeight(double minimum, double maximum) const
+{
+	buildIndexes();
+	if (!(minimum <= maximum))
+	{
+		return { itemsByWeight.end(), itemsByWeight.end() };
+	}
+	return { itemsByWeight.lower_bound(minimum), itemsByWeight.upper_bound(maximum) };
+}
+
+ItemView<goldValueIndex::const_iterator> Inventory::getItemsByGoldValue(unsigned int minimum, unsigned int maximum) const
+{
+	buildIndexes();
+	if (minimum > maximum)
+	{
+		return { itemsByGoldValue.end(), itemsByGoldValue.end() };
+	}
+	return { itemsByGoldValue.lower_bound(minimum), itemsByGoldValue.upper_bound(maximum) };
+}
+
+std::vector<ItemPtr<const Item>> Inventory::query(const ItemQuery& query) const
+{
+	if (!bitmapIndexed)
+	{
+		for (const auto& element : inventory)
+		{
+			bitmapIndex.add(*element);
+		}
+		bitmapIndexed = true;
+	}
+
+	//the bitmaps narrow the inventory down to candidates, which are then checked exactly
+	std::vector<const Item*> candidates;
+	bitmapIndex.findCandidates(query, candidates);
+	std::vector<ItemPtr<const Item>> matches;
+	if (candidates.size() > inventory.size() / 8)
+	{
+		//with this many candidates, walking the inventory in order is cheaper than sorting them
+		for (const auto& element : inventory)
+		{
+			if (query.matches(*element))
+			{
+				matches.push_back(element);
+			}
+		}
+		return matches;
+	}
+
+	//put the matches in inventory order by their positions in the multiset
+	std::vector<std::pair<std::size_t, customMultiset::const_iterator>> ranked;
+	for (const Item* candidate : candidates)
+	{
+		if (query.matches(*candidate))
+		{
+			const auto element{ findElement(candidate) };
+			ranked.emplace_back(inventory.rank(element), element);
+		}
+	}
+	std::sort(ranked.begin(), ranked.end(), [](const auto& lhs, const auto& rhs) { return lhs.first < rhs.first; });
+	matches.reserve(ranked.size());
+	for (const auto& match : ranked)
+	{
+		matches.push_back(*match.second);
+	}
+	return matches;
+}
+
+std::vector<ItemPtr<const Item>> Inventory::searchByName(std::string_view text, NameSearch mode) const
+{
+	if (!nameIndexed)
+	{
+		std::vector<ItemPtr<Item>> items;
+		items.reserve(inventory.size());
+		for (const auto& element : inventory)
+		{
+			items.push_back(element);
+		}
+		nameIndex.add(items);
+		nameIndexed = true;
+	}
+
+	std::vector<ItemPtr<const Item>> results;
+	nameIndex.search(text, mode, results);
+	return results;
+}
+
+double Inventory::getTotalWeight() const
+{
+	return totalWeight.value();
+}
+
+void Inventory::shareItems(std::vector<ItemPtr<const Item>>& items) const
+{
+	//only the pointers are copied
+	items.reserve(items.size() + inventory.size());
+	for (const auto& element : inventory)
+	{
+		items.push_back(element);
+	}
+}
+
+void Inventory::beginTransaction()
+{
+	//throw an exception if a transaction is already being recorded
+	if (recordingTransaction)
+	{
+		throw std::logic_error("a transaction is already in progress");
+	}
+
+	recordingTransaction = true;
+	weightBeforeTransaction = totalWeight;
+}
+
+void Inventory::commitTransaction()
+{
+	//the recorded changes are kept, so the undo log can be thrown away
+	undoLog.clear();
+	recordingTransaction = false;
+}
+
+void Inventory::rollbackTransaction()
+{
+	//stop recording so the undo steps below aren't recorded themselves
+	recordingTransaction = false;
+
+	//undo the changes from newest to oldest, so every element is put back next to the same neighbour it was taken from
+	for (auto record{ undoLog.rbegin() }; record != undoLog.rend(); record++)
+	{
+		if (record->wasInserted)
 		{
-			//convert the item shared_ptr to a weapon shared_ptr
-			std::shared_ptr<Weapon> tempWeapon{ std::dynamic_pointer_cast<Weapon>(element.second) }; 
+			eraseElement(findElement(record->item.get()));
+		}
+		else
+		{
+			//insert right before the element that used to follow it, which keeps the order among equal ratios
+			auto hint{ record->successor ? findElement(record->successor) : inventory.end() };
+			indexItem(inventory.emplace_hint(hint, record->item));
+		}
+	}
 
-			//if bestWeapon has not been assigned, assign tempWeapon to bestWeapon
-			if (!bestWeapon) 
+	undoLog.clear();
+
+	//the re-inserts above don't go through insertElement, so put back the total from before
+	totalWeight = weightBeforeTransaction;
+}
+
+customMultiset::iterator Inventory::insertElement(ItemPtr<Item> item)
+{
+	//keep the running weight up to date
+	totalWeight.add(item->getWeight());
+
+	//remember the insertion so a rollback can take it out again
+	if (recordingTransaction)
+	{
+		undoLog.push_back(UndoRecord{ true, item, nullptr });
+	}
+
+	//insert the item into the multiset
+	auto element{ inventory.insert(std::move(item)) };
+	indexItem(element);
+	return element;
+}
+
+customMultiset::iterator Inventory::insertElement(ItemPtr<Item> item, customMultiset::const_iterator hint)
+{
+	//keep the running weight up to date
+	totalWeight.add(item->getWeight());
+
+	//remember the insertion so a rollback can take it out again
+	if (recordingTransaction)
+	{
+		undoLog.push_back(UndoRecord{ true, item, nullptr });
+	}
+
+	//insert the item into the multiset
+	auto element{ inventory.emplace_hint(hint, std::move(item)) };
+	indexItem(element);
+	return element;
+}
+
+ItemPtr<Item> Inventory::eraseElement(customMultiset::iterator element)
+{
+	//keep the item alive for the caller
+	ItemPtr<Item> erased{ *element };
+
+	//remember the element and its successor so a rollback can put it back in the same place
+	if (recordingTransaction)
+	{
+		auto successor{ std::next(element) };
+		undoLog.push_back(UndoRecord{ false, erased, successor == inventory.end() ? nullptr : successor->get() });
+	}
+
+	//erase the element and remove its weight from the running total
+	unindexItem(element);
+	inventory.erase(element);
+	totalWeight.subtract(erased->getWeight());
+
+	return erased;
+}
+
+void Inventory::buildIndexes() const
+{
+	if (indexed)
+	{
+		return;
+	}
+
+	//sort the keys first; a set built from a sorted range is built in linear time
+	std::vector<weightIndex::value_type> weights;
+	std::vector<goldValueIndex::value_type> goldValues;
+	weights.reserve(inventory.size());
+	goldValues.reserve(inventory.size());
+	for (const auto& element : inventory)
+	{
+		weights.emplace_back(element->getWeight(), element.get());
+		goldValues.emplace_back(element->getGoldValue(), element.get());
+	}
+	std::sort(weights.begin(), weights.end(), itemsByWeight.value_comp());
+	std::sort(goldValues.begin(), goldValues.end(), itemsByGoldValue.value_comp());
+	itemsByWeight.insert(weights.begin(), weights.end());
+	itemsByGoldValue.insert(goldValues.begin(), goldValues.end());
+	indexed = true;
+}
+
+void Inventory::indexItem(customMultiset::const_iterator element)
+{
+	const ItemPtr<Item>& item{ *element };
+	if (indexed)
+	{
+		itemsByWeight.emplace(item->getWeight(), item.get());
+		itemsByGoldValue.emplace(item->getGoldValue(), item.get());
+	}
+	if (bitmapIndexed)
+	{
+		bitmapIndex.add(*item);
+	}
+	if (nameIndexed)
+	{
+		nameIndex.add(item);
+	}
+	if (keyIndex.built)
+	{
+		keyIndex.elements.emplace(static_cast<std::size_t>(item->getFingerprint()), element);
+	}
+}
+
+void Inventory::unindexItem(customMultiset::const_iterator element)
+{
+	const ItemPtr<Item>& item{ *element };
+	//items aren't changed while they are in the inventory, so their keys are the ones they were indexed with
+	if (indexed)
+	{
+		itemsByWeight.erase(std::make_pair(item->getWeight(), static_cast<const Item*>(item.get())));
+		itemsByGoldValue.erase(std::make_pair(item->getGoldValue(), static_cast<const Item*>(item.get())));
+	}
+	if (bitmapIndexed)
+	{
+		bitmapIndex.remove(*item);
+	}
+	if (nameIndexed)
+	{
+		nameIndex.remove(item);
+	}
+	if (keyIndex.built)
+	{
+		auto range{ keyIndex.elements.equal_range(static_cast<std::size_t>(item->getFingerprint())) };
+		for (auto entry{ range.first }; entry != range.second; entry++)
+		{
+			if (entry->second == element)
+			{
+				keyIndex.elements.erase(entry);
+				break;
+			}
+		}
+	}
+}
+
+customMultiset::const_iterator Inventory::findEqualElement(const Item& item) const
+{
+	//an equal item has the same ratio, so only that range needs to be searched
+	auto matches{ [&item](const customMultiset::value_type& element)
+		{
+			return *element == item;
+		} };
+	auto range{ inventory.equal_range(CompareValueToWeight::ratio(item)) };
+	auto element{ std::find_if(range.first, range.second, matches) };
+	if (element == range.second)
+	{
+		//a weightless item's ratio is infinite, and an equal item weighing -0.0 has the opposite sign, so
+		//those are the only items that need a full search
+		if (item.getWeight() != 0.0)
+		{
+			return inventory.end();
+		}
+		element = std::find_if(inventory.begin(), inventory.end(), matches);
+	}
+	return element;
+}
+
+customMultiset::const_iterator Inventory::findKeyElement(const ItemKey& key) const
+{
+	if (!keyIndex.built)
+	{
+		keyIndex.elements.reserve(inventory.size());
+		for (auto element{ inventory.begin() }; element != inventory.end(); element++)
+		{
+			keyIndex.elements.emplace(static_cast<std::size_t>((*element)->getFingerprint()), element);
+		}
+		keyIndex.built = true;
+	}
+
+	//equal items are interchangeable, but the first one in inventory order is the one every other lookup finds
+	auto found{ inventory.end() };
+	std::size_t foundRank{ 0 };
+	auto range{ keyIndex.elements.equal_range(key.getHash()) };
+	for (auto entry{ range.first }; entry != range.second; entry++)
+	{
+		if (key.matches(**entry->second))
+		{
+			if (found == inventory.end())
 			{
-				bestWeapon = tempWeapon;
+				found = entry->second;
 			}
 			else
 			{
-				//if tempWeapon has more damage than bestWeapon, assign tempWeapon to bestWeapon
-				if (tempWeapon->getDamage() > bestWeapon->getDamage()) 
+				//only ranked once there is a second match, which is rare
+				if (foundRank == 0)
+				{
+					foundRank = inventory.rank(found);
+				}
+				const std::size_t rank{ inventory.rank(entry->second) };
+				if (rank < foundRank)
 				{
-					bestWeapon = tempWeapon;
+					found = entry->second;
+					foundRank = rank;
 				}
 			}
 		}
 	}
-	return bestWeapon;
+	return found;
 }
 
-std::array<std::shared_ptr<Armor>, 6> Inventory::findBestArmor()
+customMultiset::iterator Inventory::findElement(const Item* item) const
 {
-	//the best inventory armor pieces, each element in the array corresponds to the correct slotID of the best inventory armor pieces
-	std::array<std::shared_ptr<Armor>, 6> bestArmor; 
+	//only the elements with the same ratio need to be searched; that includes a ratio that isn't a number,
+	//which the ordering keeps at the end
+	auto range{ inventory.equal_range(CompareValueToWeight::ratio(*item)) };
+	for (auto element{ range.first }; element != range.second; element++)
+	{
+		if (element->get() == item)
+		{
+			return element;
+		}
+	}
+	return inventory.end();
+}
+
+ItemPtr<Weapon> Inventory::findBestWeapon()
+{
+	//the element holding the best inventory weapon; the handle is only copied once the scan is done
+	const ItemPtr<Item>* bestWeapon{ nullptr };
 
 	//iterate the inventory
-	for (auto element : inventory) 
+	for (const auto& element : inventory) 
 	{
-		//test to see if the item is an armor piece
-		if (element.first == typeid(Armor)) 
+		//test to see if the item is a weapon
+		if (element->getKind() == ItemKind::Weapon) 
 		{
-			//convert the item shared_ptr to an armor shared_ptr
-			std::shared_ptr<Armor> tempArmorPiece{ std::dynamic_pointer_cast<Armor>(element.second) }; 
+			//the kind says the item is a weapon
+			const Weapon& tempWeapon{ static_cast<const Weapon&>(*element) };
 
-			//if bestArmor at slotID has not been assigned, assign tempArmor to bestArmor at slotID
-			if (!bestArmor[tempArmorPiece->getSlotID()]) 
+			//if bestWeapon has not been assigned, or tempWeapon has more damage than bestWeapon, assign tempWeapon to bestWeapon
+			if (!bestWeapon || tempWeapon.getDamage() > static_cast<const Weapon&>(**bestWeapon).getDamage())
 			{
-				bestArmor[tempArmorPiece->getSlotID()] = tempArmorPiece;
+				bestWeapon = &element;
 			}
-			else
+		}
+	}
+	return bestWeapon ? staticItemCast<Weapon>(*bestWeapon) : nullptr;
+}
+
+std::array<ItemPtr<Armor>, 6> Inventory::findBestArmor()
+{
+	//the elements holding the best inventory armor pieces, each element in the array corresponds to the correct slotID of the best inventory armor pieces
+	std::array<const ItemPtr<Item>*, 6> bestElements{};
+
+	//iterate the inventory
+	for (const auto& element : inventory) 
+	{
+		//test to see if the item is an armor piece
+		if (element->getKind() == ItemKind::Armor) 
+		{
+			//the kind says the item is an armor piece
+			const Armor& tempArmorPiece{ static_cast<const Armor&>(*element) };
+			const ItemPtr<Item>*& best{ bestElements[tempArmorPiece.getSlotID()] };
+
+			//if bestArmor at slotID has not been assigned, or tempArmor has more rating than it, assign tempArmor to bestArmor at slotID
+			if (!best || tempArmorPiece.getRating() > static_cast<const Armor&>(**best).getRating())
 			{
-				//if tempArmor has more rating than bestArmor at slotID, assign tempArmor to bestArmor at slotID
-				if (tempArmorPiece->getRating() > bestArmor[tempArmorPiece->getSlotID()]->getRating())  
-				{
-					bestArmor[tempArmorPiece->getSlotID()] = tempArmorPiece;
-				}
+				best = &element;
 			}
 		}
 	}
+
+	//copy the handles of the winners only
+	std::array<ItemPtr<Armor>, 6> bestArmor;
+	for (std::size_t slotID{ 0 }; slotID < bestArmor.size(); slotID++)
+	{
+		if (bestElements[slotID])
+		{
+			bestArmor[slotID] = staticItemCast<Armor>(*bestElements[slotID]);
+		}
+	}
 	return bestArmor;
 }
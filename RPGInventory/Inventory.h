@@ -1,16 +1,38 @@
 #pragma once
 #include "Collection.h"
 #include "Item.h"
+#include "ItemPtr.h"
 #include "Armor.h"
 #include "Weapon.h"
-#include <typeindex>
 #include <memory>
-#include <set>
 #include <array>
+#include <vector>
+#include <set>
+#include <unordered_map>
 #include "CompareValueToWeight.h"
+#include "CompareIndexKey.h"
+#include "OrderStatisticTree.h"
+#include "ItemView.h"
+#include "ItemQuery.h"
+#include "BitmapIndex.h"
+#include "NameIndex.h"
+#include "ItemKey.h"
+#include "ExactSum.h"
+
+//multiset that is ordered in value to weight ratio, and can find the item at any position in O(log n)
+typedef OrderStatisticTree<ItemPtr<Item>, CompareValueToWeight> customMultiset;
 
-//multiset that is ordered in value to weight ratio
-typedef std::multiset<std::pair<std::type_index, std::shared_ptr<Item>>, CompareValueToWeight> customMultiset;
+//secondary indexes of the inventory's items, ordered by weight and by gold value
+typedef std::set<std::pair<double, const Item*>, CompareIndexKey<double>> weightIndex;
+typedef std::set<std::pair<unsigned int, const Item*>, CompareIndexKey<unsigned int>> goldValueIndex;
+
+//hashes a hash that was already worked out, such as ItemKey::getHash(), by returning it as it is
+struct PrecomputedHash
+{
+    std::size_t operator()(std::size_t hash) const {
+        return hash;
+    }
+};
 
 // An implementation of Collection for providing readonly access to the items in a character's inventory.
 class Inventory : public Collection<const Item>
@@ -32,27 +54,189 @@ public:
     // the pattern for a new item that should be created and added to the inventory.
     void addItem(const Item& item);
 
+    // Adds an item that the caller no longer needs, moving it into the inventory instead of copying it.
+    void addItem(Item&& item);
+
+    // Adds the specified item object itself to the inventory; no copy is made.  A unique_ptr can be
+    // passed here too.
+    void addItem(ItemPtr<Item> item);
+
+    // Adds many item objects at once; no copies are made.  The result is the same as adding them one
+    // at a time in the order given, but a large batch is merged into the inventory in linear time.
+    void addItems(std::vector<ItemPtr<Item>> items);
+
+    // Removes every item from the inventory.
+    void clear();
+
     // Searches for and removes the specified item from the inventory.  
     // returns true if an item was dropped and false if no item was dropped.
     bool dropItem(const Item& item);
 
-    // Removes the last element in the inventory.
+    // Searches for and removes the specified item from the inventory without destroying it.  Only items
+    // with the same value to weight ratio are compared, so the search takes O(log n) plus their number.
+    // returns the removed item, or a null pointer if no item was found.
+    ItemPtr<Item> takeItem(const Item& item);
+
+    // Searches for and removes the first item, in inventory order, that the key describes, without destroying it.
+    // returns the removed item, or a null pointer if no item was found.
+    ItemPtr<Item> takeItem(const ItemKey& key);
+
+    // Searches for and removes the first item, in inventory order, that the key describes.
+    // returns true if an item was dropped and false if no item was dropped.
+    bool dropItem(const ItemKey& key);
+
+    // Gets the first item, in inventory order, that the key describes, or a null pointer if there is none.
+    // Items are looked up by the key's hash, so nothing is allocated.  The hash index is built by the first
+    // lookup by key, with the same caveat for sharing a const inventory between threads as getItemsByWeight().
+    ItemPtr<const Item> findItem(const ItemKey& key) const;
+
+    // Removes the last element in the inventory and returns it.
     // A logic_error is thrown if no items exist in the inventory.
-    void dropLastItem();
+    ItemPtr<Item> dropLastItem();
+
+    // Gets up to limit items, starting with the one at offset, in inventory order (the order forEach
+    // visits them in).  Finding the first item of the page takes O(log n), however far in it is.
+    std::vector<ItemPtr<const Item>> getInventoryPage(unsigned int offset, unsigned int limit) const;
+
+    // Gets the position in inventory order of the first item equal to the specified one, counting
+    // from 0 for the best value to weight ratio; the item at getSize() - 1 is the next one dropLastItem()
+    // removes.  A logic_error is thrown if no such item is in the inventory.
+    unsigned int rankOf(const Item& item) const;
+
+    // Gets the items whose value to weight ratio is between minimum and maximum, inclusive, in inventory
+    // order.  The range is found in O(log n) from the inventory's own order.
+    ItemView<customMultiset::const_iterator> getItemsByRatio(double minimum, double maximum) const;
+
+    // Gets the items whose weight is between minimum and maximum, inclusive, lightest first.
+    // Items of equal weight come in no particular order.  The weight and gold value indexes are built by
+    // the first query that uses either one, so a const inventory shared between threads needs a query
+    // made up front.
+    ItemView<weightIndex::const_iterator> getItemsByWeight(double minimum, double maximum) const;
+
+    // Gets the items whose gold value is between minimum and maximum, inclusive, cheapest first.
+    // Items of equal value come in no particular order.
+    ItemView<goldValueIndex::const_iterator> getItemsByGoldValue(unsigned int minimum, unsigned int maximum) const;
+
+    // Gets every item that matches the query, in inventory order.  The bitmap index the query runs on
+    // is built by the first call, with the same caveat for sharing a const inventory between threads as
+    // getItemsByWeight().
+    std::vector<ItemPtr<const Item>> query(const ItemQuery& query) const;
+
+    // Gets every item whose name matches the text, in case-folded name order.  The name index is built by
+    // the first search, with the same caveat for sharing a const inventory between threads as
+    // getItemsByWeight().
+    std::vector<ItemPtr<const Item>> searchByName(std::string_view text, NameSearch mode) const;
+
+    // Gets the total weight of the items in the inventory, kept up to date on every add and drop.
+    double getTotalWeight() const;
+
+    // Appends a shared reference to every item, in inventory order.  Items are never changed while
+    // they are in the inventory, so the references are a point-in-time view that later adds and drops
+    // don't affect, and they can be read from another thread.
+    void shareItems(std::vector<ItemPtr<const Item>>& items) const;
+
+    // Starts recording every change to the inventory so that it can be undone by rollbackTransaction().
+    // A logic_error is thrown if a transaction is already in progress.
+    void beginTransaction();
+
+    // Keeps every change made since beginTransaction() and stops recording.
+    void commitTransaction();
+
+    // Undoes every change made since beginTransaction(), restoring the exact previous order, and stops recording.
+    void rollbackTransaction();
 
     // Searches for the best weapon in the inventory.
-    // returns a null shared_ptr if no weapon is found
-    std::shared_ptr<Weapon> findBestWeapon();
+    // returns a null pointer if no weapon is found
+    ItemPtr<Weapon> findBestWeapon();
 
     // Searches for the best armor in the inventory.
-    // returns a null shared_ptr at the corresponding slotID if no armor is found
-    std::array<std::shared_ptr<Armor>, 6> findBestArmor();
+    // returns a null pointer at the corresponding slotID if no armor is found
+    std::array<ItemPtr<Armor>, 6> findBestArmor();
 
 private:
     // TODO: Add private variables and subroutines here.
     // Type functor for the inventory multiset to be ordered in descending value to weight ratio
     CompareValueToWeight compare;
 
-    // Multiset of pairs to hold the typeid of the item and a shared_ptr of the item
+    // Multiset of pointers to the items; each item carries its own kind, so nothing else is stored
     customMultiset inventory{ compare };
+
+    // Running sum of the weight of every item in the multiset, kept exactly so it never drifts from the
+    // true sum however the items came and went
+    ExactSum totalWeight;
+
+    // The weight and gold value indexes aren't built until the first query that needs them; from then
+    // on every insert and erase keeps them up to date
+    mutable bool indexed{ false };
+    mutable weightIndex itemsByWeight;
+    mutable goldValueIndex itemsByGoldValue;
+
+    // Builds the weight and gold value indexes if they haven't been built yet
+    void buildIndexes() const;
+
+    // Like the indexes above, the bitmap index isn't built until the first query()
+    mutable bool bitmapIndexed{ false };
+    mutable BitmapIndex bitmapIndex;
+
+    // And the name index isn't built until the first searchByName()
+    mutable bool nameIndexed{ false };
+    mutable NameIndex nameIndex;
+
+    // The elements, by the key hash of their items.  It isn't built until the first lookup by
+    // key, and since it refers to the elements themselves, a copied or moved inventory starts without it.
+    struct KeyIndex
+    {
+        bool built{ false };
+        std::unordered_multimap<std::size_t, customMultiset::const_iterator, PrecomputedHash> elements;
+
+        KeyIndex() = default;
+        KeyIndex(const KeyIndex&) {}
+        KeyIndex& operator=(const KeyIndex&) { built = false; elements.clear(); return *this; }
+    };
+    mutable KeyIndex keyIndex;
+
+    // Finds the first element in inventory order whose item is equal to the specified one, or end() if there is none
+    customMultiset::const_iterator findEqualElement(const Item& item) const;
+
+    // Builds the key index if it hasn't been built yet, then finds the first element in inventory order
+    // whose item the key describes, or end() if there is none
+    customMultiset::const_iterator findKeyElement(const ItemKey& key) const;
+
+    // One change recorded during a transaction
+    struct UndoRecord
+    {
+        // True if the item was inserted, false if it was erased
+        bool wasInserted;
+
+        // The item that was inserted or erased
+        ItemPtr<Item> item;
+
+        // For an erased item, the item that followed it (nullptr if it was the last one)
+        const Item* successor;
+    };
+
+    // True while a transaction is being recorded
+    bool recordingTransaction{ false };
+
+    // The changes made since beginTransaction(), oldest first
+    std::vector<UndoRecord> undoLog;
+
+    // The running weight when the transaction began
+    ExactSum weightBeforeTransaction;
+
+    // Inserts an item, keeping the running weight and the undo log up to date
+    customMultiset::iterator insertElement(ItemPtr<Item> item);
+
+    // Inserts an item right before hint, which must be the correct position for it
+    customMultiset::iterator insertElement(ItemPtr<Item> item, customMultiset::const_iterator hint);
+
+    // Adds an element's item to, or removes it from, the secondary indexes if they have been built
+    void indexItem(customMultiset::const_iterator element);
+    void unindexItem(customMultiset::const_iterator element);
+
+    // Erases an element and returns its item, keeping the running weight and the undo log up to date
+    ItemPtr<Item> eraseElement(customMultiset::iterator element);
+
+    // Finds the element holding exactly this item object, or end() if there is none
+    customMultiset::iterator findElement(const Item* item) const;
 };
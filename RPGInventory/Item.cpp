@@ -1,4 +1,58 @@
 #include "Item.h"
+#include "TextFormat.h"
+#include <utility>
+
+Item::Item(ItemKind kind) : kind { kind }
+{
+}
+
+Item::Item(const Item& other)
+    : name { other.name }, goldValue { other.goldValue }, weight { other.weight },
+    fingerprint { typeid(other) == typeid(Item) ? other.fingerprint.load(std::memory_order_relaxed) : 0 }
+{
+    // A subclass's fingerprint may cover fields a sliced copy doesn't have, so it is only kept when
+    // the source is exactly an Item too.
+}
+
+Item& Item::operator=(const Item& other)
+{
+    // The kind belongs to the object's class, so it is never assigned.
+    assignFrom(other, typeid(Item));
+    return *this;
+}
+
+Item::Item(Item&& other) noexcept
+    : name { std::move(other.name) }, goldValue { other.goldValue }, weight { other.weight },
+    fingerprint { typeid(other) == typeid(Item) ? other.fingerprint.load(std::memory_order_relaxed) : 0 }
+{
+    other.invalidateFingerprint();
+}
+
+Item& Item::operator=(Item&& other) noexcept
+{
+    // The kind belongs to the object's class, so it is never assigned.
+    assignFrom(std::move(other), typeid(Item));
+    return *this;
+}
+
+void Item::assignFrom(const Item& other, const std::type_info& assigned)
+{
+    const bool whole { typeid(*this) == assigned && typeid(other) == assigned };
+    name = other.name;
+    goldValue = other.goldValue;
+    weight = other.weight;
+    fingerprint.store(whole ? other.fingerprint.load(std::memory_order_relaxed) : 0, std::memory_order_relaxed);
+}
+
+void Item::assignFrom(Item&& other, const std::type_info& assigned) noexcept
+{
+    const bool whole { typeid(*this) == assigned && typeid(other) == assigned };
+    name = std::move(other.name);
+    goldValue = other.goldValue;
+    weight = other.weight;
+    fingerprint.store(whole ? other.fingerprint.load(std::memory_order_relaxed) : 0, std::memory_order_relaxed);
+    other.invalidateFingerprint();
+}
 
 Item::~Item()
 {
@@ -11,13 +65,37 @@ Item* Item::clone() const
 
 bool Item::operator==(const Item& other) const
 {
-    return typeid(*this) == typeid(other)
-        && this->getGoldValue() == other.getGoldValue()
-        && this->getName() == other.getName()
-        && this->getWeight() == other.getWeight();
+    // Different fingerprints rule out equality with one compare; equal ones still need every field
+    // checked.  The kind tells Item, Weapon and Armor apart cheaply, but a caller's own class of item
+    // has the kind of the class it derives from, so the exact classes are compared last.
+    return this->getFingerprint() == other.getFingerprint()
+        && this->kind == other.kind
+        && this->goldValue == other.goldValue
+        && this->weight == other.weight
+        && this->name == other.name
+        && typeid(*this) == typeid(other);
+}
+
+std::uint64_t Item::getFingerprint() const
+{
+    // Threads that race to fill in the cache all store the same value, so relaxed ordering is enough.
+    std::uint64_t cached { fingerprint.load(std::memory_order_relaxed) };
+    if (cached == 0)
+    {
+        Fingerprint computed;
+        addToFingerprint(computed);
+        cached = computed.get();
+        fingerprint.store(cached, std::memory_order_relaxed);
+    }
+    return cached;
+}
+
+ItemKind Item::getKind() const
+{
+    return kind;
 }
 
-std::string Item::getName() const
+const std::string& Item::getName() const
 {
     return name;
 }
@@ -34,17 +112,30 @@ double Item::getWeight() const
 
 void Item::setName(std::string name)
 {
-    this->name = name;
+    this->name = std::move(name);
+    invalidateFingerprint();
 }
 
 void Item::setGoldValue(unsigned int goldValue)
 {
     this->goldValue = goldValue;
+    invalidateFingerprint();
 }
 
 void Item::setWeight(double weight)
 {
     this->weight = weight;
+    invalidateFingerprint();
+}
+
+void Item::addToFingerprint(Fingerprint& hash) const
+{
+    hash.add(name).add(goldValue).add(weight);
+}
+
+void Item::invalidateFingerprint()
+{
+    fingerprint.store(0, std::memory_order_relaxed);
 }
 
 void Item::printToStream(std::ostream& out) const
@@ -52,6 +143,15 @@ void Item::printToStream(std::ostream& out) const
     out << name << ", " << goldValue << " GP, " << weight << " lbs.";
 }
 
+void Item::appendTo(std::string& out) const
+{
+    out.append(name).append(", ");
+    appendNumber(out, goldValue);
+    out.append(" GP, ");
+    appendNumber(out, weight);
+    out.append(" lbs.");
+}
+
 std::ostream& operator<<(std::ostream& out, const Item& item)
 {
     item.printToStream(out);
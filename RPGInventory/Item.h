@@ -1,12 +1,37 @@
 #pragma once
 #include <string>
 #include <ostream>
+#include <atomic>
+#include <cstdint>
+#include <typeinfo>
+#include "Fingerprint.h"
+
+// The kinds of item, for code that stores or transmits items outside of the class hierarchy.
+enum class ItemKind : unsigned char
+{
+    Item = 0,
+    Weapon = 1,
+    Armor = 2
+};
+
+template <typename ItemType>
+class IntrusiveItemPtr;
 
 // A class for storing an item.  Items may be generic and serve no equipabble function.
 // There are also special, equippable subclasses of Item such as Weapon and Armor.
 class Item
 {
 public:
+    Item() = default;
+
+    // Copies an item.  The copy is always a plain Item, so copying a Weapon or Armor into an Item slices
+    // it down to an item of kind Item.
+    Item(const Item& other);
+    Item& operator= (const Item& other);
+
+    // Moves an item, taking over its name rather than copying it.
+    Item(Item&& other) noexcept;
+    Item& operator= (Item&& other) noexcept;
     virtual ~Item();
 
     // Creates a new pointer to a copy of the item.
@@ -17,8 +42,18 @@ public:
     // May be overridden by subclasses to add additional equivalance conditions.
     virtual bool operator== (const Item& other) const;
 
+    // Gets a 64-bit hash of every field that operator== compares, so items with different fingerprints
+    // are never equal.  It is worked out on first use after a change and then kept; since the cache is
+    // atomic, an item that isn't being changed can be read from several threads at once.
+    std::uint64_t getFingerprint() const;
+
+    // Gets the kind of the item, which is fixed when it is created: Weapon or Armor for those classes
+    // and any class derived from them, and Item for everything else.  The kind only says which of the
+    // three classes the item is or derives from; a class derived from one of them has its kind too.
+    ItemKind getKind() const;
+
     // Gets the name of the item.
-    std::string getName() const;
+    const std::string& getName() const;
 
     // Gets the number of gold coins that the item is worth.
     unsigned int getGoldValue() const;
@@ -26,7 +61,8 @@ public:
     // Gets how much the item weighs, in pounds.
     double getWeight() const;
 
-    // Sets the name of the item.
+    // Sets the name of the item.  Pass a name that is no longer needed with std::move to keep its
+    // storage instead of copying it.
     void setName(std::string name);
 
     // Sets the number of gold coins that the item is worth.
@@ -35,14 +71,45 @@ public:
     // Sets how much the item weighs, in pounds.
     void setWeight(double weight);
 
+    // Appends the same text that operator<< prints to out, without stream formatting.
+    virtual void appendTo(std::string& out) const;
+
     friend std::ostream& operator<< (std::ostream& out, const Item& item);
 
 
 protected:
+    // Creates an item of a subclass's kind.
+    explicit Item(ItemKind kind);
+
+    // Copies or moves the fields of Item from another item without changing the kind.  For the copy
+    // and move functions of subclasses, after Item(ItemKind); assigned is the class whose fields the
+    // caller copies.  The cached fingerprint is only carried over when both items are exactly of that
+    // class, since otherwise it covers fields that weren't copied.
+    void assignFrom(const Item& other, const std::type_info& assigned);
+    void assignFrom(Item&& other, const std::type_info& assigned) noexcept;
+
     // Protected helper function to support a polymorphic stream insertion operator.
     virtual void printToStream(std::ostream& out) const;
 
+    // Adds every field that operator== compares to the hash.  Subclasses that compare more fields
+    // add them after calling this, in the same order as ItemKey.
+    virtual void addToFingerprint(Fingerprint& hash) const;
+
+    // Discards the cached fingerprint; every setter of a compared field must call this.
+    void invalidateFingerprint();
+
 private:
+#ifdef RPG_SINGLE_THREADED
+    template <typename ItemType>
+    friend class IntrusiveItemPtr;
+
+    // The number of IntrusiveItemPtrs that own the item.  Copying or moving an item doesn't copy it.
+    mutable unsigned long references { 0 };
+#endif
+
+    // The kind of the item, which lets callers check the class of an item without RTTI.
+    ItemKind kind { ItemKind::Item };
+
     // The name of the item.
     std::string name { "Item" };
 
@@ -51,6 +118,9 @@ private:
 
     // How much the item weighs, in pounds.
     double weight { 0.0 };
+
+    // The cached fingerprint, or 0 if it needs to be worked out again.
+    mutable std::atomic<std::uint64_t> fingerprint { 0 };
 };
 
 // Prints the item to an ostream.
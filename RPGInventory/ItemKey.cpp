@@ -0,0 +1,84 @@
+#include "ItemKey.h"
+
+using namespace std;
+
+ItemKey::ItemKey(string_view name, unsigned int goldValue, double weight)
+    : kind{ ItemKind::Item }, name{ name }, goldValue{ goldValue }, weight{ weight }, fingerprint{ computeFingerprint() }
+{
+}
+
+ItemKey::ItemKey(string_view name, unsigned int goldValue, double weight, int damage)
+    : kind{ ItemKind::Weapon }, name{ name }, goldValue{ goldValue }, weight{ weight }, damage{ damage }, fingerprint{ computeFingerprint() }
+{
+}
+
+ItemKey::ItemKey(string_view name, unsigned int goldValue, double weight, unsigned int slotID, int rating)
+    : kind{ ItemKind::Armor }, name{ name }, goldValue{ goldValue }, weight{ weight }, slotID{ slotID }, rating{ rating }, fingerprint{ computeFingerprint() }
+{
+}
+
+ItemKey ItemKey::of(const Item& item, string_view name)
+{
+    switch (item.getKind())
+    {
+    case ItemKind::Weapon:
+        return ItemKey{ name, item.getGoldValue(), item.getWeight(), static_cast<const Weapon&>(item).getDamage() };
+    case ItemKind::Armor:
+    {
+        const Armor& armor{ static_cast<const Armor&>(item) };
+        return ItemKey{ name, item.getGoldValue(), item.getWeight(), armor.getSlotID(), armor.getRating() };
+    }
+    default:
+        return ItemKey{ name, item.getGoldValue(), item.getWeight() };
+    }
+}
+
+ItemKind ItemKey::getKind() const
+{
+    return kind;
+}
+
+string_view ItemKey::getName() const
+{
+    return name;
+}
+
+size_t ItemKey::getHash() const
+{
+    return static_cast<size_t>(fingerprint);
+}
+
+bool ItemKey::matches(const Item& item) const
+{
+    //the same checks as operator==, cheapest first
+    if (item.getFingerprint() != fingerprint || item.getKind() != kind || item.getGoldValue() != goldValue || item.getWeight() != weight)
+    {
+        return false;
+    }
+    if (kind == ItemKind::Weapon && static_cast<const Weapon&>(item).getDamage() != damage)
+    {
+        return false;
+    }
+    if (kind == ItemKind::Armor && (static_cast<const Armor&>(item).getSlotID() != slotID || static_cast<const Armor&>(item).getRating() != rating))
+    {
+        return false;
+    }
+
+    return item.getName() == name;
+}
+
+uint64_t ItemKey::computeFingerprint() const
+{
+    //the same fields in the same order as Item::addToFingerprint and its overrides
+    Fingerprint hash;
+    hash.add(name).add(goldValue).add(weight);
+    if (kind == ItemKind::Weapon)
+    {
+        hash.add(damage);
+    }
+    else if (kind == ItemKind::Armor)
+    {
+        hash.add(slotID).add(rating);
+    }
+    return hash.get();
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include "ItemKind.h"
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+// The fields that identify an item, for finding an equal item in an inventory without building an
+// Item, Weapon or Armor first.
+//
+// A key matches exactly the items that operator== would find equal to the item it describes: an
+// item of the same kind with the same name, gold value, weight and, for weapons and armor, damage or
+// slot and rating.  The name is only viewed, so the text it points to must outlive
+// the key.  The fingerprint of every field is worked out once, when the key is made, and is the same
+// as the fingerprint of the items it matches, so most items that don't match are ruled out by one compare.
+class ItemKey
+{
+public:
+    // Makes a key for a generic item.
+    ItemKey(std::string_view name, unsigned int goldValue, double weight);
+
+    // Makes a key for a weapon.
+    ItemKey(std::string_view name, unsigned int goldValue, double weight, int damage);
+
+    // Makes a key for a piece of armor.
+    ItemKey(std::string_view name, unsigned int goldValue, double weight, unsigned int slotID, int rating);
+
+    // Makes the key that matches an item.  The name is passed in separately so the key can view a string
+    // the caller keeps alive.
+    static ItemKey of(const Item& item, std::string_view name);
+
+    // Gets the kind of item the key describes.
+    ItemKind getKind() const;
+
+    // Gets the name the key views.
+    std::string_view getName() const;
+
+    // Gets the fingerprint of every field, as a hash for unordered containers.  For a matching item it
+    // is the same as the item's own getFingerprint().
+    std::size_t getHash() const;
+
+    // Checks whether the item is one the key describes.
+    bool matches(const Item& item) const;
+
+private:
+    ItemKind kind;
+    std::string_view name;
+    unsigned int goldValue;
+    double weight;
+
+    // Only used for weapons
+    int damage{ 0 };
+
+    // Only used for armor
+    unsigned int slotID{ 0 };
+    int rating{ 0 };
+
+    std::uint64_t fingerprint;
+
+    // Works out the fingerprint of every field the kind uses
+    std::uint64_t computeFingerprint() const;
+};
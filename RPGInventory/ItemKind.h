@@ -0,0 +1,134 @@
+#pragma once
+#include "Item.h"
+#include "ItemPtr.h"
+#include "Weapon.h"
+#include "Armor.h"
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <typeinfo>
+#include <utility>
+
+// Gets the kind of an item, the same as Item::getKind().
+inline ItemKind kindOf(const Item& item)
+{
+    return item.getKind();
+}
+
+// Returns true if the item is exactly of class ItemType and not of a class derived from it.
+template <typename ItemType>
+bool isExactly(const Item& item)
+{
+    return typeid(item) == typeid(ItemType);
+}
+
+// Calls visit with the item cast to Weapon or Armor, chosen by its kind tag, when it is exactly of that
+// class, and with the item as an Item otherwise; returns what visit returns, which must be the same
+// type for every class.  A visitor written as a generic lambda gets one instantiation per class, in
+// which calls such as cloneExact() and appendExact() are resolved statically and can be inlined.  An
+// item of any other class, including one derived from Weapon or Armor, reaches the Item instantiation,
+// where those helpers fall back to the virtual functions.
+template <typename Visitor>
+decltype(auto) visitItem(const Item& item, Visitor&& visit)
+{
+    switch (item.getKind())
+    {
+    case ItemKind::Weapon:
+        if (isExactly<Weapon>(item))
+        {
+            return std::forward<Visitor>(visit)(static_cast<const Weapon&>(item));
+        }
+        break;
+    case ItemKind::Armor:
+        if (isExactly<Armor>(item))
+        {
+            return std::forward<Visitor>(visit)(static_cast<const Armor&>(item));
+        }
+        break;
+    default:
+        break;
+    }
+    return std::forward<Visitor>(visit)(item);
+}
+
+// Like visitItem() above, for an item that the visitor may change or move from.
+template <typename Visitor>
+decltype(auto) visitItem(Item& item, Visitor&& visit)
+{
+    switch (item.getKind())
+    {
+    case ItemKind::Weapon:
+        if (isExactly<Weapon>(item))
+        {
+            return std::forward<Visitor>(visit)(static_cast<Weapon&>(item));
+        }
+        break;
+    case ItemKind::Armor:
+        if (isExactly<Armor>(item))
+        {
+            return std::forward<Visitor>(visit)(static_cast<Armor&>(item));
+        }
+        break;
+    default:
+        break;
+    }
+    return std::forward<Visitor>(visit)(item);
+}
+
+// The helpers below copy or print an item without a virtual call when it is exactly of class
+// ItemType, and call the virtual function otherwise, so an object of a class derived from Item, Weapon
+// or Armor is copied or printed as its own class.
+template <typename ItemType>
+constexpr bool isItemClass{ std::is_same_v<ItemType, Item> || std::is_same_v<ItemType, Weapon> || std::is_same_v<ItemType, Armor> };
+
+// Copies an item.  The same as item.clone().
+template <typename ItemType>
+ItemType* cloneExact(const ItemType& item)
+{
+    static_assert(isItemClass<ItemType>, "the item must be an Item, Weapon or Armor");
+    if (!isExactly<ItemType>(item))
+    {
+        return item.clone();
+    }
+    return new ItemType{ item };
+}
+
+// Like cloneExact(), but the copy is owned by an ItemPtr.  An exact copy is made with makeItem(), so the
+// object and its reference count share one allocation.
+template <typename ItemType>
+ItemPtr<ItemType> cloneShared(const ItemType& item)
+{
+    static_assert(isItemClass<ItemType>, "the item must be an Item, Weapon or Armor");
+    if (!isExactly<ItemType>(item))
+    {
+        return ItemPtr<ItemType>{ item.clone() };
+    }
+    return makeItem<ItemType>(item);
+}
+
+// Like cloneShared(), but the new object takes over the item's name rather than copying it, which
+// leaves the item with an unspecified name.  An item of a derived class is copied instead, since
+// there's no virtual move.
+template <typename ItemType>
+ItemPtr<ItemType> moveShared(ItemType& item)
+{
+    static_assert(isItemClass<ItemType>, "the item must be an Item, Weapon or Armor");
+    if (!isExactly<ItemType>(item))
+    {
+        return ItemPtr<ItemType>{ item.clone() };
+    }
+    return makeItem<ItemType>(std::move(item));
+}
+
+// Appends the text of an item.  The same as item.appendTo(out).
+template <typename ItemType>
+void appendExact(const ItemType& item, std::string& out)
+{
+    static_assert(isItemClass<ItemType>, "the item must be an Item, Weapon or Armor");
+    if (!isExactly<ItemType>(item))
+    {
+        item.appendTo(out);
+        return;
+    }
+    item.ItemType::appendTo(out);
+}
@@ -0,0 +1,192 @@
+#pragma once
+#include "Item.h"
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+#ifdef RPG_SINGLE_THREADED
+// A shared pointer to an item that keeps the reference count in the item itself, in the same
+// allocation, and changes it without atomic operations.  It has the parts of the shared_ptr interface
+// that the inventory and character use.  Copying, moving and destroying handles to the same item on
+// more than one thread at once is not safe.
+template <typename ItemType>
+class IntrusiveItemPtr
+{
+public:
+    // Creates an empty handle.
+    IntrusiveItemPtr() noexcept = default;
+    IntrusiveItemPtr(std::nullptr_t) noexcept
+    {
+    }
+
+    // Takes ownership of an item created with new, which no other handle owns yet.
+    explicit IntrusiveItemPtr(ItemType* item) noexcept : item{ item }
+    {
+        retain();
+    }
+
+    // Takes ownership of the item a unique_ptr owned.
+    template <typename OtherType, typename = std::enable_if_t<std::is_convertible_v<OtherType*, ItemType*>>>
+    IntrusiveItemPtr(std::unique_ptr<OtherType>&& other) noexcept : item{ other.release() }
+    {
+        retain();
+    }
+
+    IntrusiveItemPtr(const IntrusiveItemPtr& other) noexcept : item{ other.item }
+    {
+        retain();
+    }
+
+    IntrusiveItemPtr(IntrusiveItemPtr&& other) noexcept : item{ other.item }
+    {
+        other.item = nullptr;
+    }
+
+    // Converts a handle to a subclass, or to a non-const item, like shared_ptr does.
+    template <typename OtherType, typename = std::enable_if_t<std::is_convertible_v<OtherType*, ItemType*>>>
+    IntrusiveItemPtr(const IntrusiveItemPtr<OtherType>& other) noexcept : item{ other.item }
+    {
+        retain();
+    }
+
+    template <typename OtherType, typename = std::enable_if_t<std::is_convertible_v<OtherType*, ItemType*>>>
+    IntrusiveItemPtr(IntrusiveItemPtr<OtherType>&& other) noexcept : item{ other.item }
+    {
+        other.item = nullptr;
+    }
+
+    ~IntrusiveItemPtr()
+    {
+        release();
+    }
+
+    // Copy and move assignment; the parameter is a copy, so assigning a handle to itself is safe.
+    IntrusiveItemPtr& operator= (IntrusiveItemPtr other) noexcept
+    {
+        swap(other);
+        return *this;
+    }
+
+    // Releases the item, leaving the handle empty.
+    void reset() noexcept
+    {
+        IntrusiveItemPtr{}.swap(*this);
+    }
+
+    void swap(IntrusiveItemPtr& other) noexcept
+    {
+        std::swap(item, other.item);
+    }
+
+    ItemType* get() const noexcept
+    {
+        return item;
+    }
+
+    ItemType& operator* () const noexcept
+    {
+        return *item;
+    }
+
+    ItemType* operator-> () const noexcept
+    {
+        return item;
+    }
+
+    explicit operator bool() const noexcept
+    {
+        return item != nullptr;
+    }
+
+    // Gets the number of handles that own the item, or 0 if this one is empty.
+    long use_count() const noexcept
+    {
+        return item ? static_cast<long>(item->references) : 0;
+    }
+
+private:
+    template <typename OtherType>
+    friend class IntrusiveItemPtr;
+
+    // The item, or nullptr if the handle is empty
+    ItemType* item{ nullptr };
+
+    void retain() noexcept
+    {
+        if (item)
+        {
+            item->references++;
+        }
+    }
+
+    void release() noexcept
+    {
+        if (item && --item->references == 0)
+        {
+            delete item;
+        }
+    }
+};
+
+template <typename ItemType, typename OtherType>
+bool operator== (const IntrusiveItemPtr<ItemType>& lhs, const IntrusiveItemPtr<OtherType>& rhs) noexcept
+{
+    return lhs.get() == rhs.get();
+}
+
+template <typename ItemType, typename OtherType>
+bool operator!= (const IntrusiveItemPtr<ItemType>& lhs, const IntrusiveItemPtr<OtherType>& rhs) noexcept
+{
+    return lhs.get() != rhs.get();
+}
+
+template <typename ItemType>
+bool operator== (const IntrusiveItemPtr<ItemType>& item, std::nullptr_t) noexcept
+{
+    return !item;
+}
+
+template <typename ItemType>
+bool operator!= (const IntrusiveItemPtr<ItemType>& item, std::nullptr_t) noexcept
+{
+    return static_cast<bool>(item);
+}
+#endif
+
+// The handle that owns items in Inventory, Equipment and everything built on them.  It is a shared_ptr,
+// whose reference count is atomic, unless RPG_SINGLE_THREADED is defined; then it is an
+// IntrusiveItemPtr, which saves the atomic operations for builds where a character and its items are
+// only ever used from one thread.  In that build AsyncSnapshotter encodes the character before handing
+// the write to its background thread, so no handle crosses threads.
+#ifdef RPG_SINGLE_THREADED
+template <typename ItemType>
+using ItemPtr = IntrusiveItemPtr<ItemType>;
+#else
+template <typename ItemType>
+using ItemPtr = std::shared_ptr<ItemType>;
+#endif
+
+// Creates an item owned by a new handle, like make_shared: the item and its reference count take one
+// allocation.
+template <typename ItemType, typename... Args>
+ItemPtr<ItemType> makeItem(Args&&... args)
+{
+#ifdef RPG_SINGLE_THREADED
+    return ItemPtr<ItemType>{ new ItemType(std::forward<Args>(args)...) };
+#else
+    return std::make_shared<ItemType>(std::forward<Args>(args)...);
+#endif
+}
+
+// Converts a handle to an item into a handle to its subclass, like static_pointer_cast.  The caller
+// must know the item is of that class, for example from its kind.
+template <typename ToType, typename FromType>
+ItemPtr<ToType> staticItemCast(const ItemPtr<FromType>& item)
+{
+#ifdef RPG_SINGLE_THREADED
+    return ItemPtr<ToType>{ static_cast<ToType*>(item.get()) };
+#else
+    return std::static_pointer_cast<ToType>(item);
+#endif
+}
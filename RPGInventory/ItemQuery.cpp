@@ -0,0 +1,91 @@
+#include "ItemQuery.h"
+#include <stdexcept>
+
+using namespace std;
+
+ItemQuery& ItemQuery::ofKind(ItemKind kind)
+{
+    kinds |= static_cast<uint8_t>(1u << static_cast<unsigned int>(kind));
+    return *this;
+}
+
+ItemQuery& ItemQuery::inSlot(unsigned int slotID)
+{
+    //throw an exception if the slot doesn't exist
+    if (slotID >= Armor::SLOT_COUNT)
+    {
+        throw out_of_range("slot ID does not exist");
+    }
+
+    slots |= static_cast<uint8_t>(1u << slotID);
+    return *this;
+}
+
+ItemQuery& ItemQuery::withRating(int minimum, int maximum)
+{
+    hasRating = true;
+    minimumRating = minimum;
+    maximumRating = maximum;
+    return *this;
+}
+
+ItemQuery& ItemQuery::withDamage(int minimum, int maximum)
+{
+    hasDamage = true;
+    minimumDamage = minimum;
+    maximumDamage = maximum;
+    return *this;
+}
+
+ItemQuery& ItemQuery::withWeight(double minimum, double maximum)
+{
+    hasWeight = true;
+    minimumWeight = minimum;
+    maximumWeight = maximum;
+    return *this;
+}
+
+bool ItemQuery::matches(const Item& item) const
+{
+    const ItemKind kind{ kindOf(item) };
+    if (kinds != 0 && !(kinds & (1u << static_cast<unsigned int>(kind))))
+    {
+        return false;
+    }
+    if (hasWeight && !(item.getWeight() >= minimumWeight && item.getWeight() <= maximumWeight))
+    {
+        return false;
+    }
+
+    if (slots != 0 || hasRating)
+    {
+        if (kind != ItemKind::Armor)
+        {
+            return false;
+        }
+        const Armor& armor{ static_cast<const Armor&>(item) };
+        if (slots != 0 && !(slots & (1u << armor.getSlotID())))
+        {
+            return false;
+        }
+        if (hasRating && (armor.getRating() < minimumRating || armor.getRating() > maximumRating))
+        {
+            return false;
+        }
+    }
+
+    if (hasDamage)
+    {
+        if (kind != ItemKind::Weapon)
+        {
+            return false;
+        }
+        const int damage{ static_cast<const Weapon&>(item).getDamage() };
+        if (damage < minimumDamage || damage > maximumDamage)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
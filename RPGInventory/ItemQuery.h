@@ -0,0 +1,52 @@
+#pragma once
+#include "ItemKind.h"
+#include <cstdint>
+
+// A compound filter over item attributes, for Inventory::query().
+//
+// Every condition that is set must hold.  Kinds and slots may be given more than once, in which case
+// any of them will do; a condition on slot or rating only matches armor, and one on damage only
+// matches weapons.  Ranges are inclusive.  For example, "armor in the head slot with a rating of at
+// least 5 weighing at most 3 lbs." is
+//   ItemQuery{}.ofKind(ItemKind::Armor).inSlot(Armor::HEAD_SLOT).withRating(5, INT_MAX).withWeight(0.0, 3.0)
+class ItemQuery
+{
+public:
+    // Adds a kind of item the query accepts.
+    ItemQuery& ofKind(ItemKind kind);
+
+    // Adds an armor slot the query accepts.
+    // An out_of_range exception is thrown if the slot doesn't exist.
+    ItemQuery& inSlot(unsigned int slotID);
+
+    // Only accepts armor with a rating from minimum to maximum.
+    ItemQuery& withRating(int minimum, int maximum);
+
+    // Only accepts weapons with damage from minimum to maximum.
+    ItemQuery& withDamage(int minimum, int maximum);
+
+    // Only accepts items weighing from minimum to maximum pounds.
+    ItemQuery& withWeight(double minimum, double maximum);
+
+    // Checks an item against every condition directly, without an index.
+    bool matches(const Item& item) const;
+
+private:
+    friend class BitmapIndex;
+
+    // One bit per ItemKind and per slot; zero means any
+    std::uint8_t kinds{ 0 };
+    std::uint8_t slots{ 0 };
+
+    bool hasRating{ false };
+    int minimumRating{ 0 };
+    int maximumRating{ 0 };
+
+    bool hasDamage{ false };
+    int minimumDamage{ 0 };
+    int maximumDamage{ 0 };
+
+    bool hasWeight{ false };
+    double minimumWeight{ 0.0 };
+    double maximumWeight{ 0.0 };
+};
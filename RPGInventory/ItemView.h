@@ -0,0 +1,64 @@
+#pragma once
+#include <iterator>
+#include <utility>
+#include "Item.h"
+
+// A read-only view of a range of items, visited lazily straight out of the index that found them.
+//
+// Iterator is an iterator over elements that point to an Item, either directly like the elements of
+// the inventory's multiset or through their second member like those of its secondary indexes.  Nothing is copied when a view is created;
+// the view is only valid until the inventory it came from is next changed.
+template <typename Iterator>
+class ItemView
+{
+public:
+    // Visits the items of the view in order.
+    class iterator
+    {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = Item;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const Item*;
+        using reference = const Item&;
+
+        iterator() = default;
+        explicit iterator(Iterator position) : position{ position }
+        {
+        }
+
+        reference operator*() const { return itemOf(*position); }
+        pointer operator->() const { return &itemOf(*position); }
+
+        iterator& operator++() { ++position; return *this; }
+        iterator operator++(int) { iterator previous{ *this }; ++position; return previous; }
+
+        bool operator==(const iterator& other) const { return position == other.position; }
+        bool operator!=(const iterator& other) const { return position != other.position; }
+
+    private:
+        Iterator position{};
+
+        // Gets the item an element points to
+        template <typename Pointer>
+        static const Item& itemOf(const Pointer& element) { return *element; }
+
+        template <typename Key, typename Pointer>
+        static const Item& itemOf(const std::pair<Key, Pointer>& element) { return *element.second; }
+    };
+
+    // Creates a view of the elements from first up to, but not including, last.
+    ItemView(Iterator first, Iterator last) : first{ first }, last{ last }
+    {
+    }
+
+    iterator begin() const { return iterator{ first }; }
+    iterator end() const { return iterator{ last }; }
+
+    // Checks if the view has no items.
+    bool empty() const { return first == last; }
+
+private:
+    Iterator first;
+    Iterator last;
+};
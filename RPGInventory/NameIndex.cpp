@@ -0,0 +1,88 @@
+#include "NameIndex.h"
+#include <functional>
+#include <algorithm>
+#include <iterator>
+
+using namespace std;
+
+void NameIndex::add(const ItemPtr<Item>& item)
+{
+    entries.insert(Entry{ fold(item->getName()), item });
+}
+
+void NameIndex::add(const vector<ItemPtr<Item>>& items)
+{
+    //a set built from a sorted range is built in linear time
+    vector<Entry> sorted;
+    sorted.reserve(items.size());
+    for (const ItemPtr<Item>& item : items)
+    {
+        sorted.push_back(Entry{ fold(item->getName()), item });
+    }
+    sort(sorted.begin(), sorted.end(), CompareEntries{});
+    entries.insert(make_move_iterator(sorted.begin()), make_move_iterator(sorted.end()));
+}
+
+void NameIndex::remove(const ItemPtr<Item>& item)
+{
+    //names aren't changed while an item is in the inventory, so the entry has the same folded name
+    auto entry{ entries.find(Entry{ fold(item->getName()), item }) };
+    if (entry != entries.end())
+    {
+        entries.erase(entry);
+    }
+}
+
+void NameIndex::search(string_view text, NameSearch mode, vector<ItemPtr<const Item>>& results) const
+{
+    const bool prefix{ mode == NameSearch::Prefix || mode == NameSearch::PrefixIgnoringCase };
+    const bool ignoreCase{ mode == NameSearch::ExactIgnoringCase || mode == NameSearch::PrefixIgnoringCase };
+    const string folded{ fold(text) };
+
+    //every match has a folded name that starts with (or equals) the folded text, and those are contiguous
+    for (auto entry{ entries.lower_bound(string_view{ folded }) }; entry != entries.end(); entry++)
+    {
+        if (entry->folded.compare(0, folded.size(), folded) != 0)
+        {
+            break;
+        }
+        if (!prefix && entry->folded.size() != folded.size())
+        {
+            continue;
+        }
+        if (!ignoreCase && entry->item->getName().compare(0, text.size(), text) != 0)
+        {
+            continue;
+        }
+        results.push_back(entry->item);
+    }
+}
+
+bool NameIndex::CompareEntries::operator()(const Entry& lhs, const Entry& rhs) const
+{
+    const int order{ lhs.folded.compare(rhs.folded) };
+    return order < 0 || (order == 0 && less<const Item*>{}(lhs.item.get(), rhs.item.get()));
+}
+
+bool NameIndex::CompareEntries::operator()(const Entry& lhs, string_view rhs) const
+{
+    return string_view{ lhs.folded } < rhs;
+}
+
+bool NameIndex::CompareEntries::operator()(string_view lhs, const Entry& rhs) const
+{
+    return lhs < string_view{ rhs.folded };
+}
+
+string NameIndex::fold(string_view text)
+{
+    string folded{ text };
+    for (char& c : folded)
+    {
+        if (c >= 'A' && c <= 'Z')
+        {
+            c = static_cast<char>(c - 'A' + 'a');
+        }
+    }
+    return folded;
+}
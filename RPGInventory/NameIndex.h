@@ -0,0 +1,70 @@
+#pragma once
+#include "Item.h"
+#include "ItemPtr.h"
+#include <memory>
+#include <set>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// How NameIndex::search() compares a name with the text searched for.
+enum class NameSearch : unsigned char
+{
+    // The whole name, with the same case
+    Exact,
+
+    // The start of the name, with the same case
+    Prefix,
+
+    // The whole name, ignoring the case of ASCII letters
+    ExactIgnoringCase,
+
+    // The start of the name, ignoring the case of ASCII letters
+    PrefixIgnoringCase
+};
+
+// A sorted table of item names, for looking items up by name without visiting every item.
+//
+// Names are kept in case-folded order, so every kind of search is one binary search for the folded
+// text followed by a walk over the names that share it; a search that respects case then checks each
+// of those names against the text as given.  Results come in case-folded name order.
+class NameIndex
+{
+public:
+    // Adds an item, which must not already be in the index.
+    void add(const ItemPtr<Item>& item);
+
+    // Adds many items, none of which may already be in the index.  A large batch is sorted first, which is
+    // much cheaper than adding the items one at a time.
+    void add(const std::vector<ItemPtr<Item>>& items);
+
+    // Removes an item, which must be in the index.
+    void remove(const ItemPtr<Item>& item);
+
+    // Appends every item whose name matches the text.
+    void search(std::string_view text, NameSearch mode, std::vector<ItemPtr<const Item>>& results) const;
+
+private:
+    // A name folded to lower case, and the item with that name
+    struct Entry
+    {
+        std::string folded;
+        ItemPtr<const Item> item;
+    };
+
+    // Orders entries by folded name, then by item so every entry is unique; a folded name on its own
+    // can be used for a lookup
+    struct CompareEntries
+    {
+        using is_transparent = void;
+
+        bool operator()(const Entry& lhs, const Entry& rhs) const;
+        bool operator()(const Entry& lhs, std::string_view rhs) const;
+        bool operator()(std::string_view lhs, const Entry& rhs) const;
+    };
+
+    std::set<Entry, CompareEntries> entries;
+
+    // Folds ASCII letters to lower case
+    static std::string fold(std::string_view text);
+};
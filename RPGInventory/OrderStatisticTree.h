@@ -0,0 +1,563 @@
+#pragma once
+#include <cstddef>
+#include <iterator>
+#include <utility>
+
+// An ordered multiset like std::multiset that also knows the position of every element.
+//
+// It is a red-black tree, balanced the same way as std::multiset, in which every node also counts the
+// nodes below it.  That count lets rank() and select() turn an element into its position, or a position
+// into its element, in O(log n) instead of walking from begin().
+//
+// insert(), emplace_hint(), erase() and the bounds work like their std::multiset counterparts: equal
+// elements keep the order they were inserted in, a correct hint inserts right before it, and iterators
+// stay valid until their own element is erased.
+template <typename T, typename Compare>
+class OrderStatisticTree
+{
+    struct Node
+    {
+        template <typename... Args>
+        explicit Node(Args&&... args) : value(std::forward<Args>(args)...)
+        {
+        }
+
+        T value;
+        Node* parent{ nullptr };
+        Node* left{ nullptr };
+        Node* right{ nullptr };
+
+        // The number of nodes in the subtree rooted here, including this one
+        std::size_t size{ 1 };
+
+        // New nodes start red
+        bool red{ true };
+    };
+
+public:
+    using value_type = T;
+    using size_type = std::size_t;
+
+    // A bidirectional iterator over the elements in order.  Elements can't be changed through it,
+    // since that could break the order.
+    class const_iterator
+    {
+    public:
+        using iterator_category = std::bidirectional_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const T*;
+        using reference = const T&;
+
+        const_iterator() = default;
+
+        reference operator*() const { return node->value; }
+        pointer operator->() const { return &node->value; }
+
+        const_iterator& operator++() { node = successor(node); return *this; }
+        const_iterator operator++(int) { const_iterator previous{ *this }; node = successor(node); return previous; }
+        const_iterator& operator--() { node = node ? predecessor(node) : rightmost(tree->root); return *this; }
+        const_iterator operator--(int) { const_iterator previous{ *this }; --*this; return previous; }
+
+        bool operator==(const const_iterator& other) const { return node == other.node; }
+        bool operator!=(const const_iterator& other) const { return node != other.node; }
+
+    private:
+        friend class OrderStatisticTree;
+
+        const_iterator(const OrderStatisticTree* tree, Node* node) : tree{ tree }, node{ node }
+        {
+        }
+
+        // The tree is only needed to step back from end(), which has no node
+        const OrderStatisticTree* tree{ nullptr };
+        Node* node{ nullptr };
+    };
+
+    using iterator = const_iterator;
+    using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+    using reverse_iterator = const_reverse_iterator;
+
+    // Creates an empty tree ordered by compare.
+    explicit OrderStatisticTree(const Compare& compare = Compare{}) : compare{ compare }
+    {
+    }
+
+    // Copies the elements, and the shape of the tree along with them.
+    OrderStatisticTree(const OrderStatisticTree& other) : compare{ other.compare }, root{ copy(other.root, nullptr) }
+    {
+    }
+
+    OrderStatisticTree(OrderStatisticTree&& other) noexcept : compare{ other.compare }, root{ other.root }
+    {
+        other.root = nullptr;
+    }
+
+    OrderStatisticTree& operator=(OrderStatisticTree other) noexcept
+    {
+        std::swap(compare, other.compare);
+        std::swap(root, other.root);
+        return *this;
+    }
+
+    ~OrderStatisticTree()
+    {
+        clear();
+    }
+
+    const_iterator begin() const { return { this, leftmost(root) }; }
+    const_iterator end() const { return { this, nullptr }; }
+    const_reverse_iterator rbegin() const { return const_reverse_iterator{ end() }; }
+    const_reverse_iterator rend() const { return const_reverse_iterator{ begin() }; }
+
+    size_type size() const { return sizeOf(root); }
+    bool empty() const { return root == nullptr; }
+
+    // Removes every element.
+    void clear()
+    {
+        destroy(root);
+        root = nullptr;
+    }
+
+    // Inserts an element after any elements equal to it.
+    iterator insert(const T& value) { return emplace(value); }
+    iterator insert(T&& value) { return emplace(std::move(value)); }
+
+    // Constructs an element in place after any elements equal to it.
+    template <typename... Args>
+    iterator emplace(Args&&... args)
+    {
+        Node* node{ new Node{ std::forward<Args>(args)... } };
+        Node* parent{ nullptr };
+        Node** link{ &root };
+        while (*link)
+        {
+            //count the new node into each subtree on the way down rather than walking back up
+            parent = *link;
+            parent->size++;
+            link = compare(node->value, parent->value) ? &parent->left : &parent->right;
+        }
+        *link = node;
+        node->parent = parent;
+        rebalanceAfterInsert(node);
+        return { this, node };
+    }
+
+    // Constructs an element in place right before hint, if that is a correct position for it;
+    // otherwise as close to hint as the order allows.
+    template <typename... Args>
+    iterator emplace_hint(const_iterator hint, Args&&... args)
+    {
+        Node* node{ new Node{ std::forward<Args>(args)... } };
+        Node* next{ hint.node };
+        if (next && compare(next->value, node->value))
+        {
+            next = lowerBound(node->value);
+        }
+        else
+        {
+            Node* previous{ next ? predecessor(next) : rightmost(root) };
+            if (previous && compare(node->value, previous->value))
+            {
+                next = upperBound(node->value);
+            }
+        }
+
+        //the new node is next's in-order predecessor: its left child if it has none, or else the
+        //right child of the rightmost node on its left
+        if (!next)
+        {
+            Node* last{ rightmost(root) };
+            return { this, last ? attach(node, last, last->right) : attach(node, nullptr, root) };
+        }
+        if (!next->left)
+        {
+            return { this, attach(node, next, next->left) };
+        }
+        Node* previous{ rightmost(next->left) };
+        return { this, attach(node, previous, previous->right) };
+    }
+
+    // Erases an element and returns the iterator following it.
+    iterator erase(const_iterator position)
+    {
+        Node* node{ position.node };
+        Node* next{ successor(node) };
+
+        //unlink the node; one with two children is replaced by its successor, which has no left child.
+        //child is whatever took the place of the node that was actually removed from its position.
+        Node* child;
+        Node* childParent;
+        bool removedRed{ node->red };
+        if (!node->left || !node->right)
+        {
+            child = node->left ? node->left : node->right;
+            childParent = node->parent;
+            replace(node, child);
+        }
+        else
+        {
+            removedRed = next->red;
+            child = next->right;
+            if (next->parent == node)
+            {
+                childParent = next;
+            }
+            else
+            {
+                childParent = next->parent;
+                replace(next, next->right);
+                next->right = node->right;
+                next->right->parent = next;
+            }
+            replace(node, next);
+            next->left = node->left;
+            next->left->parent = next;
+            next->red = node->red;
+        }
+
+        //every subtree that lost the node lies on the path up from childParent
+        for (Node* ancestor{ childParent }; ancestor; ancestor = ancestor->parent)
+        {
+            ancestor->size = 1 + sizeOf(ancestor->left) + sizeOf(ancestor->right);
+        }
+        if (!removedRed)
+        {
+            rebalanceAfterErase(child, childParent);
+        }
+        delete node;
+
+        return { this, next };
+    }
+
+    // Finds the first element that isn't ordered before key.
+    template <typename Key>
+    const_iterator lower_bound(const Key& key) const { return { this, lowerBound(key) }; }
+
+    // Finds the first element that is ordered after key.
+    template <typename Key>
+    const_iterator upper_bound(const Key& key) const { return { this, upperBound(key) }; }
+
+    // Finds the range of elements equal to key.
+    template <typename Key>
+    std::pair<const_iterator, const_iterator> equal_range(const Key& key) const { return { lower_bound(key), upper_bound(key) }; }
+
+    // Gets the number of elements before position; size() for end().
+    size_type rank(const_iterator position) const
+    {
+        if (!position.node)
+        {
+            return size();
+        }
+
+        size_type before{ sizeOf(position.node->left) };
+        for (const Node* node{ position.node }; node->parent; node = node->parent)
+        {
+            if (node == node->parent->right)
+            {
+                before += sizeOf(node->parent->left) + 1;
+            }
+        }
+        return before;
+    }
+
+    // Gets the element at index, counting from 0 at begin(); end() if there are not that many.
+    const_iterator select(size_type index) const
+    {
+        Node* node{ root };
+        while (node)
+        {
+            const size_type before{ sizeOf(node->left) };
+            if (index == before)
+            {
+                break;
+            }
+            if (index < before)
+            {
+                node = node->left;
+            }
+            else
+            {
+                index -= before + 1;
+                node = node->right;
+            }
+        }
+        return { this, node };
+    }
+
+private:
+    Compare compare;
+    Node* root{ nullptr };
+
+    static size_type sizeOf(const Node* node) { return node ? node->size : 0; }
+
+    // Missing children count as black
+    static bool isRed(const Node* node) { return node && node->red; }
+
+    static Node* leftmost(Node* node)
+    {
+        while (node && node->left)
+        {
+            node = node->left;
+        }
+        return node;
+    }
+
+    static Node* rightmost(Node* node)
+    {
+        while (node && node->right)
+        {
+            node = node->right;
+        }
+        return node;
+    }
+
+    static Node* successor(Node* node)
+    {
+        if (node->right)
+        {
+            return leftmost(node->right);
+        }
+        while (node->parent && node == node->parent->right)
+        {
+            node = node->parent;
+        }
+        return node->parent;
+    }
+
+    static Node* predecessor(Node* node)
+    {
+        if (node->left)
+        {
+            return rightmost(node->left);
+        }
+        while (node->parent && node == node->parent->left)
+        {
+            node = node->parent;
+        }
+        return node->parent;
+    }
+
+    template <typename Key>
+    Node* lowerBound(const Key& key) const
+    {
+        Node* found{ nullptr };
+        for (Node* node{ root }; node;)
+        {
+            if (compare(node->value, key))
+            {
+                node = node->right;
+            }
+            else
+            {
+                found = node;
+                node = node->left;
+            }
+        }
+        return found;
+    }
+
+    template <typename Key>
+    Node* upperBound(const Key& key) const
+    {
+        Node* found{ nullptr };
+        for (Node* node{ root }; node;)
+        {
+            if (compare(key, node->value))
+            {
+                found = node;
+                node = node->left;
+            }
+            else
+            {
+                node = node->right;
+            }
+        }
+        return found;
+    }
+
+    // Hangs a new leaf from parent at link, then rebalances
+    Node* attach(Node* node, Node* parent, Node*& link)
+    {
+        link = node;
+        node->parent = parent;
+        for (Node* ancestor{ parent }; ancestor; ancestor = ancestor->parent)
+        {
+            ancestor->size++;
+        }
+        rebalanceAfterInsert(node);
+        return node;
+    }
+
+    // Restores the red-black rules after a red leaf is added: no red node has a red parent, and the
+    // root is black
+    void rebalanceAfterInsert(Node* node)
+    {
+        while (isRed(node->parent))
+        {
+            Node* parent{ node->parent };
+            Node* grandparent{ parent->parent };
+            Node* uncle{ parent == grandparent->left ? grandparent->right : grandparent->left };
+            if (isRed(uncle))
+            {
+                //push the grandparent's blackness down and carry on from there
+                parent->red = false;
+                uncle->red = false;
+                grandparent->red = true;
+                node = grandparent;
+                continue;
+            }
+
+            //line the node up on the same side as its parent, then rotate the parent over the grandparent
+            if ((node == parent->left) != (parent == grandparent->left))
+            {
+                rotateUp(node);
+                parent = node;
+            }
+            parent->red = false;
+            grandparent->red = true;
+            rotateUp(parent);
+            break;
+        }
+        root->red = false;
+    }
+
+    // Restores the red-black rules after a black node is removed: every path from a node down to a
+    // missing child passes the same number of black nodes.  node, which may be missing, took the
+    // removed node's place under parent, and its side is one black short.
+    void rebalanceAfterErase(Node* node, Node* parent)
+    {
+        while (node != root && !isRed(node))
+        {
+            const bool onLeft{ node == parent->left };
+            Node* sibling{ onLeft ? parent->right : parent->left };
+            if (sibling->red)
+            {
+                sibling->red = false;
+                parent->red = true;
+                rotateUp(sibling);
+                sibling = onLeft ? parent->right : parent->left;
+            }
+
+            Node* nearNephew{ onLeft ? sibling->left : sibling->right };
+            Node* farNephew{ onLeft ? sibling->right : sibling->left };
+            if (!isRed(nearNephew) && !isRed(farNephew))
+            {
+                //take one black off the sibling's side too, and move the shortfall up
+                sibling->red = true;
+                node = parent;
+                parent = node->parent;
+                continue;
+            }
+
+            if (!isRed(farNephew))
+            {
+                nearNephew->red = false;
+                sibling->red = true;
+                rotateUp(nearNephew);
+                farNephew = sibling;
+                sibling = nearNephew;
+            }
+            sibling->red = parent->red;
+            parent->red = false;
+            farNephew->red = false;
+            rotateUp(sibling);
+            node = root;
+        }
+        if (node)
+        {
+            node->red = false;
+        }
+    }
+
+    // Puts replacement (which may be missing) where node hangs from its parent
+    void replace(Node* node, Node* replacement)
+    {
+        if (!node->parent)
+        {
+            root = replacement;
+        }
+        else
+        {
+            (node->parent->left == node ? node->parent->left : node->parent->right) = replacement;
+        }
+        if (replacement)
+        {
+            replacement->parent = node->parent;
+        }
+    }
+
+    // Swaps a node with its parent, keeping the in-order sequence and both subtree sizes right
+    void rotateUp(Node* node)
+    {
+        Node* parent{ node->parent };
+        Node* grandparent{ parent->parent };
+        if (node == parent->left)
+        {
+            parent->left = node->right;
+            if (node->right)
+            {
+                node->right->parent = parent;
+            }
+            node->right = parent;
+        }
+        else
+        {
+            parent->right = node->left;
+            if (node->left)
+            {
+                node->left->parent = parent;
+            }
+            node->left = parent;
+        }
+
+        parent->parent = node;
+        node->parent = grandparent;
+        if (!grandparent)
+        {
+            root = node;
+        }
+        else
+        {
+            (grandparent->left == parent ? grandparent->left : grandparent->right) = node;
+        }
+
+        node->size = parent->size;
+        parent->size = 1 + sizeOf(parent->left) + sizeOf(parent->right);
+    }
+
+    static Node* copy(const Node* node, Node* parent)
+    {
+        if (!node)
+        {
+            return nullptr;
+        }
+
+        Node* copied{ new Node{ node->value } };
+        copied->parent = parent;
+        copied->size = node->size;
+        copied->red = node->red;
+        try
+        {
+            copied->left = copy(node->left, copied);
+            copied->right = copy(node->right, copied);
+        }
+        catch (...)
+        {
+            destroy(copied);
+            throw;
+        }
+        return copied;
+    }
+
+    static void destroy(Node* node)
+    {
+        if (node)
+        {
+            destroy(node->left);
+            destroy(node->right);
+            delete node;
+        }
+    }
+};
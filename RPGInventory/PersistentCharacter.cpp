@@ -0,0 +1,456 @@
+#include "PersistentCharacter.h"
+#include "CharacterSerializer.h"
+#include "DurableFile.h"
+#include <stdexcept>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <iterator>
+#include <cstring>
+
+using namespace std;
+
+namespace
+{
+    //the first four bytes of every snapshot
+    const char SNAPSHOT_MAGIC[4]{ 'R', 'P', 'G', 'S' };
+
+    //the operations that can appear in the log
+    enum LogOperation : uint8_t
+    {
+        ADD_ITEM = 1,
+        DROP_ITEM = 2,
+        EQUIP_ARMOR = 3,
+        UNEQUIP_ARMOR = 4,
+        EQUIP_WEAPON = 5,
+        UNEQUIP_WEAPON = 6,
+        OPTIMIZE_INVENTORY = 7,
+        OPTIMIZE_EQUIPMENT = 8
+    };
+
+    //32-bit FNV-1a, enough to tell a torn record from a whole one
+    uint32_t checksum(const char* data, size_t size)
+    {
+        uint32_t hash{ 2166136261u };
+        for (size_t i{ 0 }; i < size; i++)
+        {
+            hash ^= static_cast<unsigned char>(data[i]);
+            hash *= 16777619u;
+        }
+        return hash;
+    }
+
+    string readFile(const string& path)
+    {
+        ifstream in{ path, ios::binary };
+        return string{ istreambuf_iterator<char>{ in }, istreambuf_iterator<char>{} };
+    }
+}
+
+PersistentCharacter::PersistentCharacter(const string& path, chrono::milliseconds commitInterval, unsigned int snapshotInterval)
+    : logPath{ path + ".log" }, snapshotPath{ path + ".snapshot" }, commitInterval{ commitInterval }, snapshotInterval{ snapshotInterval },
+    lastCommit{ chrono::steady_clock::now() }
+{
+    recover();
+    log = openFile(logPath, "ab");
+    logSize = filesystem::file_size(logPath);
+
+    //with no interval every mutation commits, so there's nothing for the thread to do
+    if (commitInterval.count() > 0)
+    {
+        flusher = thread{ &PersistentCharacter::flush, this };
+    }
+}
+
+PersistentCharacter::~PersistentCharacter()
+{
+    if (flusher.joinable())
+    {
+        {
+            lock_guard<std::mutex> lock{ stateMutex };
+            stopping = true;
+        }
+        flusherWake.notify_one();
+        flusher.join();
+    }
+
+    //a destructor can't report a failed write, so whatever didn't make it is lost as in a crash
+    try
+    {
+        commit();
+    }
+    catch (const exception&)
+    {
+    }
+    if (log)
+    {
+        fclose(log);
+    }
+}
+
+const Character& PersistentCharacter::getCharacter() const
+{
+    return character;
+}
+
+vector<ItemPtr<Item>> PersistentCharacter::addItem(const Item& item)
+{
+    lock_guard<std::mutex> lock{ stateMutex };
+    vector<ItemPtr<Item>> evicted{ character.addItem(item) };
+
+    string arguments;
+    BinaryWriter writer{ arguments };
+    CharacterSerializer::writeItemRecord(writer, item);
+    append(ADD_ITEM, arguments);
+
+    return evicted;
+}
+
+void PersistentCharacter::dropItem(const Item& item)
+{
+    lock_guard<std::mutex> lock{ stateMutex };
+    character.dropItem(item);
+
+    string arguments;
+    BinaryWriter writer{ arguments };
+    CharacterSerializer::writeItemRecord(writer, item);
+    append(DROP_ITEM, arguments);
+}
+
+void PersistentCharacter::equipArmor(const Armor& armor)
+{
+    lock_guard<std::mutex> lock{ stateMutex };
+    character.equipArmor(armor);
+
+    string arguments;
+    BinaryWriter writer{ arguments };
+    CharacterSerializer::writeItemRecord(writer, armor);
+    append(EQUIP_ARMOR, arguments);
+}
+
+void PersistentCharacter::unequipArmor(unsigned int slotID)
+{
+    lock_guard<std::mutex> lock{ stateMutex };
+    character.unequipArmor(slotID);
+
+    string arguments;
+    BinaryWriter writer{ arguments };
+    writer.writeVarint(slotID);
+    append(UNEQUIP_ARMOR, arguments);
+}
+
+void PersistentCharacter::equipWeapon(const Weapon& weapon)
+{
+    lock_guard<std::mutex> lock{ stateMutex };
+    character.equipWeapon(weapon);
+
+    string arguments;
+    BinaryWriter writer{ arguments };
+    CharacterSerializer::writeItemRecord(writer, weapon);
+    append(EQUIP_WEAPON, arguments);
+}
+
+void PersistentCharacter::unequipWeapon()
+{
+    lock_guard<std::mutex> lock{ stateMutex };
+    character.unequipWeapon();
+    append(UNEQUIP_WEAPON, {});
+}
+
+void PersistentCharacter::optimizeInventory(double maximumWeight)
+{
+    lock_guard<std::mutex> lock{ stateMutex };
+    character.optimizeInventory(maximumWeight);
+
+    string arguments;
+    BinaryWriter writer{ arguments };
+    writer.writeDouble(maximumWeight);
+    append(OPTIMIZE_INVENTORY, arguments);
+}
+
+void PersistentCharacter::optimizeEquipment()
+{
+    lock_guard<std::mutex> lock{ stateMutex };
+    character.optimizeEquipment();
+    append(OPTIMIZE_EQUIPMENT, {});
+}
+
+void PersistentCharacter::sync()
+{
+    lock_guard<std::mutex> lock{ stateMutex };
+    commit();
+}
+
+void PersistentCharacter::snapshot()
+{
+    lock_guard<std::mutex> lock{ stateMutex };
+    saveSnapshot();
+}
+
+unsigned int PersistentCharacter::getLogRecordCount() const
+{
+    lock_guard<std::mutex> lock{ stateMutex };
+    return logRecordCount;
+}
+
+unsigned int PersistentCharacter::getPendingRecordCount() const
+{
+    lock_guard<std::mutex> lock{ stateMutex };
+    return pendingCount;
+}
+
+void PersistentCharacter::saveSnapshot()
+{
+    commit();
+
+    //swap the new snapshot in whole, so a crash leaves one or the other
+    string buffer(SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+    BinaryWriter writer{ buffer };
+    writer.writeVarint(sequence);
+    ostringstream saved;
+    CharacterSerializer::save(character, saved);
+    buffer.append(saved.str());
+
+    replaceFile(snapshotPath, buffer);
+
+    //every logged record is now in the snapshot; if the truncation is lost, recovery skips them by sequence number
+    fclose(log);
+    log = nullptr;
+    log = openFile(logPath, "wb");
+    syncFile(log, logPath);
+    logSize = 0;
+    logRecordCount = 0;
+}
+
+void PersistentCharacter::recover()
+{
+    //start from the snapshot, if there is one
+    uint64_t snapshotSequence{ 0 };
+    if (filesystem::exists(snapshotPath))
+    {
+        const string data{ readFile(snapshotPath) };
+        BinaryReader reader{ data.data(), data.size() };
+        if (data.size() < sizeof(SNAPSHOT_MAGIC) || memcmp(reader.readBytes(sizeof(SNAPSHOT_MAGIC)), SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0)
+        {
+            throw runtime_error("not a character snapshot: " + snapshotPath);
+        }
+        snapshotSequence = reader.readVarint();
+
+        //the rest is a saved character; load() throws if it's corrupt
+        const char* rest{ reader.readBytes(0) };
+        istringstream saved{ string{ rest, data.data() + data.size() } };
+        CharacterSerializer::load(character, saved);
+    }
+    sequence = snapshotSequence;
+
+    if (!filesystem::exists(logPath))
+    {
+        return;
+    }
+
+    //replay each whole record; the first torn one marks the end of what was committed
+    const string data{ readFile(logPath) };
+    size_t committed{ 0 };
+    while (committed < data.size())
+    {
+        BinaryReader reader{ data.data() + committed, data.size() - committed };
+        const char* payload{ nullptr };
+        uint64_t length{ 0 };
+        try
+        {
+            length = reader.readVarint();
+            if (length > data.size())
+            {
+                break;
+            }
+            payload = reader.readBytes(static_cast<size_t>(length));
+            const char* stored{ reader.readBytes(4) };
+            const uint32_t expected{ checksum(payload, static_cast<size_t>(length)) };
+            uint32_t actual{ 0 };
+            for (int i{ 3 }; i >= 0; i--)
+            {
+                actual = (actual << 8) | static_cast<unsigned char>(stored[i]);
+            }
+            if (actual != expected)
+            {
+                break;
+            }
+        }
+        catch (const runtime_error&)
+        {
+            break;
+        }
+
+        BinaryReader record{ payload, static_cast<size_t>(length) };
+        const uint64_t recordSequence{ record.readVarint() };
+        const uint8_t operation{ record.readByte() };
+
+        //records already in the snapshot were left behind by an interrupted truncation
+        if (recordSequence > sequence)
+        {
+            try
+            {
+                replay(operation, record);
+            }
+            catch (const exception&)
+            {
+                throw runtime_error("corrupt character log: record " + to_string(recordSequence) + " can't be replayed");
+            }
+            sequence = recordSequence;
+            logRecordCount++;
+        }
+
+        committed = static_cast<size_t>(reader.readBytes(0) - data.data());
+    }
+
+    //cut off the torn tail so new records aren't appended after it
+    if (committed < data.size())
+    {
+        filesystem::resize_file(logPath, committed);
+    }
+}
+
+void PersistentCharacter::replay(uint8_t operation, BinaryReader& reader)
+{
+    switch (operation)
+    {
+    case ADD_ITEM:
+        character.addItem(move(*CharacterSerializer::readItemRecord(reader)));
+        break;
+    case DROP_ITEM:
+        character.dropItem(*CharacterSerializer::readItemRecord(reader));
+        break;
+    case EQUIP_ARMOR:
+    {
+        ItemPtr<Item> item{ CharacterSerializer::readItemRecord(reader) };
+        if (!item || item->getKind() != ItemKind::Armor)
+        {
+            throw runtime_error("corrupt character log: equipped armor");
+        }
+        character.equipArmor(static_cast<const Armor&>(*item));
+        break;
+    }
+    case UNEQUIP_ARMOR:
+        character.unequipArmor(static_cast<unsigned int>(reader.readVarint()));
+        break;
+    case EQUIP_WEAPON:
+    {
+        ItemPtr<Item> item{ CharacterSerializer::readItemRecord(reader) };
+        if (!item || item->getKind() != ItemKind::Weapon)
+        {
+            throw runtime_error("corrupt character log: equipped weapon");
+        }
+        character.equipWeapon(static_cast<const Weapon&>(*item));
+        break;
+    }
+    case UNEQUIP_WEAPON:
+        character.unequipWeapon();
+        break;
+    case OPTIMIZE_INVENTORY:
+        character.optimizeInventory(reader.readDouble());
+        break;
+    case OPTIMIZE_EQUIPMENT:
+        character.optimizeEquipment();
+        break;
+    default:
+        throw runtime_error("corrupt character log: operation");
+    }
+}
+
+void PersistentCharacter::append(uint8_t operation, const string& arguments)
+{
+    //a record is its length, then the sequence number, operation and arguments, then a checksum of those
+    string payload;
+    BinaryWriter payloadWriter{ payload };
+    payloadWriter.writeVarint(sequence + 1);
+    payloadWriter.writeByte(operation);
+    payload.append(arguments);
+
+    BinaryWriter writer{ pending };
+    writer.writeVarint(payload.size());
+    pending.append(payload);
+    const uint32_t sum{ checksum(payload.data(), payload.size()) };
+    for (int i{ 0 }; i < 4; i++)
+    {
+        writer.writeByte(static_cast<uint8_t>(sum >> (8 * i)));
+    }
+
+    sequence++;
+    pendingCount++;
+    logRecordCount++;
+
+    //group commit: the first mutation after the interval has passed writes the whole group, unless the
+    //flush thread gets there first
+    if (snapshotInterval != 0 && logRecordCount >= snapshotInterval)
+    {
+        saveSnapshot();
+    }
+    else if (chrono::steady_clock::now() - lastCommit >= commitInterval)
+    {
+        commit();
+    }
+}
+
+void PersistentCharacter::commit()
+{
+    if (!pending.empty())
+    {
+        //throw an exception if the log can't be written
+        if (!log)
+        {
+            throw runtime_error("could not write " + logPath + ": an earlier write failed");
+        }
+        try
+        {
+            if (fwrite(pending.data(), 1, pending.size(), log) != pending.size())
+            {
+                throw runtime_error("could not write " + logPath);
+            }
+            syncFile(log, logPath);
+        }
+        catch (const runtime_error&)
+        {
+            //cut off whatever part of the group got through, so the retry doesn't follow torn bytes;
+            //if that fails too the log is left closed rather than appended to
+            fclose(log);
+            log = nullptr;
+            try
+            {
+                filesystem::resize_file(logPath, logSize);
+                log = openFile(logPath, "ab");
+            }
+            catch (const exception&)
+            {
+            }
+            throw;
+        }
+        logSize += pending.size();
+        pending.clear();
+        pendingCount = 0;
+    }
+    lastCommit = chrono::steady_clock::now();
+}
+
+void PersistentCharacter::flush()
+{
+    unique_lock<std::mutex> lock{ stateMutex };
+    while (!stopping)
+    {
+        flusherWake.wait_until(lock, lastCommit + commitInterval);
+
+        //a commit by a mutation in the meantime moves the deadline on
+        if (!stopping && chrono::steady_clock::now() - lastCommit >= commitInterval)
+        {
+            //nobody is there to catch a failure; the records stay buffered, and the next mutation or
+            //sync() retries and reports it
+            try
+            {
+                commit();
+            }
+            catch (const exception&)
+            {
+                lastCommit = chrono::steady_clock::now();
+            }
+        }
+    }
+}
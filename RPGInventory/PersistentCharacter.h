@@ -0,0 +1,137 @@
+#pragma once
+#include "Character.h"
+#include "BinaryFormat.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// A character whose mutations survive a crash.  Every successful call to one of the mutating
+// functions below is appended to a write-ahead log, and the log is flushed and synced to disk in
+// group commits: records are buffered and written together once the commit interval has passed
+// since the last commit, when sync() is called, or on destruction.  A background thread commits
+// the group when the interval runs out, so the last records are written even if no mutation follows.
+// A mutation is only durable once its group has been committed.
+//
+// If a commit fails, the records in the group stay buffered and the next commit retries them.  Any
+// part of the group that did reach the log is cut off first, so a retry never follows torn bytes; if
+// that isn't possible, the log is closed and every later commit throws, and reopening the character
+// recovers what was committed.
+//
+// The files used are path + ".log" for the log and path + ".snapshot" for the latest snapshot.
+// A snapshot saves the whole character with CharacterSerializer and truncates the log; one is taken
+// automatically every snapshotInterval records, or on request.  Opening a persistent character
+// recovers it by loading the snapshot and replaying the log on top of it.  A record that was only
+// partly written when the process stopped is discarded, along with anything after it.
+class PersistentCharacter
+{
+public:
+    // Opens the character stored at path, creating it if neither file exists, and recovers it.
+    // commitInterval is the longest a record waits in the buffer before a mutation commits it; zero
+    // commits every mutation.  snapshotInterval is the number of records between automatic
+    // snapshots; zero disables automatic snapshots.
+    // A runtime_error is thrown if the files can't be opened or the snapshot or log is corrupt.
+    PersistentCharacter(const std::string& path, std::chrono::milliseconds commitInterval, unsigned int snapshotInterval = 0);
+
+    // Commits any buffered records and closes the log.
+    ~PersistentCharacter();
+
+    // Copying is deleted; each persistent character owns its files.
+    PersistentCharacter(const PersistentCharacter& character) = delete;
+
+    // Copy assignment is deleted; each persistent character owns its files.
+    PersistentCharacter& operator = (const PersistentCharacter& character) = delete;
+
+    // Gets the character, for reading.  Reading it while another thread calls a mutating function
+    // isn't safe.
+    const Character& getCharacter() const;
+
+    // The mutating functions behave like the ones on Character, and throw the same exceptions.
+    // A call that Character rejects is not logged.  If the call is applied but committing its group
+    // fails, a runtime_error is thrown and the change is not undone: the character keeps it and its
+    // record stays buffered until a later commit succeeds.
+    std::vector<ItemPtr<Item>> addItem(const Item& item);
+    void dropItem(const Item& item);
+    void equipArmor(const Armor& armor);
+    void unequipArmor(unsigned int slotID);
+    void equipWeapon(const Weapon& weapon);
+    void unequipWeapon();
+    void optimizeInventory(double maximumWeight);
+    void optimizeEquipment();
+
+    // Writes, flushes and syncs every buffered record now.
+    // A runtime_error is thrown if the log can't be written.
+    void sync();
+
+    // Commits the buffered records, saves a snapshot of the character and truncates the log.
+    // A runtime_error is thrown if the snapshot or log can't be written.
+    void snapshot();
+
+    // Gets the number of records written since the last snapshot, including buffered ones.
+    unsigned int getLogRecordCount() const;
+
+    // Gets the number of records waiting for the next group commit.
+    unsigned int getPendingRecordCount() const;
+
+private:
+    // The character being persisted
+    Character character;
+
+    // The log and snapshot files
+    std::string logPath;
+    std::string snapshotPath;
+
+    // The open log, positioned at its end, or nullptr if a failed write left it unusable
+    std::FILE* log{ nullptr };
+
+    // The size of the log up to the end of the last committed record
+    std::uint64_t logSize{ 0 };
+
+    // Records waiting for the next group commit, already framed
+    std::string pending;
+    unsigned int pendingCount{ 0 };
+
+    // Group commit and snapshot settings
+    std::chrono::milliseconds commitInterval;
+    unsigned int snapshotInterval;
+
+    // When the last group commit happened
+    std::chrono::steady_clock::time_point lastCommit;
+
+    // The sequence number of the last record; the snapshot records the last one it includes
+    std::uint64_t sequence{ 0 };
+
+    // Records in the log since the last snapshot
+    unsigned int logRecordCount{ 0 };
+
+    // Guards everything above against the flush thread
+    mutable std::mutex stateMutex;
+
+    // The thread that commits a group when the interval runs out, and how it's woken to stop
+    std::thread flusher;
+    std::condition_variable flusherWake;
+    bool stopping{ false };
+
+    // Loads the snapshot and replays the log onto it
+    void recover();
+
+    // Applies one logged operation to the character
+    void replay(std::uint8_t operation, BinaryReader& reader);
+
+    // Frames a record with its sequence number and checksum, buffers it, and commits or snapshots if it's time
+    void append(std::uint8_t operation, const std::string& arguments);
+
+    // Commits, saves a snapshot and truncates the log; the caller holds the mutex
+    void saveSnapshot();
+
+    // Writes and syncs the buffered records; the caller holds the mutex
+    void commit();
+
+    // Commits on the flush thread whenever the interval runs out, until stopping is set
+    void flush();
+};
@@ -0,0 +1,23 @@
+#pragma once
+#include <charconv>
+#include <string>
+#include <type_traits>
+
+// Appends a number to a string, exactly as an ostream with default formatting would print it, without
+// going through a stream or allocating beyond the string's own growth.  Floating point values are
+// written like the default ostream precision of 6 significant digits.
+template <typename T>
+void appendNumber(std::string& out, T value)
+{
+    char digits[32];
+    std::to_chars_result result;
+    if constexpr (std::is_floating_point_v<T>)
+    {
+        result = std::to_chars(digits, digits + sizeof(digits), value, std::chars_format::general, 6);
+    }
+    else
+    {
+        result = std::to_chars(digits, digits + sizeof(digits), value);
+    }
+    out.append(digits, result.ptr);
+}
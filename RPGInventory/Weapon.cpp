@@ -1,4 +1,34 @@
 #include "Weapon.h"
+#include "TextFormat.h"
+#include <utility>
+
+Weapon::Weapon() : Item { ItemKind::Weapon }
+{
+}
+
+Weapon::Weapon(const Weapon& other) : Item { ItemKind::Weapon }, damage { other.damage }
+{
+    assignFrom(other, typeid(Weapon));
+}
+
+Weapon& Weapon::operator=(const Weapon& other)
+{
+    damage = other.damage;
+    assignFrom(other, typeid(Weapon));
+    return *this;
+}
+
+Weapon::Weapon(Weapon&& other) noexcept : Item { ItemKind::Weapon }, damage { other.damage }
+{
+    assignFrom(std::move(other), typeid(Weapon));
+}
+
+Weapon& Weapon::operator=(Weapon&& other) noexcept
+{
+    damage = other.damage;
+    assignFrom(std::move(other), typeid(Weapon));
+    return *this;
+}
 
 Weapon* Weapon::clone() const
 {
@@ -7,15 +37,22 @@ Weapon* Weapon::clone() const
 
 bool Weapon::operator==(const Item& other) const
 {
-    // If the dynamic_cast succeeds, execution will enter the if statement.
-    if (const Weapon* otherArmor = dynamic_cast<const Weapon*>(&other))
+    // Different fingerprints can't be equal, which is cheaper to find out than checking the kind.
+    if (this->getFingerprint() != other.getFingerprint())
+    {
+        return false;
+    }
+
+    // If the other item is a weapon too, execution will enter the if statement.
+    if (other.getKind() == ItemKind::Weapon)
     {
+        const Weapon* otherArmor { static_cast<const Weapon*>(&other) };
         return Item::operator==(other) // Invoke the superclass's == operator
             && this->getDamage() == otherArmor->getDamage();
     }
     else
     {
-        // dynamic_cast failed, other item is not armor.
+        // The other item is not a weapon.
         return false;
     }
 }
@@ -28,6 +65,13 @@ int Weapon::getDamage() const
 void Weapon::setDamage(int damage)
 {
     this->damage = damage;
+    invalidateFingerprint();
+}
+
+void Weapon::addToFingerprint(Fingerprint& hash) const
+{
+    Item::addToFingerprint(hash);
+    hash.add(damage);
 }
 
 void Weapon::printToStream(std::ostream& out) const
@@ -38,3 +82,11 @@ void Weapon::printToStream(std::ostream& out) const
     // Append the weapon damage
     out << ", " << damage << " DMG";
 }
+
+void Weapon::appendTo(std::string& out) const
+{
+    Item::appendTo(out);
+    out.append(", ");
+    appendNumber(out, damage);
+    out.append(" DMG");
+}
@@ -5,6 +5,16 @@
 class Weapon : public Item
 {
 public:
+    // Creates a weapon with default attributes.
+    Weapon();
+
+    // Copies or moves a weapon.  These keep the kind of the copy Weapon, which Item's own copy
+    // constructors don't.
+    Weapon(const Weapon& other);
+    Weapon& operator= (const Weapon& other);
+    Weapon(Weapon&& other) noexcept;
+    Weapon& operator= (Weapon&& other) noexcept;
+
     // Creates a new pointer to a copy of the weapon.
     // The pointer returned should be considered owned by the calling function.
     virtual Weapon* clone() const override;
@@ -18,10 +28,16 @@ public:
     // Sets the damage rating of the weapon.  It is theoretically possible for the damage to be zero or even negative.
     void setDamage(int damage);
 
+    // Appends the same text that operator<< prints to out, without stream formatting.
+    virtual void appendTo(std::string& out) const override;
+
 protected:
     // Protected helper function to support a polymorphic stream insertion operator.
     virtual void printToStream(std::ostream& out) const override;
 
+    // Adds the damage after the fields of Item.
+    virtual void addToFingerprint(Fingerprint& hash) const override;
+
 private:
     // The damage rating of the weapon.,
     int damage { 0 };
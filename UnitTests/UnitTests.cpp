@@ -6,11 +6,30 @@
 #include <locale>
 #include <crtdbg.h>
 #include <list>
+#include <cstdio>
+#include <fstream>
+#include <thread>
+#include <climits>
 #include "../RPGInventory/Collection.h"
 #include "../RPGInventory/Character.h"
 #include "../RPGInventory/Item.h"
 #include "../RPGInventory/Weapon.h"
 #include "../RPGInventory/Armor.h"
+#include "../RPGInventory/CharacterSerializer.h"
+#include "../RPGInventory/CharacterImage.h"
+#include "../RPGInventory/PersistentCharacter.h"
+#include "../RPGInventory/CharacterSnapshot.h"
+#include "../RPGInventory/CatalogImporter.h"
+#include "../RPGInventory/ColumnarExporter.h"
+#include "../RPGInventory/CommandProcessor.h"
+#include "../RPGInventory/CharacterServer.h"
+#include "../RPGInventory/CharacterFormatter.h"
+#include "../RPGInventory/BitmapIndex.h"
+#ifdef __linux__
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
 
 using namespace Microsoft::VisualStudio::CppUnitTestFramework;
 using namespace std;
@@ -42,6 +61,56 @@ wstring Microsoft::VisualStudio::CppUnitTestFramework::ToString<Armor>(const Arm
 
 namespace UnitTests
 {
+    // A class of item defined by a caller rather than the library, with a field and text of its own.
+    class Potion : public Item
+    {
+    public:
+        int potency{ 0 };
+
+        virtual Potion* clone() const override
+        {
+            return new Potion{ *this };
+        }
+
+        virtual void appendTo(std::string& out) const override
+        {
+            Item::appendTo(out);
+            out.append(", potency ").append(to_string(potency));
+        }
+
+    protected:
+        virtual void printToStream(std::ostream& out) const override
+        {
+            Item::printToStream(out);
+            out << ", potency " << potency;
+        }
+    };
+
+    // A caller's class derived from Weapon.
+    class EnchantedSword : public Weapon
+    {
+    public:
+        string enchantment;
+
+        virtual EnchantedSword* clone() const override
+        {
+            return new EnchantedSword{ *this };
+        }
+
+        virtual void appendTo(std::string& out) const override
+        {
+            Weapon::appendTo(out);
+            out.append(", ").append(enchantment);
+        }
+
+    protected:
+        virtual void printToStream(std::ostream& out) const override
+        {
+            Weapon::printToStream(out);
+            out << ", " << enchantment;
+        }
+    };
+
     // A subroutine to find an item in the inventory.
     // This is useful for making sure that references passed to Character functions are referencing 
     // the actual memory address of the item in the inventory, which is an allowable assumption.
@@ -82,6 +151,18 @@ namespace UnitTests
         }
     }
 
+#ifdef _DEBUG
+    // A convenience function that counts the heap blocks currently allocated (useful for checking that
+    // an operation makes no more allocations than it should).  Only the debug CRT keeps the counts, so
+    // this and the assertions that use it only exist in debug builds.
+    long liveAllocations()
+    {
+        _CrtMemState state;
+        _CrtMemCheckpoint(&state);
+        return static_cast<long>(state.lCounts[_NORMAL_BLOCK]);
+    }
+#endif
+
     // A convenience function that calls findItem() and then drops the item that was found.
     void findAndDrop(Character& character, const Item& item)
     {
@@ -213,7 +294,7 @@ namespace UnitTests
             // There should be nothing equipped, and the total weight and armor rating should be 0.
             Assert::AreEqual(0.0, character.getTotalWeight());
             Assert::IsNull(character.getEquippedWeapon());
-            Assert::AreEqual(0u, character.getTotalArmorRating());
+            Assert::AreEqual(0, character.getTotalArmorRating());
             for (int i = 0; i < 6; i++)
             {
                 Assert::IsNull(character.getEquippedArmor(i));
@@ -813,6 +894,74 @@ namespace UnitTests
             }
         }
 
+#ifndef RPG_INLINE_EQUIPMENT
+        TEST_METHOD(TestEquipUnequipKeepsSameObject)
+        {
+            Character character;
+            character.addItem(leatherArmor);
+            character.addItem(mapleBow);
+
+            // Remember where the inventory's own copies live.
+            const Armor* armorInInventory{ &findItem(character.getInventory(), leatherArmor) };
+            const Weapon* weaponInInventory{ &findItem(character.getInventory(), mapleBow) };
+
+            // Equipping should hand over the inventory's object rather than making a new copy.
+            findAndEquip(character, leatherArmor);
+            findAndEquip(character, mapleBow);
+            Assert::IsTrue(armorInInventory == character.getEquippedArmor(Armor::CHEST_SLOT));
+            Assert::IsTrue(weaponInInventory == character.getEquippedWeapon());
+
+            // Unequipping should hand the same object back to the inventory.
+            character.unequipArmor(Armor::CHEST_SLOT);
+            character.unequipWeapon();
+            Assert::IsTrue(armorInInventory == &findItem(character.getInventory(), leatherArmor));
+            Assert::IsTrue(weaponInInventory == &findItem(character.getInventory(), mapleBow));
+        }
+#endif
+
+        TEST_METHOD(TestInlineEquipment)
+        {
+            // Exercise the inline layout directly, whichever layout Character is built with.
+            InlineEquipment equipment;
+
+            // Precondition
+            Assert::IsNull(equipment.getArmor(Armor::CHEST_SLOT));
+            Assert::IsNull(equipment.getWeapon());
+            Assert::AreEqual(0.0, equipment.getTotalWeight());
+
+            // Equipping into empty slots replaces nothing.
+            Assert::IsFalse(equipment.equipArmor(makeItem<Armor>(leatherArmor)) != nullptr);
+            Assert::IsFalse(equipment.equipWeapon(makeItem<Weapon>(mapleBow)) != nullptr);
+            Assert::AreEqual(leatherArmor, *equipment.getArmor(Armor::CHEST_SLOT));
+            Assert::AreEqual(mapleBow, *equipment.getWeapon());
+            Assert::AreEqual(9.0, equipment.getTotalWeight());
+            Assert::AreEqual(10, equipment.getTotalArmorRating());
+            Assert::AreEqual(1u << Armor::CHEST_SLOT, equipment.getArmorMask());
+
+            // The equipped armor lives inside the equipment object itself.
+            const char* begin{ reinterpret_cast<const char*>(&equipment) };
+            const char* armor{ reinterpret_cast<const char*>(equipment.getArmor(Armor::CHEST_SLOT)) };
+            Assert::IsTrue(armor >= begin && armor < begin + sizeof(equipment));
+
+            // Equipping over a filled slot hands back the old piece.
+            ItemPtr<Armor> replaced{ equipment.equipArmor(makeItem<Armor>(ironBreastplate)) };
+            Assert::IsNotNull(replaced.get());
+            Assert::AreEqual(leatherArmor, *replaced);
+            Assert::AreEqual(ironBreastplate, *equipment.getArmor(Armor::CHEST_SLOT));
+            Assert::AreEqual(18.0, equipment.getTotalWeight());
+            Assert::AreEqual(12, equipment.getTotalArmorRating());
+
+            // Unequipping empties the slots and resets the totals.
+            Assert::AreEqual(ironBreastplate, *equipment.unequipArmor(Armor::CHEST_SLOT));
+            Assert::AreEqual(mapleBow, *equipment.unequipWeapon());
+            Assert::IsNull(equipment.getArmor(Armor::CHEST_SLOT));
+            Assert::IsNull(equipment.getWeapon());
+            Assert::IsFalse(equipment.unequipWeapon() != nullptr);
+            Assert::AreEqual(0.0, equipment.getTotalWeight());
+            Assert::AreEqual(0, equipment.getTotalArmorRating());
+            Assert::AreEqual(0u, equipment.getArmorMask());
+        }
+
         TEST_METHOD(TestGetEquippedArmorException1)
         {
             // Check what happens when an illegal slot ID is passed to getEquippedArmor()
@@ -832,7 +981,7 @@ namespace UnitTests
             Character character;
 
             // Check the initial armor rating (precondition)
-            Assert::AreEqual(0u, character.getTotalArmorRating());
+            Assert::AreEqual(0, character.getTotalArmorRating());
 
             for (unsigned int i = 0; i < Armor::SLOT_COUNT; i++)
             {
@@ -843,7 +992,7 @@ namespace UnitTests
                 Assert::IsNull(character.getEquippedArmor(i));
 
                 // Check the armor rating (shouldn't have changed)
-                Assert::AreEqual(10 * i, character.getTotalArmorRating());
+                Assert::AreEqual(static_cast<int>(10 * i), character.getTotalArmorRating());
 
                 // Equip the armor piece
                 findAndEquip(character, armorSet[i]);
@@ -851,10 +1000,50 @@ namespace UnitTests
                 Assert::AreEqual(armorSet[i], *character.getEquippedArmor(i));
 
                 // Armor rating should go up
-                Assert::AreEqual(10 * (i + 1), character.getTotalArmorRating());
+                Assert::AreEqual(static_cast<int>(10 * (i + 1)), character.getTotalArmorRating());
             }
         }
 
+        TEST_METHOD(TestNegativeArmorRatingAndSlotMask)
+        {
+            Character character;
+
+            // Precondition
+            Assert::AreEqual(0u, character.getEquippedArmorMask());
+
+            // A cursed piece of armor with a negative rating.
+            Armor cursedHelmet;
+            cursedHelmet.setName("Cursed Helmet");
+            cursedHelmet.setWeight(2.0);
+            cursedHelmet.setGoldValue(5);
+            cursedHelmet.setRating(-25);
+            cursedHelmet.setSlotID(Armor::HEAD_SLOT);
+
+            character.addItem(cursedHelmet);
+            character.addItem(leatherArmor);
+            findAndEquip(character, cursedHelmet);
+            findAndEquip(character, leatherArmor);
+
+            // The sum should go negative rather than wrap around.
+            Assert::AreEqual(-15, character.getTotalArmorRating());
+            Assert::AreEqual((1u << Armor::HEAD_SLOT) | (1u << Armor::CHEST_SLOT), character.getEquippedArmorMask());
+
+            // Swapping the chest piece updates the sum but not the mask.
+            character.addItem(ironBreastplate);
+            findAndEquip(character, ironBreastplate);
+            Assert::AreEqual(-13, character.getTotalArmorRating());
+            Assert::AreEqual((1u << Armor::HEAD_SLOT) | (1u << Armor::CHEST_SLOT), character.getEquippedArmorMask());
+
+            // Unequipping clears the slot's bit.
+            character.unequipArmor(Armor::HEAD_SLOT);
+            Assert::AreEqual(12, character.getTotalArmorRating());
+            Assert::AreEqual(1u << Armor::CHEST_SLOT, character.getEquippedArmorMask());
+
+            character.unequipArmor(Armor::CHEST_SLOT);
+            Assert::AreEqual(0, character.getTotalArmorRating());
+            Assert::AreEqual(0u, character.getEquippedArmorMask());
+        }
+
         TEST_METHOD(TestUnequipArmor)
         {
             Character character;
@@ -960,7 +1149,7 @@ namespace UnitTests
             // Check preconditions
             Assert::AreEqual(0u, character.getInventory().getSize());
             Assert::AreEqual(0.0, character.getTotalWeight());
-            Assert::AreEqual(0u, character.getTotalArmorRating());
+            Assert::AreEqual(0, character.getTotalArmorRating());
 
             // Add a complete set of armor.
             for (unsigned int i = 0; i < Armor::SLOT_COUNT; i++)
@@ -973,7 +1162,7 @@ namespace UnitTests
             Assert::AreEqual(6.0 * Armor::SLOT_COUNT, character.getTotalWeight());
 
             // Armor rating should not change
-            Assert::AreEqual(0u, character.getTotalArmorRating());
+            Assert::AreEqual(0, character.getTotalArmorRating());
 
             for (unsigned int i = 0; i < Armor::SLOT_COUNT; i++)
             {
@@ -984,7 +1173,7 @@ namespace UnitTests
                 Assert::AreEqual(armorSet[i], *character.getEquippedArmor(i));
 
                 // Check armor rating
-                Assert::AreEqual(10 * (i + 1), character.getTotalArmorRating());
+                Assert::AreEqual(static_cast<int>(10 * (i + 1)), character.getTotalArmorRating());
             }
 
             // Make sure that equipping doesn't change the total weight.
@@ -1006,7 +1195,7 @@ namespace UnitTests
             // Make sure that the previous exception case doesn't change the total weight or inventory size or total armor rating.
             Assert::AreEqual(6.0 * Armor::SLOT_COUNT, character.getTotalWeight());
             Assert::AreEqual(0u, character.getInventory().getSize());
-            Assert::AreEqual(10 * Armor::SLOT_COUNT, character.getTotalArmorRating());
+            Assert::AreEqual(static_cast<int>(10 * Armor::SLOT_COUNT), character.getTotalArmorRating());
 
             // Test unequipping a piece of armor.
             Assert::IsNotNull(character.getEquippedArmor(Armor::CHEST_SLOT));
@@ -1014,7 +1203,7 @@ namespace UnitTests
             Assert::IsNull(character.getEquippedArmor(Armor::CHEST_SLOT));
 
             // Check total armor rating
-            Assert::AreEqual(10 * (Armor::SLOT_COUNT - 1), character.getTotalArmorRating());
+            Assert::AreEqual(static_cast<int>(10 * (Armor::SLOT_COUNT - 1)), character.getTotalArmorRating());
 
             // Check total weight and inventory size (chest piece should now be in the inventory).
             Assert::AreEqual(6.0 * Armor::SLOT_COUNT, character.getTotalWeight());
@@ -1036,7 +1225,7 @@ namespace UnitTests
             Assert::IsNull(character.getEquippedArmor(Armor::CHEST_SLOT));
 
             // Check total armor rating.
-            Assert::AreEqual(10 * (Armor::SLOT_COUNT - 1), character.getTotalArmorRating());
+            Assert::AreEqual(static_cast<int>(10 * (Armor::SLOT_COUNT - 1)), character.getTotalArmorRating());
 
             // Total weight should have changed.
             Assert::AreEqual(6.0 * (Armor::SLOT_COUNT - 1), character.getTotalWeight());
@@ -1060,7 +1249,7 @@ namespace UnitTests
             // Check the weight and inventory size and total armor rating.
             Assert::AreEqual(6.0 * Armor::SLOT_COUNT, character.getTotalWeight());
             Assert::AreEqual(1u, character.getInventory().getSize());
-            Assert::AreEqual(10 * (Armor::SLOT_COUNT - 1), character.getTotalArmorRating());
+            Assert::AreEqual(static_cast<int>(10 * (Armor::SLOT_COUNT - 1)), character.getTotalArmorRating());
 
             // Check that the inventory contains the chest piece
             count = 0;
@@ -1099,7 +1288,7 @@ namespace UnitTests
                 Assert::AreEqual(Armor::SLOT_COUNT * 6.0, character.getTotalWeight());
 
                 // Total armor rating should not change.
-                Assert::AreEqual(10 * (Armor::SLOT_COUNT - 1), character.getTotalArmorRating());
+                Assert::AreEqual(static_cast<int>(10 * (Armor::SLOT_COUNT - 1)), character.getTotalArmorRating());
             }
         }
 
@@ -1190,7 +1379,7 @@ namespace UnitTests
             }
 
             // Check the armor rating.
-            Assert::AreEqual(60u, character.getTotalArmorRating());
+            Assert::AreEqual(60, character.getTotalArmorRating());
 
             // Check that the inventory is empty.
             Assert::AreEqual(0u, character.getInventory().getSize());
@@ -1227,7 +1416,7 @@ namespace UnitTests
             Assert::AreEqual(6.0 * Armor::SLOT_COUNT, character.getTotalWeight());
 
             // Check the armor rating
-            Assert::AreEqual(50u, character.getTotalArmorRating());
+            Assert::AreEqual(50, character.getTotalArmorRating());
 
             // Drop the helmet
             findAndDrop(character, armorSet[Armor::HEAD_SLOT]);
@@ -1247,7 +1436,7 @@ namespace UnitTests
             Assert::AreEqual(5.0 * Armor::SLOT_COUNT, character.getTotalWeight());
 
             // Check the armor rating
-            Assert::AreEqual(50u, character.getTotalArmorRating());
+            Assert::AreEqual(50, character.getTotalArmorRating());
         }
 
         TEST_METHOD(ZZZRunLast_TestEquipUnequipArmorMemoryLeak)
@@ -1728,7 +1917,7 @@ namespace UnitTests
             // Preconditions
             Assert::AreEqual(0.0, character.getTotalWeight());
             Assert::IsNull(character.getEquippedWeapon());
-            Assert::AreEqual(0u, character.getTotalArmorRating());
+            Assert::AreEqual(0, character.getTotalArmorRating());
             for (int i = 0; i < 6; i++)
             {
                 Assert::IsNull(character.getEquippedArmor(i));
@@ -1860,6 +2049,1557 @@ namespace UnitTests
             Assert::AreEqual(1u, count);
         }
 
+        TEST_METHOD(TestOptimizeInventoryAfterDrop)
+        {
+            Character character;
+            Item feather{};
+            feather.setName("Feather");
+            feather.setWeight(0.1);
+            feather.setGoldValue(100);
+            Item pebble{};
+            pebble.setName("Pebble");
+            pebble.setWeight(0.2);
+            pebble.setGoldValue(1);
+
+            // 0.1 + 0.2 - 0.1 in doubles is 0.20000000000000004; the total must still be exactly the pebble's weight.
+            character.addItem(feather);
+            character.addItem(pebble);
+            character.dropItem(feather);
+            Assert::AreEqual(0.2, character.getTotalWeight());
+
+            // So the pebble fits in a limit of its own weight.
+            character.optimizeInventory(0.2);
+            Assert::AreEqual(1u, character.getInventory().getSize());
+            Assert::AreEqual(size_t{ 0 }, character.setWeightCapacity(0.2).size());
+
+            // The same holds for equipped items.
+            Character equipped;
+            Armor cap{ leatherArmor };
+            cap.setWeight(0.1);
+            Armor boots{ ironBoots };
+            boots.setWeight(0.2);
+            equipped.addItem(cap);
+            equipped.addItem(boots);
+            findAndEquip(equipped, cap);
+            findAndEquip(equipped, boots);
+            equipped.unequipArmor(cap.getSlotID());
+            equipped.dropItem(cap);
+            Assert::AreEqual(0.2, equipped.getTotalWeight());
+        }
+
+        TEST_METHOD(TestWeightCapacityEviction)
+        {
+            Character character;
+
+            // Precondition
+            Assert::IsFalse(character.hasWeightCapacity());
+
+            // Enter capacity mode with nothing in the inventory; nothing should be evicted.
+            Assert::AreEqual(size_t{ 0 }, character.setWeightCapacity(30.0).size());
+            Assert::IsTrue(character.hasWeightCapacity());
+            Assert::AreEqual(30.0, character.getWeightCapacity());
+
+            // Still under the capacity after two adds.
+            Assert::AreEqual(size_t{ 0 }, character.addItem(ironBreastplate).size());
+            Assert::AreEqual(size_t{ 0 }, character.addItem(ironOre).size());
+            Assert::AreEqual(25.0, character.getTotalWeight());
+
+            // Going over the capacity should evict the iron ore (the lowest value to weight ratio).
+            vector<ItemPtr<Item>> evicted{ character.addItem(ironBreastplate) };
+            Assert::AreEqual(size_t{ 1 }, evicted.size());
+            Assert::AreEqual<Item>(ironOre, *evicted[0]);
+            Assert::AreEqual(30.0, character.getTotalWeight());
+            Assert::AreEqual(2u, character.getInventory().getSize());
+
+            // Lowering the capacity evicts immediately.
+            evicted = character.setWeightCapacity(20.0);
+            Assert::AreEqual(size_t{ 1 }, evicted.size());
+            Assert::AreEqual<Item>(ironBreastplate, *evicted[0]);
+            Assert::AreEqual(15.0, character.getTotalWeight());
+
+            // The newly added item is evicted itself if it is the worst one.
+            evicted = character.addItem(ironOre);
+            Assert::AreEqual(size_t{ 1 }, evicted.size());
+            Assert::AreEqual<Item>(ironOre, *evicted[0]);
+            Assert::AreEqual(15.0, character.getTotalWeight());
+        }
+
+        TEST_METHOD(TestWeightCapacityWithEquippedItem)
+        {
+            Character character;
+
+            // Equip a sword, then set a capacity below its weight.
+            character.addItem(ironSword);
+            findAndEquip(character, ironSword);
+            Assert::AreEqual(size_t{ 0 }, character.setWeightCapacity(5.0).size());
+
+            // Equipped items are never evicted.
+            Assert::AreEqual(ironSword, *character.getEquippedWeapon());
+            Assert::AreEqual(6.0, character.getTotalWeight());
+
+            // Anything non-weightless added to the inventory is evicted straight away.
+            vector<ItemPtr<Item>> evicted{ character.addItem(mapleBow) };
+            Assert::AreEqual(size_t{ 1 }, evicted.size());
+            Assert::AreEqual<Item>(mapleBow, *evicted[0]);
+            Assert::AreEqual(0u, character.getInventory().getSize());
+            Assert::AreEqual(ironSword, *character.getEquippedWeapon());
+
+            // Once capacity mode is off, adds no longer evict.
+            character.clearWeightCapacity();
+            Assert::IsFalse(character.hasWeightCapacity());
+            Assert::AreEqual(size_t{ 0 }, character.addItem(mapleBow).size());
+            Assert::AreEqual(9.0, character.getTotalWeight());
+        }
+
+        TEST_METHOD(TestWeightCapacityException)
+        {
+            Character character;
+            character.addItem(ironBreastplate);
+
+            // A negative capacity should throw and leave capacity mode off.
+            Assert::ExpectException<out_of_range>([&character, this]() { character.setWeightCapacity(-1); });
+            Assert::IsFalse(character.hasWeightCapacity());
+            Assert::AreEqual(15.0, character.getTotalWeight());
+        }
+
+        TEST_METHOD(TestBatchApply)
+        {
+            Character character;
+
+            // Record a scripted event.
+            Character::Batch batch;
+            batch.addItem(mapleBow)
+                .addItem(leatherArmor)
+                .addItem(healingPotion)
+                .equipArmor(leatherArmor)
+                .equipWeapon(mapleBow)
+                .dropItem(healingPotion)
+                .addItem(ironOre);
+            Assert::AreEqual(7u, batch.getSize());
+
+            // Nothing happens until the batch is applied.
+            Assert::AreEqual(0u, character.getInventory().getSize());
+            Assert::AreEqual(size_t{ 0 }, character.apply(batch).size());
+
+            // Check the result.
+            Assert::AreEqual(leatherArmor, *character.getEquippedArmor(Armor::CHEST_SLOT));
+            Assert::AreEqual(mapleBow, *character.getEquippedWeapon());
+            Assert::AreEqual(1u, character.getInventory().getSize());
+            findItem(character.getInventory(), ironOre);
+            Assert::AreEqual(19.0, character.getTotalWeight());
+            Assert::AreEqual(10, character.getTotalArmorRating());
+        }
+
+        TEST_METHOD(TestBatchRollback)
+        {
+            Character character;
+
+            // Copper ore has the same value to weight ratio as iron ore, so their relative order matters.
+            Item copperOre;
+            copperOre.setName("Copper Ore");
+            copperOre.setWeight(5.0);
+            copperOre.setGoldValue(10);
+
+            character.addItem(ironOre);
+            character.addItem(copperOre);
+            character.addItem(ironOre);
+            character.addItem(mapleBow);
+            character.addItem(leatherArmor);
+            findAndEquip(character, mapleBow);
+
+            // Remember exactly which objects are in the inventory, in order.
+            vector<const Item*> before;
+            character.getInventory().forEach([&before](const Item& item) { before.push_back(&item); });
+            const Weapon* weaponBefore{ character.getEquippedWeapon() };
+            const double weightBefore{ character.getTotalWeight() };
+
+            // The last operation fails, since there is no necklace to drop.
+            Character::Batch batch;
+            batch.dropItem(ironOre)
+                .addItem(copperOre)
+                .equipArmor(leatherArmor)
+                .unequipWeapon()
+                .optimizeInventory(0)
+                .dropItem(shinyNecklace);
+            Assert::ExpectException<logic_error>([&character, &batch]() { character.apply(batch); });
+
+            // Everything should be exactly as it was, down to the order of equal ratios.
+            vector<const Item*> after;
+            character.getInventory().forEach([&after](const Item& item) { after.push_back(&item); });
+            Assert::IsTrue(before == after);
+            Assert::IsTrue(weaponBefore == character.getEquippedWeapon());
+            Assert::IsNull(character.getEquippedArmor(Armor::CHEST_SLOT));
+            Assert::AreEqual(0, character.getTotalArmorRating());
+            Assert::AreEqual(weightBefore, character.getTotalWeight());
+
+            // An out_of_range is rolled back too.
+            batch = Character::Batch{};
+            batch.dropItem(copperOre).unequipArmor(Armor::SLOT_COUNT);
+            Assert::ExpectException<out_of_range>([&character, &batch]() { character.apply(batch); });
+            Assert::AreEqual(static_cast<unsigned int>(before.size()), character.getInventory().getSize());
+        }
+
+        TEST_METHOD(TestBatchIndexes)
+        {
+            Character character;
+            character.addItem(ironOre);
+            character.addItem(mapleBow);
+
+            // Build every secondary index, so the batch has indexes to defer and rebuild.
+            const Inventory& inventory{ character.getInventory() };
+            auto check{ [&inventory](unsigned int bows, unsigned int swords)
+                {
+                    Assert::AreEqual(size_t{ bows }, inventory.searchByName("Maple Bow", NameSearch::Exact).size());
+                    Assert::AreEqual(size_t{ swords }, inventory.query(ItemQuery{}.withDamage(10, 10)).size() - bows);
+                    const auto byWeight{ inventory.getItemsByWeight(6.0, 6.0) };
+                    Assert::AreEqual(ptrdiff_t{ swords }, distance(byWeight.begin(), byWeight.end()));
+                    Assert::AreEqual(swords > 0, inventory.findItem(ItemKey{ "Iron Sword", 50, 6.0, 10 }) != nullptr);
+                } };
+            check(1, 0);
+
+            // A run of adds and a drop are applied, and every index sees them.
+            Character::Batch batch;
+            batch.addItem(ironSword).addItem(healingPotion).addItem(ironSword).dropItem(mapleBow);
+            character.apply(batch);
+            check(0, 2);
+            Assert::AreEqual(4u, inventory.getSize());
+
+            // A batch that fails leaves the indexes matching the restored inventory.
+            batch = Character::Batch{};
+            batch.addItem(mapleBow).dropItem(ironSword).dropItem(ironSword).dropItem(ironSword);
+            Assert::ExpectException<logic_error>([&character, &batch]() { character.apply(batch); });
+            check(0, 2);
+            Assert::AreEqual(4u, inventory.getSize());
+        }
+
+        TEST_METHOD(TestBatchWeightCapacity)
+        {
+            Character character;
+            character.setWeightCapacity(20.0);
+
+            // Going over the capacity part way through the batch doesn't evict anything by itself.
+            Character::Batch batch;
+            batch.addItem(ironBreastplate)
+                .addItem(ironBreastplate)
+                .addItem(ironOre)
+                .dropItem(ironBreastplate);
+
+            // Only the final total counts: 25 lbs, so the iron ore goes.
+            vector<ItemPtr<Item>> evicted{ character.apply(batch) };
+            Assert::AreEqual(size_t{ 1 }, evicted.size());
+            Assert::AreEqual<Item>(ironOre, *evicted[0]);
+            Assert::AreEqual(15.0, character.getTotalWeight());
+            findItem(character.getInventory(), ironBreastplate);
+        }
+
+        TEST_METHOD(TestSaveAndLoad)
+        {
+            Character character;
+            character.addItem(mapleBow);
+            character.addItem(healingPotion);
+            character.addItem(shinyNecklace);
+            character.addItem(ironOre);
+            character.addItem(ironOre);
+            character.addItem(ironBoots);
+            character.addItem(leatherArmor);
+            character.addItem(ironSword);
+            findAndEquip(character, leatherArmor);
+            findAndEquip(character, ironSword);
+
+            // Save the character.
+            stringstream stream;
+            CharacterSerializer::save(character, stream);
+
+            // Load it into a character that already has something in it; the old contents should be replaced.
+            Character loaded;
+            loaded.addItem(legendaryBattleaxe);
+            loaded.addItem(woodenShield);
+            findAndEquip(loaded, woodenShield);
+            CharacterSerializer::load(loaded, stream);
+
+            // The inventory should match, in the same order.
+            vector<const Item*> expected;
+            character.getInventory().forEach([&expected](const Item& item) { expected.push_back(&item); });
+            Assert::AreEqual(character.getInventory().getSize(), loaded.getInventory().getSize());
+            unsigned int i{ 0 };
+            loaded.getInventory().forEach([&expected, &i](const Item& item)
+            {
+                Assert::AreEqual(*expected[i], item);
+                i++;
+            });
+
+            // So should the equipment and totals.
+            Assert::AreEqual(leatherArmor, *loaded.getEquippedArmor(Armor::CHEST_SLOT));
+            Assert::IsNull(loaded.getEquippedArmor(Armor::SHIELD_SLOT));
+            Assert::AreEqual(ironSword, *loaded.getEquippedWeapon());
+            Assert::AreEqual(character.getTotalWeight(), loaded.getTotalWeight());
+            Assert::AreEqual(character.getTotalArmorRating(), loaded.getTotalArmorRating());
+        }
+
+        TEST_METHOD(TestSaveDeduplicatesNames)
+        {
+            // Saving many copies of an item should only store its name once.
+            Character one;
+            one.addItem(ironOre);
+            stringstream oneStream;
+            CharacterSerializer::save(one, oneStream);
+
+            Character many;
+            for (unsigned int i{ 0 }; i < 100; i++)
+            {
+                many.addItem(ironOre);
+            }
+            stringstream manyStream;
+            CharacterSerializer::save(many, manyStream);
+
+            // Each extra copy costs a kind, a name index, a gold value and a weight: 1 + 1 + 1 + 8 bytes.
+            Assert::AreEqual(oneStream.str().size() + 99 * 11, manyStream.str().size());
+        }
+
+        TEST_METHOD(TestLoadCorruptData)
+        {
+            Character character;
+            character.addItem(mapleBow);
+            character.addItem(leatherArmor);
+            stringstream stream;
+            CharacterSerializer::save(character, stream);
+            const string saved{ stream.str() };
+
+            Character loaded;
+            loaded.addItem(ironOre);
+
+            // Not a saved character at all.
+            stringstream garbage{ "definitely not a character" };
+            Assert::ExpectException<runtime_error>([&loaded, &garbage]() { CharacterSerializer::load(loaded, garbage); });
+
+            // Cut short.
+            stringstream truncated{ saved.substr(0, saved.size() - 3) };
+            Assert::ExpectException<runtime_error>([&loaded, &truncated]() { CharacterSerializer::load(loaded, truncated); });
+
+            // The character should be untouched by the failed loads.
+            Assert::AreEqual(1u, loaded.getInventory().getSize());
+            findItem(loaded.getInventory(), ironOre);
+        }
+
+        TEST_METHOD(TestCharacterImage)
+        {
+            Character character;
+            character.addItem(mapleBow);
+            character.addItem(healingPotion);
+            character.addItem(ironOre);
+            character.addItem(ironOre);
+            character.addItem(leatherArmor);
+            character.addItem(ironSword);
+            findAndEquip(character, leatherArmor);
+            findAndEquip(character, ironSword);
+            CharacterImage::write(character, "TestCharacterImage.rpgi");
+
+            {
+                CharacterImage image{ "TestCharacterImage.rpgi" };
+
+                // The totals come straight from the header.
+                Assert::AreEqual(4u, image.getInventorySize());
+                Assert::AreEqual(6u, image.getRowCount());
+                Assert::AreEqual(character.getTotalWeight(), image.getTotalWeight());
+                Assert::AreEqual(character.getTotalArmorRating(), image.getTotalArmorRating());
+
+                // The inventory rows should be in the inventory's order.
+                unsigned int row{ 0 };
+                character.getInventory().forEach([&image, &row](const Item& item)
+                {
+                    Assert::IsTrue(item.getName() == image.getName(row));
+                    Assert::AreEqual(item.getGoldValue(), image.getGoldValue(row));
+                    Assert::AreEqual(item.getWeight(), image.getWeight(row));
+                    row++;
+                });
+
+                // The equipped items follow the inventory.
+                const unsigned int chestRow{ image.getEquippedArmorRow(Armor::CHEST_SLOT) };
+                Assert::IsTrue(chestRow >= image.getInventorySize());
+                Assert::IsTrue(image.getKind(chestRow) == ItemKind::Armor);
+                Assert::AreEqual(leatherArmor.getRating(), image.getRating(chestRow));
+                Assert::IsTrue(image.getEquippedArmorRow(Armor::SHIELD_SLOT) == CharacterImage::NO_ROW);
+                Assert::AreEqual(ironSword.getDamage(), image.getDamage(image.getEquippedWeaponRow()));
+                Assert::ExpectException<out_of_range>([&image]() { image.getEquippedArmorRow(6); });
+
+                // Materializing should give back the same character.
+                Character loaded;
+                loaded.addItem(woodenShield);
+                image.materialize(loaded);
+                Assert::AreEqual(4u, loaded.getInventory().getSize());
+                Assert::AreEqual(leatherArmor, *loaded.getEquippedArmor(Armor::CHEST_SLOT));
+                Assert::AreEqual(ironSword, *loaded.getEquippedWeapon());
+                Assert::AreEqual(character.getTotalWeight(), loaded.getTotalWeight());
+            }
+
+            // A file that isn't an image should be rejected.
+            {
+                ofstream out{ "TestCharacterImage.rpgi", ios::binary | ios::trunc };
+                out << string(200, 'x');
+            }
+            Assert::ExpectException<runtime_error>([]() { CharacterImage image{ "TestCharacterImage.rpgi" }; });
+            remove("TestCharacterImage.rpgi");
+            Assert::ExpectException<runtime_error>([]() { CharacterImage image{ "TestCharacterImage.rpgi" }; });
+        }
+
+        TEST_METHOD(TestMappedCharacter)
+        {
+            Character character;
+            character.addItem(ironBoots);
+            character.addItem(shinyNecklace);
+            findAndEquip(character, ironBoots);
+            CharacterImage::write(character, "TestMappedCharacter.rpgi");
+
+            MappedCharacter mapped{ "TestMappedCharacter.rpgi" };
+
+            // Reads come from the image until the first edit.
+            Assert::IsFalse(mapped.isMaterialized());
+            Assert::AreEqual(1u, mapped.getInventorySize());
+            Assert::AreEqual(character.getTotalWeight(), mapped.getTotalWeight());
+            Assert::AreEqual(character.getTotalArmorRating(), mapped.getTotalArmorRating());
+            Assert::AreEqual(1u, mapped.getImage().getInventorySize());
+            vector<string> names;
+            mapped.getInventory().forEach([&names](const Item& item) { names.push_back(item.getName()); });
+            Assert::AreEqual(size_t{ 1 }, names.size());
+            Assert::AreEqual(shinyNecklace.getName(), names[0]);
+
+            Character other;
+            other.addItem(mapleBow);
+            other.addItem(ironOre);
+            other.addItem(leatherArmor);
+#ifndef _WIN32
+            // Writing the file again replaces it whole, so the mapped image still reads the old one.
+            // Windows can't replace a file that is mapped, so this only runs elsewhere.
+            CharacterImage::write(other, "TestMappedCharacter.rpgi");
+            Assert::AreEqual(1u, mapped.getInventory().getSize());
+            Assert::AreEqual(character.getTotalWeight(), mapped.getTotalWeight());
+#endif
+
+            // The view decodes each kind of item into an equal item.
+            {
+                CharacterImage::write(other, "TestMappedOther.rpgi");
+                MappedCharacter replaced{ "TestMappedOther.rpgi" };
+                vector<unique_ptr<Item>> expected;
+                other.getInventory().forEach([&expected](const Item& item) { expected.emplace_back(item.clone()); });
+                size_t row{ 0 };
+                replaced.getInventory().forEach([&expected, &row](const Item& item)
+                    {
+                        Assert::IsTrue(*expected[row++] == item);
+                    });
+                Assert::AreEqual(expected.size(), row);
+            }
+            remove("TestMappedOther.rpgi");
+
+            // Editing builds the real character and releases the image.
+            mapped.edit().unequipArmor(Armor::FEET_SLOT);
+            Assert::IsTrue(mapped.isMaterialized());
+            Assert::AreEqual(2u, mapped.getInventorySize());
+            Assert::AreEqual(2u, mapped.getInventory().getSize());
+            Assert::AreEqual(0, mapped.getTotalArmorRating());
+            Assert::AreEqual(character.getTotalWeight(), mapped.getTotalWeight());
+            Assert::ExpectException<logic_error>([&mapped]() { mapped.getImage(); });
+            remove("TestMappedCharacter.rpgi");
+        }
+
+        TEST_METHOD(TestPersistentCharacterRecovery)
+        {
+            remove("TestPersistentCharacter.log");
+            remove("TestPersistentCharacter.snapshot");
+
+            {
+                // A long commit interval, so records wait for sync() or the destructor.
+                PersistentCharacter character{ "TestPersistentCharacter", chrono::hours{ 1 } };
+                character.addItem(mapleBow);
+                character.addItem(leatherArmor);
+                character.addItem(ironOre);
+                character.equipArmor(leatherArmor);
+                Assert::AreEqual(4u, character.getPendingRecordCount());
+                character.sync();
+                Assert::AreEqual(0u, character.getPendingRecordCount());
+
+                // A failed call isn't logged.
+                Assert::ExpectException<logic_error>([&character, this]() { character.dropItem(healingPotion); });
+                character.dropItem(ironOre);
+                Assert::AreEqual(5u, character.getLogRecordCount());
+            }
+
+            // Simulate a crash in the middle of writing a record.
+            {
+                ofstream out{ "TestPersistentCharacter.log", ios::binary | ios::app };
+                out << '\x09' << "torn";
+            }
+
+            {
+                PersistentCharacter character{ "TestPersistentCharacter", chrono::milliseconds{ 0 } };
+                Assert::AreEqual(5u, character.getLogRecordCount());
+                Assert::AreEqual(1u, character.getCharacter().getInventory().getSize());
+                findItem(character.getCharacter().getInventory(), mapleBow);
+                Assert::AreEqual(leatherArmor, *character.getCharacter().getEquippedArmor(Armor::CHEST_SLOT));
+
+                // The torn record is cut off, so new records can follow the committed ones.
+                character.addItem(ironSword);
+                character.equipWeapon(ironSword);
+                Assert::AreEqual(0u, character.getPendingRecordCount());
+            }
+
+            {
+                PersistentCharacter character{ "TestPersistentCharacter", chrono::milliseconds{ 0 } };
+                Assert::AreEqual(ironSword, *character.getCharacter().getEquippedWeapon());
+                Assert::AreEqual(15.0, character.getCharacter().getTotalWeight());
+            }
+
+            remove("TestPersistentCharacter.log");
+        }
+
+        TEST_METHOD(TestPersistentCharacterFlushThread)
+        {
+            remove("TestPersistentFlush.log");
+            remove("TestPersistentFlush.snapshot");
+
+            {
+                // No mutation follows, so the flush thread has to commit the group.
+                PersistentCharacter character{ "TestPersistentFlush", chrono::milliseconds{ 20 } };
+                character.addItem(mapleBow);
+                character.addItem(ironOre);
+                for (int i{ 0 }; i < 200 && character.getPendingRecordCount() != 0; i++)
+                {
+                    this_thread::sleep_for(chrono::milliseconds{ 10 });
+                }
+                Assert::AreEqual(0u, character.getPendingRecordCount());
+                ifstream log{ "TestPersistentFlush.log", ios::binary | ios::ate };
+                Assert::IsTrue(log.tellg() > 0);
+            }
+
+            {
+                PersistentCharacter character{ "TestPersistentFlush", chrono::milliseconds{ 0 } };
+                Assert::AreEqual(2u, character.getLogRecordCount());
+                Assert::AreEqual(2u, character.getCharacter().getInventory().getSize());
+            }
+
+            remove("TestPersistentFlush.log");
+        }
+
+        TEST_METHOD(TestPersistentCharacterSnapshot)
+        {
+            remove("TestPersistentSnapshot.log");
+            remove("TestPersistentSnapshot.snapshot");
+
+            {
+                // Snapshot every three records.
+                PersistentCharacter character{ "TestPersistentSnapshot", chrono::milliseconds{ 0 }, 3 };
+                character.addItem(mapleBow);
+                character.addItem(healingPotion);
+                Assert::AreEqual(2u, character.getLogRecordCount());
+                character.addItem(shinyNecklace);
+                Assert::AreEqual(0u, character.getLogRecordCount());
+                character.optimizeInventory(4.0);
+                character.optimizeEquipment();
+                Assert::AreEqual(2u, character.getLogRecordCount());
+            }
+
+            {
+                // Recovery loads the snapshot and replays the two records after it.
+                PersistentCharacter character{ "TestPersistentSnapshot", chrono::milliseconds{ 0 } };
+                Assert::AreEqual(2u, character.getLogRecordCount());
+                Assert::AreEqual(2u, character.getCharacter().getInventory().getSize());
+                Assert::AreEqual(mapleBow, *character.getCharacter().getEquippedWeapon());
+                character.snapshot();
+                Assert::AreEqual(0u, character.getLogRecordCount());
+            }
+
+            {
+                PersistentCharacter character{ "TestPersistentSnapshot", chrono::milliseconds{ 0 } };
+                Assert::AreEqual(0u, character.getLogRecordCount());
+                Assert::AreEqual(mapleBow, *character.getCharacter().getEquippedWeapon());
+            }
+
+            remove("TestPersistentSnapshot.log");
+            remove("TestPersistentSnapshot.snapshot");
+        }
+
+        TEST_METHOD(TestAsyncSnapshot)
+        {
+            Character character;
+            character.addItem(mapleBow);
+            character.addItem(healingPotion);
+            character.addItem(leatherArmor);
+            findAndEquip(character, leatherArmor);
+            const double weightAtSnapshot{ character.getTotalWeight() };
+
+            AsyncSnapshotter snapshotter;
+            snapshotter.start(character, "TestAsyncSnapshot.rpgc");
+            Assert::IsTrue(snapshotter.isPending());
+            Assert::ExpectException<logic_error>([&snapshotter, &character]() { snapshotter.start(character, "TestAsyncSnapshot.rpgc"); });
+
+            // Keep changing the character while the snapshot is written.
+            character.addItem(ironOre);
+            findAndDrop(character, mapleBow);
+            character.unequipArmor(Armor::CHEST_SLOT);
+
+            SnapshotStatistics statistics{ snapshotter.wait() };
+            Assert::IsFalse(snapshotter.isPending());
+            Assert::IsTrue(statistics.bytesWritten > 0);
+            Assert::IsTrue(statistics.latency >= statistics.captureTime);
+            Assert::ExpectException<logic_error>([&snapshotter]() { snapshotter.wait(); });
+
+            // The file should hold the character as it was when the snapshot started.
+            Character loaded;
+            {
+                ifstream in{ "TestAsyncSnapshot.rpgc", ios::binary };
+                CharacterSerializer::load(loaded, in);
+            }
+            Assert::AreEqual(2u, loaded.getInventory().getSize());
+            findItem(loaded.getInventory(), mapleBow);
+            Assert::AreEqual(leatherArmor, *loaded.getEquippedArmor(Armor::CHEST_SLOT));
+            Assert::AreEqual(weightAtSnapshot, loaded.getTotalWeight());
+            remove("TestAsyncSnapshot.rpgc");
+        }
+
+        TEST_METHOD(TestImportCsvCatalog)
+        {
+            stringstream catalog{
+                "kind,name,gold,weight,extra1,extra2\n"
+                "weapon,Maple Bow,50,3.0,10\n"
+                "item, Healing Potion , 36, 0.5\r\n"
+                "\n"
+                "# Armor\n"
+                "armor,Leather Armor,61,6,0,10\n"
+                "item,\"Ore, \"\"Iron\"\"\",20,10\n"
+                "armor,Bad Slot,10,1,6,3\n"
+                "weapon,No Damage,10,1\n"
+                "item,Heavy Thing,lots,1\n"
+                "weapon,Iron Sword,50,6,10" };
+
+            CatalogImport import{ CatalogImporter::read(catalog, CatalogFormat::Csv) };
+            Assert::AreEqual(size_t{ 11 }, import.lineCount);
+            Assert::AreEqual(size_t{ 5 }, import.items.size());
+            Assert::AreEqual(mapleBow, static_cast<Weapon&>(*import.items[0]));
+            Assert::AreEqual(healingPotion, *import.items[1]);
+            Assert::AreEqual(leatherArmor, static_cast<Armor&>(*import.items[2]));
+            Assert::IsTrue(import.items[3]->getName() == "Ore, \"Iron\"");
+            Assert::AreEqual(ironSword, static_cast<Weapon&>(*import.items[4]));
+
+            // Each bad line is reported with its line number.
+            Assert::AreEqual(size_t{ 3 }, import.errors.size());
+            Assert::AreEqual(size_t{ 8 }, import.errors[0].line);
+            Assert::IsTrue(import.errors[0].message == "Invalid slot ID: 6");
+            Assert::AreEqual(size_t{ 9 }, import.errors[1].line);
+            Assert::AreEqual(size_t{ 10 }, import.errors[2].line);
+
+            // The items go into the inventory in one bulk insert.  The objects themselves are stored, and
+            // the importer gives up ownership of them, so nothing else can change a stored item.
+            const Item* bow{ import.items[0].get() };
+            Character character;
+            character.addItems(move(import.items));
+            Assert::AreEqual(5u, character.getInventory().getSize());
+            Assert::AreEqual(25.5, character.getTotalWeight());
+            bool stored{ false };
+            character.getInventory().forEach([bow, &stored](const Item& item) { stored = stored || &item == bow; });
+            Assert::IsTrue(stored);
+        }
+
+        TEST_METHOD(TestImportJsonLinesCatalog)
+        {
+            stringstream catalog{
+                "{\"kind\": \"armor\", \"name\": \"Iron Boots\", \"gold\": 25, \"weight\": 3.0, \"slot\": 3, \"rating\": 10}\n"
+                "{\"id\": 7, \"weight\": 0.5, \"gold\": 120, \"name\": \"Shiny \\u0022Necklace\\u0022\", \"kind\": \"item\"}\n"
+                "{\"kind\": \"weapon\", \"name\": \"Broken\", \"gold\": 1, \"weight\": 1}\n"
+                "{\"kind\": \"item\", \"name\": \"Cut off\", \"gold\": 1\n"
+                "{\"kind\": \"armor\", \"name\": \"Bad\", \"gold\": 1, \"weight\": 1, \"slot\": -1, \"rating\": 1}\n" };
+
+            CatalogImport import{ CatalogImporter::read(catalog, CatalogFormat::JsonLines) };
+            Assert::AreEqual(size_t{ 5 }, import.lineCount);
+            Assert::AreEqual(size_t{ 2 }, import.items.size());
+            Assert::AreEqual(ironBoots, static_cast<Armor&>(*import.items[0]));
+            Assert::IsTrue(import.items[1]->getName() == "Shiny \"Necklace\"");
+            Assert::AreEqual(120u, import.items[1]->getGoldValue());
+
+            Assert::AreEqual(size_t{ 3 }, import.errors.size());
+            Assert::AreEqual(size_t{ 3 }, import.errors[0].line);
+            Assert::IsTrue(import.errors[0].message == "missing damage");
+            Assert::AreEqual(size_t{ 4 }, import.errors[1].line);
+            Assert::AreEqual(size_t{ 5 }, import.errors[2].line);
+
+            Assert::IsTrue(CatalogImporter::formatOf("items.csv") == CatalogFormat::Csv);
+            Assert::IsTrue(CatalogImporter::formatOf("items.jsonl") == CatalogFormat::JsonLines);
+            Assert::ExpectException<runtime_error>([]() { CatalogImporter::formatOf("items.txt"); });
+        }
+
+        TEST_METHOD(TestColumnarExport)
+        {
+            Character first;
+            first.addItem(mapleBow);
+            first.addItem(ironOre);
+            first.addItem(leatherArmor);
+            findAndEquip(first, leatherArmor);
+
+            Character second;
+            second.addItem(ironOre);
+            second.addItem(ironSword);
+            findAndEquip(second, ironSword);
+
+            stringstream stream;
+            ColumnarExporter exporter{ stream };
+            Assert::AreEqual(0u, exporter.addCharacter(first));
+            Assert::AreEqual(1u, exporter.addCharacter(second));
+            Assert::AreEqual(uint64_t{ 5 }, exporter.getRowCount());
+            exporter.finish();
+            Assert::ExpectException<logic_error>([&exporter]() { exporter.finish(); });
+            Assert::ExpectException<logic_error>([&exporter, &first]() { exporter.addCharacter(first); });
+
+            ColumnarTable table{ ColumnarExporter::read(stream) };
+            Assert::AreEqual(size_t{ 5 }, table.kinds.size());
+
+            // Each character's inventory comes first, then its equipped items.
+            const vector<uint32_t> characterIDs{ 0, 0, 0, 1, 1 };
+            const vector<uint8_t> equipped{ 0, 0, 1, 0, 1 };
+            for (size_t row{ 0 }; row < 5; row++)
+            {
+                Assert::AreEqual(characterIDs[row], table.characterIDs[row]);
+                Assert::AreEqual(equipped[row], table.equipped[row]);
+            }
+            Assert::IsTrue(table.kinds[0] == ItemKind::Weapon);
+            Assert::AreEqual(mapleBow.getDamage(), table.damages[0]);
+            Assert::IsTrue(table.names[table.nameIDs[1]] == "Iron Ore");
+            Assert::IsTrue(table.kinds[2] == ItemKind::Armor);
+            Assert::AreEqual(leatherArmor.getRating(), table.ratings[2]);
+            Assert::AreEqual(uint8_t{ 0 }, table.slots[2]);
+            Assert::AreEqual(leatherArmor.getWeight(), table.weights[2]);
+            Assert::AreEqual(ironSword.getGoldValue(), table.goldValues[4]);
+
+            // Names are stored once.
+            Assert::AreEqual(size_t{ 4 }, table.names.size());
+            Assert::AreEqual(table.nameIDs[1], table.nameIDs[3]);
+
+            // A stream that fails makes the export fail instead of leaving it truncated.
+            stringstream failing;
+            ColumnarExporter failed{ failing };
+            failed.addCharacter(first);
+            failing.setstate(ios::badbit);
+            Assert::ExpectException<runtime_error>([&failed]() { failed.finish(); });
+        }
+
+        TEST_METHOD(TestCommandProcessor)
+        {
+            Character character;
+            CommandProcessor processor{ character };
+            string output;
+
+            // Blank lines and comments aren't commands.
+            Assert::IsFalse(processor.execute("", output));
+            Assert::IsFalse(processor.execute("   # a comment", output));
+
+            Assert::IsTrue(processor.execute("add-weapon \"Maple Bow\" 50 3.0 10", output));
+            Assert::IsTrue(processor.execute("add-armor \"Leather Armor\" 61 6 0 10", output));
+            Assert::IsTrue(processor.execute("add-item \"Iron Ore\" 20 10.0", output));
+            Assert::IsTrue(processor.execute("add-item \"The \\\"Best\\\" Ore\" 20 10", output));
+            Assert::AreEqual(4u, character.getInventory().getSize());
+
+            Assert::IsTrue(processor.execute("equip-armor \"Leather Armor\" 61 6 0 10", output));
+            Assert::AreEqual(leatherArmor, *character.getEquippedArmor(Armor::CHEST_SLOT));
+            Assert::IsTrue(processor.execute("drop-item \"The \\\"Best\\\" Ore\" 20 10", output));
+            Assert::IsTrue(processor.execute("optimize-equipment", output));
+            Assert::AreEqual(mapleBow, *character.getEquippedWeapon());
+            Assert::IsTrue(processor.execute("optimize-inventory 10", output));
+            Assert::AreEqual(0u, character.getInventory().getSize());
+            Assert::IsTrue(output.empty());
+
+            // Only print writes anything.
+            Assert::IsTrue(processor.execute("print", output));
+            stringstream expected;
+            expected << character;
+            Assert::IsTrue(output == expected.str());
+
+            // Malformed commands throw runtime_error; the character's own exceptions pass through.
+            Assert::ExpectException<runtime_error>([&processor, &output]() { processor.execute("fly-away", output); });
+            Assert::ExpectException<runtime_error>([&processor, &output]() { processor.execute("add-item \"Rock\" 1", output); });
+            Assert::ExpectException<runtime_error>([&processor, &output]() { processor.execute("add-item \"Rock\" -1 1", output); });
+            Assert::ExpectException<runtime_error>([&processor, &output]() { processor.execute("add-item \"Rock 1 1", output); });
+            Assert::ExpectException<out_of_range>([&processor, &output]() { processor.execute("add-armor \"Hat\" 1 1 6 1", output); });
+            Assert::ExpectException<logic_error>([&processor, &output]() { processor.execute("drop-item \"Rock\" 1 1", output); });
+        }
+
+        TEST_METHOD(TestInventoryPages)
+        {
+            Inventory inventory;
+            for (unsigned int i{ 0 }; i < 500; i++)
+            {
+                // Plenty of equal ratios, so ties have to keep their insertion order.
+                Item item;
+                item.setName("Item " + to_string(i));
+                item.setGoldValue(i % 37);
+                item.setWeight(1.0 + i % 5);
+                inventory.addItem(item);
+                if (i % 3 == 0)
+                {
+                    inventory.dropItem(item);
+                }
+            }
+
+            vector<const Item*> order;
+            inventory.forEach([&order](const Item& item) { order.push_back(&item); });
+
+            // Every page matches the same stretch of forEach, and ranks find the same positions.
+            for (unsigned int offset{ 0 }; offset < order.size() + 50; offset += 50)
+            {
+                const vector<ItemPtr<const Item>> page{ inventory.getInventoryPage(offset, 50) };
+                Assert::IsTrue(page.size() == (offset < order.size() ? min<size_t>(50, order.size() - offset) : 0));
+                for (size_t i{ 0 }; i < page.size(); i++)
+                {
+                    Assert::IsTrue(page[i].get() == order[offset + i]);
+                    Assert::AreEqual(static_cast<unsigned int>(offset + i), inventory.rankOf(*page[i]));
+                }
+            }
+            Assert::AreEqual(inventory.getSize() - 1, inventory.rankOf(*order.back()));
+
+            Item missing;
+            missing.setName("Item 0");
+            Assert::ExpectException<logic_error>([&inventory, &missing]() { inventory.rankOf(missing); });
+        }
+
+        TEST_METHOD(TestInventoryRangeQueries)
+        {
+            Inventory inventory;
+            for (unsigned int i{ 0 }; i < 300; i++)
+            {
+                Item item;
+                item.setName("Item " + to_string(i));
+                item.setGoldValue(i % 41);
+                item.setWeight(0.5 + i % 23);
+                inventory.addItem(item);
+            }
+
+            // Each view holds exactly the items a filtered forEach finds, in the order promised.
+            auto check{ [&inventory]()
+                {
+                    vector<const Item*> expected;
+                    vector<const Item*> found;
+                    inventory.forEach([&expected](const Item& item)
+                        {
+                            if (item.getWeight() >= 5.5 && item.getWeight() <= 12.5)
+                            {
+                                expected.push_back(&item);
+                            }
+                        });
+                    double previous{ 0.0 };
+                    for (const Item& item : inventory.getItemsByWeight(5.5, 12.5))
+                    {
+                        Assert::IsTrue(item.getWeight() >= previous);
+                        previous = item.getWeight();
+                        found.push_back(&item);
+                    }
+                    sort(expected.begin(), expected.end());
+                    sort(found.begin(), found.end());
+                    Assert::IsTrue(found == expected);
+
+                    size_t cheap{ 0 };
+                    inventory.forEach([&cheap](const Item& item) { cheap += item.getGoldValue() <= 10 ? 1 : 0; });
+                    size_t viewed{ 0 };
+                    for (const Item& item : inventory.getItemsByGoldValue(0, 10))
+                    {
+                        Assert::IsTrue(item.getGoldValue() <= 10);
+                        viewed++;
+                    }
+                    Assert::IsTrue(viewed == cheap);
+
+                    // The ratio view is a stretch of the inventory order itself.
+                    vector<const Item*> ordered;
+                    inventory.forEach([&ordered](const Item& item)
+                        {
+                            const double ratio{ CompareValueToWeight::ratio(item) };
+                            if (ratio >= 1.0 && ratio <= 3.0)
+                            {
+                                ordered.push_back(&item);
+                            }
+                        });
+                    vector<const Item*> byRatio;
+                    for (const Item& item : inventory.getItemsByRatio(1.0, 3.0))
+                    {
+                        byRatio.push_back(&item);
+                    }
+                    Assert::IsTrue(byRatio == ordered);
+                } };
+            check();
+
+            // The indexes follow drops, adds and a rollback.
+            inventory.beginTransaction();
+            for (unsigned int i{ 0 }; i < 20; i++)
+            {
+                inventory.dropLastItem();
+            }
+            inventory.addItem(leatherArmor);
+            check();
+            inventory.rollbackTransaction();
+            check();
+
+            Assert::IsTrue(inventory.getItemsByWeight(3.0, 2.0).empty());
+            Assert::IsTrue(inventory.getItemsByGoldValue(1000, 2000).empty());
+        }
+
+        TEST_METHOD(TestInventoryQuery)
+        {
+            Inventory inventory;
+            for (unsigned int i{ 0 }; i < 3000; i++)
+            {
+                Armor armor;
+                armor.setName("Armor " + to_string(i));
+                armor.setGoldValue(i % 53);
+                armor.setWeight(0.25 * (i % 29));
+                armor.setSlotID(i % Armor::SLOT_COUNT);
+                armor.setRating(static_cast<int>(i % 13) - 2);
+                inventory.addItem(armor);
+
+                Weapon weapon;
+                weapon.setName("Weapon " + to_string(i));
+                weapon.setGoldValue(i % 31);
+                weapon.setWeight(1.0 + i % 7);
+                weapon.setDamage(static_cast<int>(i % 300));
+                inventory.addItem(weapon);
+            }
+
+            // Each query finds exactly the items a hand-written filter does, in inventory order.
+            auto check{ [&inventory](const ItemQuery& query, const function<bool(const Item&)>& filter)
+                {
+                    vector<const Item*> expected;
+                    inventory.forEach([&expected, &filter](const Item& item)
+                        {
+                            if (filter(item))
+                            {
+                                expected.push_back(&item);
+                            }
+                        });
+                    const vector<ItemPtr<const Item>> found{ inventory.query(query) };
+                    Assert::IsTrue(found.size() == expected.size());
+                    for (size_t i{ 0 }; i < found.size(); i++)
+                    {
+                        Assert::IsTrue(found[i].get() == expected[i]);
+                    }
+                } };
+            auto headArmor{ [](const Item& item)
+                {
+                    const Armor* armor{ dynamic_cast<const Armor*>(&item) };
+                    return armor && armor->getSlotID() == Armor::HEAD_SLOT && armor->getRating() >= 5 && item.getWeight() <= 3.0;
+                } };
+            const ItemQuery headQuery{ ItemQuery{}.ofKind(ItemKind::Armor).inSlot(Armor::HEAD_SLOT).withRating(5, INT_MAX).withWeight(0.0, 3.0) };
+            check(headQuery, headArmor);
+            check(ItemQuery{}.withDamage(100, 130), [](const Item& item)
+                {
+                    const Weapon* weapon{ dynamic_cast<const Weapon*>(&item) };
+                    return weapon && weapon->getDamage() >= 100 && weapon->getDamage() <= 130;
+                });
+            check(ItemQuery{}.withWeight(2.0, 2.0), [](const Item& item) { return item.getWeight() == 2.0; });
+            check(ItemQuery{}, [](const Item&) { return true; });
+            check(ItemQuery{}.ofKind(ItemKind::Item), [](const Item&) { return false; });
+            check(ItemQuery{}.withDamage(1, 10).withRating(1, 10), [](const Item&) { return false; });
+
+            // The index follows drops once it has been built.
+            for (unsigned int i{ 0 }; i < 2500; i++)
+            {
+                inventory.dropLastItem();
+            }
+            check(headQuery, headArmor);
+
+            // Chunks of a bitmap are only kept while they have rows in them.
+            CompressedBitmap bitmap;
+            bitmap.set(5);
+            bitmap.set(100000);
+            Assert::IsTrue(bitmap.getAllocatedChunkCount() == 2);
+            bitmap.reset(100000);
+            Assert::IsTrue(bitmap.getAllocatedChunkCount() == 1);
+            Assert::IsTrue(bitmap.getChunk(0) != nullptr && (*bitmap.getChunk(0))[0] == (1u << 5));
+        }
+
+        TEST_METHOD(TestSearchByName)
+        {
+            Character character;
+            character.addItem(ironSword);
+            character.addItem(mapleBow);
+            Item ore;
+            ore.setName("iron ore");
+            character.addItem(ore);
+            Item wood;
+            wood.setName("Ironwood Plank");
+            character.addItem(wood);
+            character.addItem(wood);
+
+            auto names{ [&character](string_view text, NameSearch mode)
+                {
+                    string found;
+                    for (const ItemPtr<const Item>& item : character.getInventory().searchByName(text, mode))
+                    {
+                        found += item->getName() + ";";
+                    }
+                    return found;
+                } };
+
+            // Results come in case-folded name order; equal names are all found.
+            Assert::AreEqual(string{ "iron ore;Iron Sword;Ironwood Plank;Ironwood Plank;" }, names("IRON", NameSearch::PrefixIgnoringCase));
+            Assert::AreEqual(string{ "Iron Sword;Ironwood Plank;Ironwood Plank;" }, names("Iron", NameSearch::Prefix));
+            Assert::AreEqual(string{ "Iron Sword;" }, names("iron sword", NameSearch::ExactIgnoringCase));
+            Assert::AreEqual(string{ "" }, names("iron sword", NameSearch::Exact));
+            Assert::AreEqual(string{ "Maple Bow;" }, names("Maple Bow", NameSearch::Exact));
+            Assert::AreEqual(string{ "" }, names("Maple", NameSearch::Exact));
+
+            // The index follows adds and drops once it has been built.
+            character.dropItem(wood);
+            character.addItem(healingPotion);
+            Assert::AreEqual(string{ "iron ore;Iron Sword;Ironwood Plank;" }, names("iron", NameSearch::PrefixIgnoringCase));
+            Assert::AreEqual(string{ "Healing Potion;" }, names("h", NameSearch::PrefixIgnoringCase));
+
+            // The command processor's search prints one item per line.
+            CommandProcessor processor{ character };
+            string output;
+            processor.execute("search \"iron s\"", output);
+            string expected;
+            ironSword.appendTo(expected);
+            Assert::AreEqual(expected + "\n", output);
+            output.clear();
+            processor.execute("search exact \"iron sword\"", output);
+            Assert::IsTrue(output.empty());
+        }
+
+        TEST_METHOD(TestItemKey)
+        {
+            Character character;
+            character.addItem(ironSword);
+            character.addItem(healingPotion);
+            character.addItem(healingPotion);
+            character.addItem(leatherArmor);
+            Item worthless;
+            worthless.setName("Rock");
+            character.addItem(worthless);
+
+            // A key matches exactly what operator== would: the same class and every field.
+            const ItemKey swordKey{ "Iron Sword", 50, 6.0, 10 };
+            Assert::IsTrue(swordKey.matches(ironSword));
+            Assert::IsFalse(swordKey.matches(mapleBow));
+            Assert::IsFalse(ItemKey("Iron Sword", 50, 6.0).matches(ironSword));
+            Assert::IsTrue(ItemKey("Iron Sword", 50, 6.0).getHash() != swordKey.getHash());
+            Assert::IsTrue(ItemKey::of(leatherArmor, "Leather Armor").getHash() == ItemKey("Leather Armor", 61, 6.0, Armor::CHEST_SLOT, 10).getHash());
+
+            // Lookups find the inventory's own object, the first one in inventory order.
+            const Inventory& inventory{ character.getInventory() };
+            ItemPtr<const Item> potion{ inventory.findItem(ItemKey{ "Healing Potion", 36, 0.5 }) };
+            Assert::IsNotNull(potion.get());
+            Assert::IsTrue(potion == inventory.getInventoryPage(inventory.rankOf(healingPotion), 1)[0]);
+            Assert::IsNull(inventory.findItem(ItemKey{ "Healing Potion", 36, 0.25 }).get());
+            Assert::IsNotNull(inventory.findItem(ItemKey{ "Rock", 0, -0.0 }).get());
+
+            // Drop and equip by key; the index follows every change once it has been built.
+            character.dropItem(ItemKey{ "Healing Potion", 36, 0.5 });
+            Assert::AreEqual(4u, inventory.getSize());
+            Assert::IsNotNull(inventory.findItem(ItemKey{ "Healing Potion", 36, 0.5 }).get());
+            character.equipWeapon(swordKey);
+            Assert::IsTrue(ironSword == *character.getEquippedWeapon());
+            character.unequipWeapon();
+            Assert::IsNotNull(inventory.findItem(swordKey).get());
+            character.equipArmor(ItemKey{ "Leather Armor", 61, 6.0, Armor::CHEST_SLOT, 10 });
+            Assert::AreEqual(10, character.getTotalArmorRating());
+
+            // A key of the wrong kind, or for an item that isn't there, throws like the Item overloads.
+            Assert::ExpectException<logic_error>([&]() { character.equipArmor(swordKey); });
+            Assert::ExpectException<logic_error>([&]() { character.equipWeapon(ItemKey{ "Healing Potion", 36, 0.5 }); });
+            Assert::ExpectException<logic_error>([&]() { character.dropItem(ItemKey{ "Leather Armor", 61, 6.0, Armor::CHEST_SLOT, 10 }); });
+            Assert::AreEqual(3u, inventory.getSize());
+
+            // The command processor looks items up by key.
+            CommandProcessor processor{ character };
+            string output;
+            processor.execute("drop-item \"Healing Potion\" 36 0.5", output);
+            processor.execute("equip-weapon \"Iron Sword\" 50 6 10", output);
+            Assert::AreEqual(1u, inventory.getSize());
+            Assert::ExpectException<out_of_range>([&]() { processor.execute("drop-armor \"Leather Armor\" 61 6 9 10", output); });
+        }
+
+        TEST_METHOD(TestWorthlessWeightlessItems)
+        {
+            // Items worth nothing that weigh nothing have no ratio at all; mixed in with ordinary items they
+            // must not hide them from a lookup.
+            Character character;
+            vector<Item> items;
+            for (unsigned int i{ 0 }; i < 23; i++)
+            {
+                Item item;
+                if (i % 4 != 3)
+                {
+                    item.setName("I" + to_string(i));
+                    item.setGoldValue(i * 5 % 10 + 1);
+                    item.setWeight(1.0 + i * 2 % 4);
+                }
+                items.push_back(item);
+                character.addItem(item);
+            }
+            character.addItem(ironSword);
+            character.addItem(Item{});
+
+            // Every item can be ranked and dropped, and the weapon equipped.
+            Assert::AreEqual(character.getInventory().getSize() - 6, character.getInventory().rankOf(Item{}));
+            character.equipWeapon(ironSword);
+            Assert::AreEqual(ironSword, *character.getEquippedWeapon());
+            for (const Item& item : items)
+            {
+                character.dropItem(item);
+            }
+            Assert::AreEqual(1u, character.getInventory().getSize());
+        }
+
+        TEST_METHOD(TestItemFingerprint)
+        {
+            // Equal items have equal fingerprints, including copies and weights of 0.0 and -0.0.
+            Weapon copy{ ironSword };
+            Assert::IsTrue(copy.getFingerprint() == ironSword.getFingerprint());
+            Item light;
+            Item negative;
+            negative.setWeight(-0.0);
+            Assert::IsTrue(light == negative);
+            Assert::IsTrue(light.getFingerprint() == negative.getFingerprint());
+
+            // Every setter of a compared field changes the fingerprint, and changing it back restores it.
+            const uint64_t original{ ironSword.getFingerprint() };
+            copy.setDamage(11);
+            Assert::IsTrue(copy.getFingerprint() != original);
+            Assert::IsFalse(copy == ironSword);
+            copy.setDamage(10);
+            Assert::IsTrue(copy.getFingerprint() == original);
+            copy.setName("Iron Sword ");
+            Assert::IsTrue(copy.getFingerprint() != original);
+
+            Armor armor{ leatherArmor };
+            armor.setRating(11);
+            Assert::IsTrue(armor.getFingerprint() != leatherArmor.getFingerprint());
+            armor.setRating(10);
+            armor.setSlotID(Armor::LEGS_SLOT);
+            Assert::IsTrue(armor.getFingerprint() != leatherArmor.getFingerprint());
+
+            // A sliced copy doesn't keep a fingerprint that covers the damage, slot or rating.
+            Item plain;
+            plain.setName(leatherArmor.getName());
+            plain.setGoldValue(leatherArmor.getGoldValue());
+            plain.setWeight(leatherArmor.getWeight());
+            leatherArmor.getFingerprint();
+            Item sliced{ leatherArmor };
+            Item assigned;
+            assigned = leatherArmor;
+            Item moved{ Armor{ leatherArmor } };
+            Assert::IsTrue(sliced == plain);
+            Assert::IsTrue(assigned == plain);
+            Assert::IsTrue(moved == plain);
+            Item& base{ armor };
+            base = Armor{ leatherArmor };
+            Assert::IsTrue(armor.getFingerprint() != leatherArmor.getFingerprint());
+            Assert::IsFalse(armor == leatherArmor);
+
+            // A key has the same fingerprint as the items it matches.
+            Assert::IsTrue(ItemKey("Leather Armor", 61, 6.0, Armor::CHEST_SLOT, 10).getHash() == static_cast<size_t>(leatherArmor.getFingerprint()));
+            Assert::IsTrue(ItemKey("Iron Sword", 50, 6.0, 10).getHash() == static_cast<size_t>(original));
+        }
+
+        TEST_METHOD(TestItemKindTag)
+        {
+            // The kind is fixed by the class and carried by copies and clones.
+            Assert::IsTrue(healingPotion.getKind() == ItemKind::Item);
+            Assert::IsTrue(ironSword.getKind() == ItemKind::Weapon);
+            Assert::IsTrue(leatherArmor.getKind() == ItemKind::Armor);
+            unique_ptr<Item> clone{ leatherArmor.clone() };
+            Assert::IsTrue(clone->getKind() == ItemKind::Armor);
+            Weapon copy{ mapleBow };
+            Assert::IsTrue(copy.getKind() == ItemKind::Weapon);
+
+            // Items of different kinds are never equal, even with the same common fields.
+            Item plain;
+            plain.setName(ironSword.getName());
+            plain.setGoldValue(ironSword.getGoldValue());
+            plain.setWeight(ironSword.getWeight());
+            Assert::IsFalse(plain == ironSword);
+            Assert::IsFalse(ironSword == plain);
+
+            // The best weapon and armor are found by kind.
+            Character character;
+            character.addItem(plain);
+            character.addItem(ironSword);
+            character.addItem(leatherArmor);
+            character.optimizeEquipment();
+            Assert::IsTrue(ironSword == *character.getEquippedWeapon());
+            Assert::IsTrue(leatherArmor == *character.getEquippedArmor(Armor::CHEST_SLOT));
+            Assert::AreEqual(1u, character.getInventory().getSize());
+        }
+
+        TEST_METHOD(TestSlicedItemKind)
+        {
+            // Copying or moving a weapon or armor into a plain Item slices it to the kind Item.
+            Item plain;
+            plain.setName(ironSword.getName());
+            plain.setGoldValue(ironSword.getGoldValue());
+            plain.setWeight(ironSword.getWeight());
+            Item sliced{ ironSword };
+            Item moved{ Armor{ leatherArmor } };
+            Item assigned;
+            assigned = ironSword;
+            Assert::IsTrue(sliced.getKind() == ItemKind::Item);
+            Assert::IsTrue(moved.getKind() == ItemKind::Item);
+            Assert::IsTrue(assigned.getKind() == ItemKind::Item);
+            Assert::IsTrue(sliced == plain);
+            Assert::IsTrue(assigned == plain);
+
+            // A sliced item is stored, found and dropped as the plain item it is.
+            Character character;
+            character.addItem(sliced);
+            character.addItem(std::move(moved));
+            Assert::IsTrue(findItem(character.getInventory(), plain).getKind() == ItemKind::Item);
+            character.dropItem(plain);
+            Assert::AreEqual(1u, character.getInventory().getSize());
+
+            // Copies and moves of a weapon or armor keep their own kind.
+            Weapon weapon{ ironSword };
+            Armor armor;
+            armor = Armor{ leatherArmor };
+            Assert::IsTrue(weapon.getKind() == ItemKind::Weapon && weapon == ironSword);
+            Assert::IsTrue(armor.getKind() == ItemKind::Armor && armor == leatherArmor);
+
+            // A caller's class of item has kind Item too, but never equals a plain Item, so dropping a
+            // plain Item can't remove it.
+            Potion potion;
+            potion.setName("Heal");
+            potion.setGoldValue(5);
+            potion.setWeight(1.0);
+            Item heal;
+            heal.setName("Heal");
+            heal.setGoldValue(5);
+            heal.setWeight(1.0);
+            Assert::IsTrue(potion.getKind() == ItemKind::Item);
+            Assert::IsFalse(heal == potion);
+            Assert::IsFalse(potion == heal);
+            Character potionCharacter;
+            potionCharacter.addItem(potion);
+            Assert::ExpectException<logic_error>([&potionCharacter, &heal]() { potionCharacter.dropItem(heal); });
+            potionCharacter.dropItem(potion);
+            Assert::AreEqual(0u, potionCharacter.getInventory().getSize());
+        }
+
+        TEST_METHOD(TestStaticItemDispatch)
+        {
+            // The visitor sees each item as its concrete class.
+            auto className{ [](const Item& item)
+                {
+                    return visitItem(item, [](const auto& concrete)
+                        {
+                            using ItemType = std::decay_t<decltype(concrete)>;
+                            return string{ std::is_same_v<ItemType, Weapon> ? "Weapon" : std::is_same_v<ItemType, Armor> ? "Armor" : "Item" };
+                        });
+                } };
+            Assert::AreEqual(string{ "Item" }, className(healingPotion));
+            Assert::AreEqual(string{ "Weapon" }, className(ironSword));
+            Assert::AreEqual(string{ "Armor" }, className(leatherArmor));
+
+            // Clones and text match the virtual functions.
+            for (const Item* item : { static_cast<const Item*>(&healingPotion), static_cast<const Item*>(&ironSword), static_cast<const Item*>(&leatherArmor) })
+            {
+                unique_ptr<Item> copy{ visitItem(*item, [](const auto& concrete) { return static_cast<Item*>(cloneExact(concrete)); }) };
+                Assert::IsTrue(*copy == *item);
+                Assert::IsTrue(copy->getKind() == item->getKind());
+
+                string expected;
+                item->appendTo(expected);
+                string actual;
+                visitItem(*item, [&actual](const auto& concrete) { appendExact(concrete, actual); });
+                Assert::AreEqual(expected, actual);
+            }
+        }
+
+        TEST_METHOD(TestCallerItemSubclasses)
+        {
+            Potion potion;
+            potion.setName("Potion");
+            potion.setGoldValue(5);
+            potion.setWeight(1.0);
+            potion.potency = 3;
+            EnchantedSword sword;
+            sword.setName("Flame Sword");
+            sword.setGoldValue(100);
+            sword.setWeight(8.0);
+            sword.setDamage(12);
+            sword.enchantment = "flaming";
+
+            // The helpers only take the static path for an exact Item, Weapon or Armor.
+            unique_ptr<Item> copy{ visitItem(static_cast<const Item&>(sword), [](const auto& concrete) { return static_cast<Item*>(cloneExact(concrete)); }) };
+            Assert::IsNotNull(dynamic_cast<EnchantedSword*>(copy.get()));
+            string text;
+            visitItem(static_cast<const Item&>(potion), [&text](const auto& concrete) { appendExact(concrete, text); });
+            Assert::AreEqual(string{ "Potion, 5 GP, 1 lbs., potency 3" }, text);
+
+            // Added by copy or by move, the inventory keeps the caller's own classes.
+            Character character;
+            character.addItem(potion);
+            character.addItem(Potion{ potion });
+            character.addItem(sword);
+            unsigned int potions{ 0 };
+            unsigned int swords{ 0 };
+            character.getInventory().forEach([&potions, &swords](const Item& item)
+                {
+                    const Potion* stored{ dynamic_cast<const Potion*>(&item) };
+                    potions += stored && stored->potency == 3 ? 1 : 0;
+                    const EnchantedSword* storedSword{ dynamic_cast<const EnchantedSword*>(&item) };
+                    swords += storedSword && storedSword->enchantment == "flaming" ? 1 : 0;
+                });
+            Assert::AreEqual(2u, potions);
+            Assert::AreEqual(1u, swords);
+
+            // The formatter prints them with their own text, like operator<<.
+            stringstream expected;
+            expected << character;
+            Assert::IsTrue(CharacterFormatter{}.format(character) == expected.str());
+            Assert::IsTrue(expected.str().find("potency 3") != string::npos);
+            Assert::IsTrue(expected.str().find("flaming") != string::npos);
+
+#ifndef RPG_INLINE_EQUIPMENT
+            // Equipping shares the stored object, so the sword stays an EnchantedSword.
+            findAndEquip(character, sword);
+            Assert::IsNotNull(dynamic_cast<const EnchantedSword*>(character.getEquippedWeapon()));
+#endif
+        }
+
+        TEST_METHOD(TestMoveAwareAdds)
+        {
+            // A name too long for the small string buffer, so every copy of it allocates.
+            const string longName(64, 'x');
+
+            // Moving a name in keeps its storage, and reading it back doesn't copy it.
+            Weapon weapon;
+            string name{ longName };
+            const char* storage{ name.data() };
+            weapon.setName(std::move(name));
+            const string& stored{ weapon.getName() };
+            Assert::IsTrue(stored.data() == storage);
+            Assert::AreEqual(longName, stored);
+            weapon.setDamage(7);
+
+            // Moving an item in takes over its name instead of copying it.
+            Inventory moved;
+            Weapon temporary{ weapon };
+            storage = temporary.getName().data();
+            moved.addItem(std::move(temporary));
+            ItemPtr<const Item> added{ moved.findItem(ItemKey::of(weapon, weapon.getName())) };
+            Assert::IsTrue(*added == weapon);
+            Assert::IsTrue(added->getName().data() == storage);
+
+#ifdef _DEBUG
+            // So it makes one allocation fewer than adding a copy.
+            Inventory copied;
+            long before{ liveAllocations() };
+            copied.addItem(weapon);
+            const long copyCost{ liveAllocations() - before };
+
+            Inventory movedAgain;
+            temporary = weapon;
+            before = liveAllocations();
+            movedAgain.addItem(std::move(temporary));
+            Assert::AreEqual(copyCost - 1, liveAllocations() - before);
+#endif
+
+            // A unique_ptr hands over the object itself.
+            Character character;
+            unique_ptr<Item> loot{ new Weapon{ weapon } };
+            const Item* object{ loot.get() };
+            character.addItem(std::move(loot));
+            const Item* found{ nullptr };
+            character.getInventory().forEach([&found](const Item& item) { found = &item; });
+            Assert::IsTrue(found == object);
+        }
+
+#ifdef _DEBUG
+        TEST_METHOD(TestFusedItemAllocation)
+        {
+            // Adding a copy costs the same as adding an item already made with makeItem(): the copy and
+            // its reference count share one allocation.
+            Inventory copied;
+            long before{ liveAllocations() };
+            copied.addItem(ironSword);
+            const long copyCost{ liveAllocations() - before };
+
+            Inventory shared;
+            before = liveAllocations();
+            shared.addItem(makeItem<Weapon>(ironSword));
+            Assert::AreEqual(liveAllocations() - before, copyCost);
+
+            // The same goes for moving an item in.
+            Inventory moved;
+            Armor temporary{ leatherArmor };
+            before = liveAllocations();
+            moved.addItem(std::move(temporary));
+            Assert::AreEqual(copyCost, liveAllocations() - before);
+        }
+#endif
+
+        TEST_METHOD(TestItemPtr)
+        {
+            // Handles share ownership like shared_ptr, whichever kind the build uses.
+            ItemPtr<Item> item{ makeItem<Weapon>(ironSword) };
+            Assert::AreEqual(1L, item.use_count());
+            {
+                ItemPtr<const Item> copy{ item };
+                ItemPtr<Weapon> weapon{ staticItemCast<Weapon>(item) };
+                Assert::AreEqual(3L, item.use_count());
+                Assert::AreEqual(ironSword, *weapon);
+                Assert::IsTrue(copy.get() == weapon.get());
+            }
+            Assert::AreEqual(1L, item.use_count());
+
+            // Moving a handle doesn't touch the item, and the last owner frees it.
+            ItemPtr<Item> moved{ std::move(item) };
+            Assert::IsTrue(item == nullptr);
+            Assert::AreEqual(1L, moved.use_count());
+#ifdef _DEBUG
+            const long before{ liveAllocations() };
+#endif
+            moved.reset();
+            Assert::IsTrue(moved == nullptr);
+#ifdef _DEBUG
+            Assert::AreEqual(before - 1, liveAllocations());
+#endif
+
+#ifdef RPG_SINGLE_THREADED
+            // The count lives in the item, so a handle is just a pointer.
+            static_assert(sizeof(ItemPtr<Item>) == sizeof(Item*), "an intrusive handle holds only the pointer");
+#endif
+            Character character;
+            character.addItem(ironSword);
+            const CharacterSnapshot snapshot{ character };
+            const Item* live{ nullptr };
+            character.getInventory().forEach([&live](const Item& current) { live = &current; });
+            Assert::IsTrue(snapshot.getInventory()[0].get() == live);
+            Assert::AreEqual(ironSword, static_cast<const Weapon&>(*snapshot.getInventory()[0]));
+        }
+
+        TEST_METHOD(TestCharacterFormatter)
+        {
+            Character character;
+            CharacterFormatter formatter;
+
+            // An empty character prints every "there is no" line.
+            stringstream expected;
+            expected << character;
+            Assert::IsTrue(formatter.format(character) == expected.str());
+
+            Item pebble;
+            pebble.setName("Pebble");
+            pebble.setGoldValue(3);
+            pebble.setWeight(0.1234567);
+            Weapon heavy;
+            heavy.setName("Heavy Hammer");
+            heavy.setWeight(1234567.0);
+            heavy.setDamage(-2);
+            character.addItem(pebble);
+            character.addItem(heavy);
+            character.addItem(mapleBow);
+            character.addItem(leatherArmor);
+            character.equipArmor(leatherArmor);
+            character.equipWeapon(mapleBow);
+
+            // Numbers round the same way the stream would, and the buffer is reused.
+            expected.str("");
+            expected << character;
+            Assert::IsTrue(formatter.format(character) == expected.str());
+            stringstream written;
+            formatter.write(character, written);
+            Assert::IsTrue(written.str() == expected.str());
+
+            string appended{ "> " };
+            CharacterFormatter::appendTo(character, appended);
+            Assert::IsTrue(appended == "> " + expected.str());
+        }
+
+#ifdef __linux__
+        TEST_METHOD(TestCharacterServer)
+        {
+            CharacterServer server{ "TestCharacterServer.sock" };
+            thread serving{ [&server]() { server.run(); } };
+
+            // Every pipelined command gets its own reply, on its own connection's character.
+            const LoadReport report{ LoadGenerator::run("TestCharacterServer.sock", 3, 200, 16) };
+            server.requestStop();
+            serving.join();
+
+            Assert::IsTrue(report.commands == 600);
+            Assert::IsTrue(report.errors == 0);
+            Assert::IsTrue(report.p50 <= report.p99);
+
+            // The default character plus one per load connection.
+            Assert::IsTrue(server.getCharacterCount() == 4);
+        }
+
+        TEST_METHOD(TestCharacterServerLimits)
+        {
+            CharacterServer server{ "TestCharacterServerLimits.sock" };
+            thread serving{ [&server]() { server.run(); } };
+
+            sockaddr_un address{};
+            address.sun_family = AF_UNIX;
+            strcpy(address.sun_path, "TestCharacterServerLimits.sock");
+            const int client{ socket(AF_UNIX, SOCK_STREAM, 0) };
+            Assert::AreEqual(0, connect(client, reinterpret_cast<const sockaddr*>(&address), sizeof(address)));
+
+            // A line that's too long is refused without closing the connection, then far more output is
+            // requested than the server holds for a client that isn't reading.
+            const unsigned int prints{ 20000 };
+            string requests(CharacterServer::MAX_LINE_LENGTH + 1, 'x');
+            requests.append("\nadd-item \"Iron Ore\" 3 5\n");
+            for (unsigned int i{ 0 }; i < prints; i++)
+            {
+                requests.append("print\n");
+            }
+            thread sending{ [client, &requests]()
+                {
+                    for (size_t sent{ 0 }; sent < requests.size();)
+                    {
+                        const ssize_t result{ send(client, requests.data() + sent, requests.size() - sent, MSG_NOSIGNAL) };
+                        Assert::IsTrue(result > 0);
+                        sent += static_cast<size_t>(result);
+                    }
+                } };
+
+            // Every reply still arrives, in order, once the client reads them.
+            this_thread::sleep_for(chrono::milliseconds{ 50 });
+            string replies;
+            char buffer[1 << 16];
+            auto readLine{ [&]()
+                {
+                    size_t newline;
+                    while ((newline = replies.find('\n')) == string::npos)
+                    {
+                        const ssize_t received{ recv(client, buffer, sizeof(buffer), 0) };
+                        Assert::IsTrue(received > 0);
+                        replies.append(buffer, static_cast<size_t>(received));
+                    }
+                    const string line{ replies.substr(0, newline) };
+                    replies.erase(0, newline + 1);
+                    return line;
+                } };
+            Assert::AreEqual(string{ "error line too long" }, readLine());
+            Assert::AreEqual(string{ "ok" }, readLine());
+            size_t printed{ 0 };
+            for (unsigned int i{ 0 }; i < prints; i++)
+            {
+                const string header{ readLine() };
+                Assert::AreEqual(0, header.compare(0, 3, "ok "));
+                const size_t length{ stoul(header.substr(3)) };
+                while (replies.size() < length)
+                {
+                    const ssize_t received{ recv(client, buffer, sizeof(buffer), 0) };
+                    Assert::IsTrue(received > 0);
+                    replies.append(buffer, static_cast<size_t>(received));
+                }
+                replies.erase(0, length);
+                printed += length;
+            }
+            Assert::IsTrue(printed > CharacterServer::MAX_UNSENT_OUTPUT);
+
+            sending.join();
+            ::close(client);
+            server.requestStop();
+            serving.join();
+        }
+
+#endif
         TEST_METHOD(TestOptimizeEquipmentTrivial)
         {
             Character character;
@@ -1867,7 +3607,7 @@ namespace UnitTests
             // Preconditions
             Assert::AreEqual(0.0, character.getTotalWeight());
             Assert::IsNull(character.getEquippedWeapon());
-            Assert::AreEqual(0u, character.getTotalArmorRating());
+            Assert::AreEqual(0, character.getTotalArmorRating());
             for (int i = 0; i < 6; i++)
             {
                 Assert::IsNull(character.getEquippedArmor(i));
@@ -1890,7 +3630,7 @@ namespace UnitTests
             character.optimizeEquipment();
 
             // Check the armor rating.
-            Assert::AreEqual(79u, character.getTotalArmorRating());
+            Assert::AreEqual(79, character.getTotalArmorRating());
 
             // The weight shouldn't change.
             Assert::AreEqual(68.0, character.getTotalWeight());
@@ -1928,7 +3668,7 @@ namespace UnitTests
             // Preconditions
             Assert::AreEqual(0.0, character.getTotalWeight());
             Assert::IsNull(character.getEquippedWeapon());
-            Assert::AreEqual(0u, character.getTotalArmorRating());
+            Assert::AreEqual(0, character.getTotalArmorRating());
             for (int i = 0; i < 6; i++)
             {
                 Assert::IsNull(character.getEquippedArmor(i));
@@ -1990,7 +3730,7 @@ namespace UnitTests
             character.optimizeEquipment();
 
             // Check the armor rating.
-            Assert::AreEqual(79u, character.getTotalArmorRating());
+            Assert::AreEqual(79, character.getTotalArmorRating());
 
             // Check that all of the items are equipped:
             for (unsigned int i{ 0 }; i < Armor::SLOT_COUNT; i++)
@@ -2028,7 +3768,7 @@ namespace UnitTests
             // Preconditions
             Assert::AreEqual(0.0, character.getTotalWeight());
             Assert::IsNull(character.getEquippedWeapon());
-            Assert::AreEqual(0u, character.getTotalArmorRating());
+            Assert::AreEqual(0, character.getTotalArmorRating());
             for (int i = 0; i < 6; i++)
             {
                 Assert::IsNull(character.getEquippedArmor(i));
@@ -2092,7 +3832,7 @@ namespace UnitTests
             character.optimizeEquipment();
 
             // Check the armor rating.
-            Assert::AreEqual(79u, character.getTotalArmorRating());
+            Assert::AreEqual(79, character.getTotalArmorRating());
 
             // Check that all of the items are equipped:
             for (unsigned int i{ 0 }; i < Armor::SLOT_COUNT; i++)
@@ -2162,7 +3902,7 @@ namespace UnitTests
             Assert::AreEqual(109.5, character.getTotalWeight());
 
             // Armor rating should have improved.
-            Assert::AreEqual(84u, character.getTotalArmorRating());
+            Assert::AreEqual(84, character.getTotalArmorRating());
 
             // Make sure that the new "legendary" items were equipped.
             Assert::AreEqual(legendaryBattleaxe, *character.getEquippedWeapon());